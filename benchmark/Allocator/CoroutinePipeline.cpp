@@ -0,0 +1,123 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#include "Allocator/Coroutine.h"
+#include "Benchmark.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+uint64_t gNumMallocs = 0;
+
+} // namespace
+
+// Counts every heap allocation of the process, coroutine frames from the heap included.
+void* operator new(size_t size) {
+	++gNumMallocs;
+
+	if (void* pointer = std::malloc(size)) { return pointer; }
+
+	throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept {
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+	std::free(pointer);
+}
+
+namespace simple {
+
+using Task = ArenaTask<uint64_t>;
+
+const uint32_t NumRequests = 1 << 16;
+const uint32_t NumRepeats  = 5;
+const uint32_t ArenaSize   = 64 * 1024;
+
+// A request handler in the usual shape: a few stages, each its own coroutine awaiting helpers.
+Task parse(uint64_t request) {
+	co_return request * 31 + 7;
+}
+
+Task lookup(uint64_t key) {
+	co_return key ^ (key >> 7);
+}
+
+Task validate(uint64_t value) {
+	uint64_t a = co_await lookup(value);
+	uint64_t b = co_await lookup(value + 1);
+
+	co_return a + b;
+}
+
+Task serialize(uint64_t value) {
+	co_return value % 1000003;
+}
+
+Task handle(uint64_t request) {
+	uint64_t parsed    = co_await parse(request);
+	uint64_t validated = co_await validate(parsed);
+
+	co_return co_await serialize(validated);
+}
+
+// Six frames per request.
+template <typename F>
+void run(const char* name, F&& request) {
+	uint64_t checksum  = 0;
+	uint64_t numMalloc = gNumMallocs;
+
+	double elapsed = benchmark::measure(NumRepeats, NumRequests, [&]() {
+		for (uint32_t i = 0; i < NumRequests; ++i) { checksum += request(i); }
+	});
+
+	numMalloc = gNumMallocs - numMalloc;
+
+	std::printf("%-40s %10.2f ns/request %8.2f mallocs/request\n", name, elapsed,
+			double(numMalloc) / (uint64_t(NumRepeats) * NumRequests));
+
+	benchmark::doNotOptimize(checksum);
+}
+
+} // namespace simple
+
+int main() {
+	using namespace simple;
+
+	void* memory = std::malloc(ArenaSize);
+
+	run("heap frames", [](uint64_t request) { return handle(request).get(); });
+
+	{
+		StackAllocator stack(memory, ArenaSize);
+		CoroutineArena arena(stack);
+
+		run("StackAllocator frames", [&](uint64_t request) {
+			CoroutineArenaScope scope(arena);
+			return handle(request).get();
+		});
+	}
+
+	{
+		LinearAllocator linear(memory, ArenaSize);
+		CoroutineArena arena(linear);
+
+		run("request scoped LinearAllocator frames", [&](uint64_t request) {
+			CoroutineArenaScope scope(arena);
+			uint64_t result = handle(request).get();
+
+			linear.clean();
+
+			return result;
+		});
+	}
+
+	std::free(memory);
+
+	return 0;
+}
@@ -0,0 +1,118 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#include "Allocator/JobSystem.h"
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+
+namespace simple {
+
+struct Node {
+	Node*    left;
+	Node*    right;
+	uint64_t value;
+};
+
+const uint32_t NumWorkers  = 4;
+const uint32_t NumJobs     = 1 << 12;
+const uint32_t TreeDepth   = 10;
+const uint32_t NumRepeats  = 5;
+const uint32_t ScratchSize = 1 << 20;
+
+// Every job builds a temporary tree of TreeDepth levels, walks it and throws it away, as a job
+// using scratch memory for its intermediate results would.
+template <typename Create>
+Node* build(uint32_t depth, uint64_t& value, Create& create) {
+	Node* node = create();
+
+	node->value = value++;
+	node->left  = depth > 1 ? build(depth - 1, value, create) : nullptr;
+	node->right = depth > 1 ? build(depth - 1, value, create) : nullptr;
+
+	return node;
+}
+
+uint64_t walk(const Node* node) {
+	return node ? node->value + walk(node->left) + walk(node->right) : 0;
+}
+
+void destroy(Node* node) {
+	if (!node) { return; }
+
+	destroy(node->left);
+	destroy(node->right);
+
+	delete node;
+}
+
+// Splits [begin, end) into halves until single jobs are left, so the tree of jobs itself gets
+// stolen and built in parallel.
+template <typename Leaf>
+uint64_t split(JobSystem& system, uint32_t begin, uint32_t end, Leaf& leaf) {
+	if (end - begin == 1) { return leaf(system, begin); }
+
+	uint32_t middle = begin + (end - begin) / 2;
+
+	uint64_t left  = 0;
+	uint64_t right = 0;
+
+	JobCounter counter(0);
+
+	system.spawn(counter, [&](JobContext& context) { left = split(context.getSystem(), begin, middle, leaf); });
+	system.spawn(counter, [&](JobContext& context) { right = split(context.getSystem(), middle, end, leaf); });
+
+	system.wait(counter);
+
+	return left + right;
+}
+
+template <typename Leaf>
+void run(const char* name, JobSystem& system, Leaf&& leaf) {
+	uint64_t checksum = 0;
+
+	double elapsed = benchmark::measure(NumRepeats, uint64_t(NumJobs) * ((1u << TreeDepth) - 1), [&]() {
+		ScratchScope scope(system.getScratch());
+		checksum = split(system, 0, NumJobs, leaf);
+	});
+
+	benchmark::report(name, elapsed);
+	benchmark::doNotOptimize(checksum);
+}
+
+} // namespace simple
+
+int main() {
+	using namespace simple;
+
+	JobSystem system(NumWorkers, ScratchSize);
+
+	std::printf("%u jobs of %u nodes on %u workers, %u cpus\n", NumJobs, (1u << TreeDepth) - 1, NumWorkers,
+			std::max(1u, std::thread::hardware_concurrency()));
+
+	run("malloc-backed jobs", system, [](JobSystem&, uint32_t job) {
+		uint64_t value = job;
+		auto create = [] { return new Node; };
+
+		Node* root = build(TreeDepth, value, create);
+		uint64_t result = walk(root);
+
+		destroy(root);
+
+		return result;
+	});
+
+	run("per-worker scratch jobs", system, [](JobSystem& system, uint32_t job) {
+		LinearAllocator& scratch = system.getScratch();
+
+		uint64_t value = job;
+		auto create = [&] { return scratch.createNoConstruct<Node>(); };
+
+		// Released by the scope of the job.
+		return walk(build(TreeDepth, value, create));
+	});
+
+	return 0;
+}
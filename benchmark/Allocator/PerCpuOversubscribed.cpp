@@ -0,0 +1,104 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#include "Allocator/PerCpu.h"
+#include "Allocator/Pool.h"
+#include "Benchmark.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace simple {
+
+struct Packet {
+	uint64_t data[8];
+};
+
+const uint32_t ThreadsPerCpu = 4;
+const uint32_t NumRounds     = 1 << 14;
+const uint32_t NumLive       = 16;
+const uint32_t NumObjects    = 1 << 16;
+
+// Runs the same churn on ThreadsPerCpu threads per cpu. Every thread parks before it exits, so
+// the slots still sitting in caches can be counted while the caches are alive.
+template <typename Create, typename Remove, typename Parked>
+void run(const char* name, Create&& create, Remove&& remove, Parked&& parked) {
+	uint32_t numThreads = ThreadsPerCpu * std::thread::hardware_concurrency();
+
+	std::atomic<uint32_t> numReady(0);
+	std::atomic<bool> release(false);
+	std::vector<std::thread> threads;
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (uint32_t t = 0; t < numThreads; ++t) {
+		threads.emplace_back([&] {
+			Packet* objects[NumLive];
+
+			for (uint32_t round = 0; round < NumRounds; ++round) {
+				for (auto& object : objects) { object = create(); }
+
+				benchmark::doNotOptimize(objects);
+
+				for (auto* object : objects) { remove(object); }
+			}
+
+			numReady.fetch_add(1);
+
+			while (!release.load()) { std::this_thread::yield(); }
+		});
+	}
+
+	while (numReady.load() < numThreads) { std::this_thread::yield(); }
+
+	auto end = std::chrono::steady_clock::now();
+
+	uint32_t numParked = parked();
+
+	release.store(true);
+
+	for (auto& thread : threads) { thread.join(); }
+
+	double elapsed = std::chrono::duration<double, std::nano>(end - start).count();
+
+	std::printf("%-24s %3u threads %10.2f ns/op %8u slots parked in caches\n", name, numThreads,
+			elapsed / (uint64_t(numThreads) * NumRounds * NumLive * 2), numParked);
+}
+
+} // namespace simple
+
+int main() {
+	using namespace simple;
+
+	{
+		PoolAllocator<Packet> pool(NumObjects);
+		std::mutex mutex;
+
+		run("mutex + PoolAllocator",
+				[&] { std::lock_guard<std::mutex> lock(mutex); return pool.createNoConstruct(); },
+				[&](Packet* object) { std::lock_guard<std::mutex> lock(mutex); pool.removeNoDestruct(object); },
+				[&] { return 0u; });
+	}
+
+	using Allocator = PerCpuPoolAllocator<Packet>;
+
+	for (auto mode : { Allocator::CacheMode::ThreadLocal, Allocator::CacheMode::PerCpu }) {
+		Allocator pool(NumObjects, mode);
+
+		if (pool.getCacheMode() != mode) {
+			std::printf("rseq is not available, per-cpu caches fall back to thread-local ones\n");
+			continue;
+		}
+
+		run(mode == Allocator::CacheMode::PerCpu ? "per-cpu caches (rseq)" : "thread-local caches",
+				[&] { return pool.createNoConstruct(); },
+				[&](Packet* object) { pool.removeNoDestruct(object); },
+				[&] { return NumObjects - pool.getNumFreeObjects(); });
+	}
+
+	return 0;
+}
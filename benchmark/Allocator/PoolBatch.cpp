@@ -0,0 +1,90 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#include "Allocator/Pool.h"
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace simple {
+
+struct Packet {
+	uint64_t data[8];
+};
+
+const uint32_t NumObjects = 1 << 16;
+const uint32_t BatchSize  = 128;
+const uint32_t NumRounds  = 1 << 12;
+const uint32_t NumRepeats = 5;
+
+// Leaves the free list of pool in random address order, as it is after a long run of churn.
+void shuffleFreeList(PoolAllocator<Packet>& pool) {
+	std::vector<Packet*> objects(NumObjects);
+
+	for (auto& object : objects) { object = pool.createNoConstruct(); }
+
+	std::shuffle(objects.begin(), objects.end(), std::mt19937(42));
+
+	for (auto* object : objects) { pool.removeNoDestruct(object); }
+}
+
+void run(const char* name, bool churned) {
+	PoolAllocator<Packet> pool(NumObjects);
+
+	if (churned) { shuffleFreeList(pool); }
+
+	Packet* objects[BatchSize];
+
+	std::printf("%s\n", name);
+
+	double single = benchmark::measure(NumRepeats, uint64_t(NumRounds) * BatchSize, [&]() {
+		for (uint32_t round = 0; round < NumRounds; ++round) {
+			for (uint32_t i = 0; i < BatchSize; ++i) {
+				objects[i] = pool.createNoConstruct();
+			}
+
+			benchmark::doNotOptimize(objects);
+
+			for (uint32_t i = 0; i < BatchSize; ++i) {
+				pool.removeNoDestruct(objects[i]);
+			}
+		}
+	});
+
+	benchmark::report("  createNoConstruct/removeNoDestruct", single);
+
+	double batch = benchmark::measure(NumRepeats, uint64_t(NumRounds) * BatchSize, [&]() {
+		for (uint32_t round = 0; round < NumRounds; ++round) {
+			pool.createBatchNoConstruct(BatchSize, objects);
+
+			benchmark::doNotOptimize(objects);
+
+			pool.removeBatchNoDestruct(objects, BatchSize);
+		}
+	});
+
+	benchmark::report("  createBatchNoConstruct/removeBatch", batch);
+
+	// Every round takes fresh slots from the untouched tail.
+	double tail = benchmark::measure(NumRepeats, uint64_t(NumObjects), [&]() {
+		pool.clean();
+
+		for (uint32_t i = 0; i < NumObjects; i += BatchSize) {
+			pool.createBatchNoConstruct(BatchSize, objects);
+			benchmark::doNotOptimize(objects);
+		}
+	});
+
+	benchmark::report("  createBatchNoConstruct (fresh pool)", tail);
+}
+
+} // namespace simple
+
+int main() {
+	simple::run("PoolAllocator, free list in address order", false);
+	simple::run("PoolAllocator, free list shuffled by churn", true);
+
+	return 0;
+}
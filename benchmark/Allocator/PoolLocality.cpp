@@ -0,0 +1,82 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#include "Allocator/Pool.h"
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace simple {
+
+struct Particle {
+	float position[4];
+	float velocity[4];
+	float color[4];
+	float size[4];
+};
+
+const uint32_t NumObjects = 1 << 20;
+const uint32_t NumLive    = NumObjects / 2;
+const uint32_t NumRepeats = 5;
+
+// Allocates NumLive objects in a row and returns how long one update pass over them takes.
+template <typename Pool>
+double iterate(Pool& pool) {
+	std::vector<Particle*> particles(NumLive);
+
+	for (auto& particle : particles) {
+		particle = pool.create();
+		particle->position[0] = 0.0f;
+		particle->velocity[0] = 1.0f;
+	}
+
+	double time = benchmark::measure(NumRepeats, NumLive, [&]() {
+		for (auto* particle : particles) {
+			particle->position[0] += particle->velocity[0];
+		}
+
+		benchmark::doNotOptimize(particles.back()->position[0]);
+	});
+
+	for (auto* particle : particles) { pool.remove(particle); }
+
+	return time;
+}
+
+// Fills pool and frees everything in random order, as a long run of churn leaves it.
+template <typename Pool>
+void churn(Pool& pool) {
+	std::vector<Particle*> particles(NumObjects);
+
+	for (auto& particle : particles) { particle = pool.createNoConstruct(); }
+
+	std::shuffle(particles.begin(), particles.end(), std::mt19937(42));
+
+	for (auto* particle : particles) { pool.removeNoDestruct(particle); }
+}
+
+} // namespace simple
+
+int main() {
+	using namespace simple;
+
+	PoolAllocator<Particle, PoolFlagOccupancy> pool(NumObjects);
+
+	benchmark::report("fresh pool", iterate(pool));
+
+	churn(pool);
+	benchmark::report("after churn", iterate(pool));
+
+	churn(pool);
+	pool.sortFreeList();
+	benchmark::report("after churn + sortFreeList", iterate(pool));
+
+	PoolAllocator<Particle, PoolFlagOccupancy | PoolFlagAddressOrdered> ordered(NumObjects);
+
+	churn(ordered);
+	benchmark::report("after churn, PoolFlagAddressOrdered", iterate(ordered));
+
+	return 0;
+}
@@ -0,0 +1,131 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#include "Allocator/Tlsf.h"
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace simple {
+
+const uint32_t NumOperations = 1 << 21;
+const uint32_t MaxLive       = 1 << 14;
+const uint32_t MinSize       = 16;
+const uint32_t MaxSize       = 4096;
+const uint32_t BufferSize    = 256 << 20;
+
+struct Operation {
+	uint32_t mSlot;
+	uint32_t mSize; // 0 frees the slot.
+};
+
+// Random mix of allocations with log-uniform sizes and frees in random order.
+std::vector<Operation> makeOperations() {
+	std::mt19937 random(1);
+	std::uniform_real_distribution<double> logSize(std::log2(MinSize), std::log2(MaxSize));
+
+	std::vector<Operation> operations;
+	std::vector<uint32_t> live;
+	std::vector<uint32_t> free;
+
+	for (uint32_t i = MaxLive; i-- > 0;) { free.push_back(i); }
+
+	operations.reserve(NumOperations);
+
+	while (operations.size() < NumOperations) {
+		bool allocate = live.empty() || (!free.empty() && random() % 2 == 0);
+
+		if (allocate) {
+			uint32_t slot = free.back();
+			free.pop_back();
+			live.push_back(slot);
+
+			operations.push_back({ slot, static_cast<uint32_t>(std::exp2(logSize(random))) });
+		} else {
+			uint32_t index = random() % live.size();
+			uint32_t slot = live[index];
+
+			live[index] = live.back();
+			live.pop_back();
+			free.push_back(slot);
+
+			operations.push_back({ slot, 0 });
+		}
+	}
+
+	for (uint32_t slot : live) { operations.push_back({ slot, 0 }); }
+
+	return operations;
+}
+
+template <typename Allocate, typename Deallocate>
+void run(const char* name, const std::vector<Operation>& operations, Allocate&& allocate, Deallocate&& deallocate) {
+	using Clock = std::chrono::steady_clock;
+
+	std::vector<void*> slots(MaxLive, nullptr);
+	std::vector<uint32_t> latencies;
+
+	latencies.reserve(operations.size());
+
+	for (const Operation& operation : operations) {
+		auto start = Clock::now();
+
+		if (operation.mSize) {
+			slots[operation.mSlot] = allocate(operation.mSize);
+		} else {
+			deallocate(slots[operation.mSlot]);
+		}
+
+		auto end = Clock::now();
+
+		if (operation.mSize) { std::memset(slots[operation.mSlot], 0, 8); }
+
+		latencies.push_back(static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()));
+	}
+
+	std::sort(latencies.begin(), latencies.end());
+
+	auto percentile = [&](double value) {
+		return latencies[std::min(latencies.size() - 1, static_cast<size_t>(value * latencies.size()))];
+	};
+
+	std::printf("%-8s p50 %6u ns  p99 %6u ns  p99.9 %6u ns  p99.99 %6u ns  max %8u ns\n", name,
+			percentile(0.5), percentile(0.99), percentile(0.999), percentile(0.9999), latencies.back());
+}
+
+} // namespace simple
+
+int main() {
+	using namespace simple;
+
+	auto operations = makeOperations();
+
+	std::printf("%u operations, up to %u live blocks of %u..%u bytes, clock overhead included\n",
+			static_cast<uint32_t>(operations.size()), MaxLive, MinSize, MaxSize);
+
+	void* memory = std::malloc(BufferSize);
+	std::memset(memory, 0, BufferSize);
+
+	TlsfAllocator tlsf(memory, BufferSize);
+
+	for (uint32_t i = 0; i < 2; ++i) {
+		run("tlsf", operations,
+				[&](uint32_t size) { return tlsf.allocate(size, 8); },
+				[&](void* pointer) { tlsf.deallocate(pointer); });
+
+		run("malloc", operations,
+				[&](uint32_t size) { return std::malloc(size); },
+				[&](void* pointer) { std::free(pointer); });
+	}
+
+	std::free(memory);
+
+	return 0;
+}
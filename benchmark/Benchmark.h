@@ -0,0 +1,51 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+namespace simple {
+namespace benchmark {
+
+template <typename T>
+void doNotOptimize(const T& value);
+
+template <typename F>
+double measure(uint32_t numRepeats, uint64_t numOperations, F&& function);
+
+void report(const char* name, double nanoseconds);
+
+
+template <typename T>
+inline void doNotOptimize(const T& value) {
+	asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Returns the best time per operation in nanoseconds over numRepeats runs of function.
+template <typename F>
+double measure(uint32_t numRepeats, uint64_t numOperations, F&& function) {
+	using Clock = std::chrono::steady_clock;
+
+	double best = 0.0;
+
+	for (uint32_t i = 0; i < numRepeats; ++i) {
+		auto start = Clock::now();
+		function();
+		auto end = Clock::now();
+
+		double elapsed = std::chrono::duration<double, std::nano>(end - start).count() / numOperations;
+
+		if (i == 0 || elapsed < best) { best = elapsed; }
+	}
+
+	return best;
+}
+
+inline void report(const char* name, double nanoseconds) {
+	std::printf("%-40s %10.2f ns/op\n", name, nanoseconds);
+}
+
+} // namespace benchmark
+} // namespace simple
@@ -5,6 +5,10 @@
 #include <cassert>
 #include <cstdint>
 
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
 namespace simple {
 namespace allocator {
 
@@ -12,6 +16,12 @@ uint8_t alignForwardAdjustment(void* address, uint8_t alignment);
 uint8_t alignForwardAdjustment(uintptr_t address, uint8_t alignment);
 uint8_t alignForwardAdjustmentWithHeader(uintptr_t address, uint8_t alignment, uint8_t headerSize);
 
+uint32_t countTrailingZeros(uint64_t value);
+uint32_t countLeadingZeros(uint64_t value);
+
+uint32_t findNonZeroWord(const uint64_t* words, uint32_t begin, uint32_t end);
+uint32_t findNonFullWord(const uint64_t* words, uint32_t begin, uint32_t end);
+
 
 inline uint8_t alignForwardAdjustment(void* address, uint8_t alignment) {
 	auto mask = alignment - 1;
@@ -45,5 +55,66 @@ inline uint8_t alignForwardAdjustmentWithHeader(uintptr_t address, uint8_t align
 	return adjustment;
 }
 
+inline uint32_t countTrailingZeros(uint64_t value) {
+	assert(value != 0);
+	return static_cast<uint32_t>(__builtin_ctzll(value));
+}
+
+inline uint32_t countLeadingZeros(uint64_t value) {
+	assert(value != 0);
+	return static_cast<uint32_t>(__builtin_clzll(value));
+}
+
+// Returns the index of the first non-zero word in [begin, end) or end if there is none.
+// Empty stretches are skipped several words at a time when SIMD is available.
+inline uint32_t findNonZeroWord(const uint64_t* words, uint32_t begin, uint32_t end) {
+	uint32_t i = begin;
+
+#if defined(__AVX2__)
+	for (; i + 4 <= end; i += 4) {
+		__m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + i));
+		if (!_mm256_testz_si256(block, block)) { break; }
+	}
+#elif defined(__SSE4_1__)
+	for (; i + 2 <= end; i += 2) {
+		__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(words + i));
+		if (!_mm_testz_si128(block, block)) { break; }
+	}
+#endif
+
+	for (; i < end; ++i) {
+		if (words[i] != 0) { return i; }
+	}
+
+	return end;
+}
+
+// Returns the index of the first word in [begin, end) with a zero bit or end if there is none.
+inline uint32_t findNonFullWord(const uint64_t* words, uint32_t begin, uint32_t end) {
+	uint32_t i = begin;
+
+#if defined(__AVX2__)
+	const __m256i ones = _mm256_set1_epi64x(-1);
+
+	for (; i + 4 <= end; i += 4) {
+		__m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + i));
+		if (!_mm256_testc_si256(block, ones)) { break; }
+	}
+#elif defined(__SSE4_1__)
+	const __m128i ones = _mm_set1_epi64x(-1);
+
+	for (; i + 2 <= end; i += 2) {
+		__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(words + i));
+		if (!_mm_testc_si128(block, ones)) { break; }
+	}
+#endif
+
+	for (; i < end; ++i) {
+		if (~words[i] != 0) { return i; }
+	}
+
+	return end;
+}
+
 } // namespace allocator
 } // namespace simple
@@ -0,0 +1,245 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#pragma once
+
+#include "Allocator/Linear.h"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace simple {
+
+// Keeps request scoped LinearAllocator arenas warm between requests. Arenas are mapped with
+// MAP_POPULATE, so their pages are faulted in once when the arena is created rather than on first
+// touch in a request, and release cleans an arena and parks it for the next acquire instead of
+// unmapping it. At most maxIdle arenas are parked, anything beyond is unmapped at once; trim,
+// meant for a BackgroundTrimmer, unmaps the coldest parked arenas down to watermark. acquire and
+// release take a short lock and may be called from any thread, an arena itself is for one thread.
+class ArenaRecycler {
+public:
+	ArenaRecycler(uint32_t arenaSize, uint32_t maxIdle, uint32_t watermark);
+	~ArenaRecycler();
+
+	// Usable bytes per arena, arenaSize rounded up to whole pages minus the arena header.
+	uint32_t getArenaSize() const;
+
+	uint32_t getNumIdle() const;
+	uint32_t getNumLive() const;
+
+	// Arenas mapped over the lifetime of the recycler, each one paid its page faults once.
+	uint32_t getNumCreated() const;
+
+	// Maps arenas until count are parked, so first requests find warm ones too.
+	void prewarm(uint32_t count);
+
+	// A parked arena, most recently released first, or a freshly mapped one.
+	LinearAllocator* acquire();
+	void release(LinearAllocator* arena);
+
+	// Unmaps parked arenas above the watermark and returns the number of bytes released.
+	size_t trim();
+private:
+	ArenaRecycler(ArenaRecycler&) = delete;
+	ArenaRecycler(const ArenaRecycler&) = delete;
+
+	ArenaRecycler& operator=(ArenaRecycler&) = delete;
+	ArenaRecycler& operator=(const ArenaRecycler&) = delete;
+
+	// Lives at the start of the mapping, the LinearAllocator covers the rest.
+	struct alignas(64) Arena {
+		LinearAllocator mAllocator;
+	};
+
+	Arena* map();
+	void unmap(Arena* arena);
+
+	// Parked arenas, coldest first.
+	Arena**  mIdle;
+	uint32_t mNumIdle;
+
+	size_t   mMappingSize;
+	uint32_t mMaxIdle;
+	uint32_t mWatermark;
+
+	uint32_t mNumLive;
+	uint32_t mNumCreated;
+
+	mutable std::mutex mMutex;
+};
+
+
+inline ArenaRecycler::ArenaRecycler(uint32_t arenaSize, uint32_t maxIdle, uint32_t watermark)
+		: mIdle(nullptr)
+		, mNumIdle(0)
+		, mMappingSize(0)
+		, mMaxIdle(maxIdle)
+		, mWatermark(watermark)
+		, mNumLive(0)
+		, mNumCreated(0) {
+	assert(arenaSize > 0);
+	assert(watermark <= maxIdle);
+
+	auto pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+	mMappingSize = (sizeof(Arena) + arenaSize + pageSize - 1) & ~(pageSize - 1);
+	mIdle        = reinterpret_cast<Arena**>(std::malloc((maxIdle > 0 ? maxIdle : 1) * sizeof(Arena*)));
+}
+
+inline ArenaRecycler::~ArenaRecycler() {
+	assert(mNumLive == 0);
+
+	for (uint32_t i = 0; i < mNumIdle; ++i) { unmap(mIdle[i]); }
+
+	std::free(mIdle);
+}
+
+inline uint32_t ArenaRecycler::getArenaSize() const {
+	return static_cast<uint32_t>(mMappingSize - sizeof(Arena));
+}
+
+inline uint32_t ArenaRecycler::getNumIdle() const {
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mNumIdle;
+}
+
+inline uint32_t ArenaRecycler::getNumLive() const {
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mNumLive;
+}
+
+inline uint32_t ArenaRecycler::getNumCreated() const {
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mNumCreated;
+}
+
+inline void ArenaRecycler::prewarm(uint32_t count) {
+	assert(count <= mMaxIdle);
+
+	uint32_t numMissing = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		numMissing = mNumIdle < count ? count - mNumIdle : 0;
+	}
+
+	// Mapping and faulting happen outside of the lock, as in acquire. Releases meanwhile may
+	// fill the idle list, an arena that no longer fits is unmapped again.
+	for (uint32_t i = 0; i < numMissing; ++i) {
+		Arena* arena = map();
+		bool parked = false;
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+
+			++mNumCreated;
+
+			if (mNumIdle < mMaxIdle) {
+				mIdle[mNumIdle++] = arena;
+				parked = true;
+			}
+		}
+
+		if (!parked) { unmap(arena); }
+	}
+}
+
+inline LinearAllocator* ArenaRecycler::acquire() {
+	Arena* arena = nullptr;
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		++mNumLive;
+
+		if (mNumIdle > 0) { arena = mIdle[--mNumIdle]; }
+	}
+
+	// Mapping and faulting a new arena happens outside of the lock.
+	if (!arena) {
+		arena = map();
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		++mNumCreated;
+	}
+
+	return &arena->mAllocator;
+}
+
+inline void ArenaRecycler::release(LinearAllocator* allocator) {
+	assert(allocator);
+
+	Arena* arena = reinterpret_cast<Arena*>(allocator);
+
+	// Resets the bump pointer only, the pages stay resident.
+	arena->mAllocator.clean();
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		assert(mNumLive > 0);
+		--mNumLive;
+
+		if (mNumIdle < mMaxIdle) {
+			mIdle[mNumIdle++] = arena;
+			return;
+		}
+	}
+
+	unmap(arena);
+}
+
+inline size_t ArenaRecycler::trim() {
+	Arena* released[64];
+	uint32_t numReleased = 0;
+
+	size_t releasedSize = 0;
+
+	do {
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+
+			if (mNumIdle <= mWatermark) { break; }
+
+			numReleased = mNumIdle - mWatermark < 64 ? mNumIdle - mWatermark : 64;
+
+			// The coldest arenas sit at the bottom.
+			std::memcpy(released, mIdle, numReleased * sizeof(Arena*));
+			std::memmove(mIdle, mIdle + numReleased, (mNumIdle - numReleased) * sizeof(Arena*));
+
+			mNumIdle -= numReleased;
+		}
+
+		for (uint32_t i = 0; i < numReleased; ++i) { unmap(released[i]); }
+
+		releasedSize += numReleased * mMappingSize;
+	} while (numReleased == 64);
+
+	return releasedSize;
+}
+
+inline ArenaRecycler::Arena* ArenaRecycler::map() {
+	void* mapping = mmap(nullptr, mMappingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+
+	assert(mapping != MAP_FAILED);
+
+	auto* arena = reinterpret_cast<Arena*>(mapping);
+
+	new (&arena->mAllocator) LinearAllocator(arena + 1, getArenaSize());
+
+	return arena;
+}
+
+inline void ArenaRecycler::unmap(Arena* arena) {
+	arena->mAllocator.~LinearAllocator();
+	munmap(arena, mMappingSize);
+}
+
+} // namespace simple
@@ -0,0 +1,236 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#pragma once
+
+#include "Allocator.h"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+
+namespace simple {
+
+// Allocates runs of fixed-size blocks from a caller-provided region. All metadata lives outside
+// the region: one bit per block (set while free) plus a summary bit per bitmap word (set while
+// the word has a free block), so neither allocate nor deallocate ever touches block memory and
+// a region that is only reserved stays decommitted until the caller writes to it.
+class BitmapAllocator {
+public:
+	BitmapAllocator(void* start, uint32_t numBlocks, uint32_t blockSize);
+	~BitmapAllocator();
+
+	void clean();
+
+	uint32_t getNumBlocks() const;
+	uint32_t getNumFreeBlocks() const;
+	uint32_t getBlockSize() const;
+
+	uint32_t getIndex(const void* block) const;
+	void* getBlock(uint32_t index) const;
+
+	// Returns the lowest run of count free blocks or nullptr if there is none.
+	void* allocate(uint32_t count = 1);
+	void deallocate(void* block, uint32_t count = 1);
+private:
+	BitmapAllocator(BitmapAllocator&) = delete;
+	BitmapAllocator(const BitmapAllocator&) = delete;
+
+	BitmapAllocator& operator=(BitmapAllocator&) = delete;
+	BitmapAllocator& operator=(const BitmapAllocator&) = delete;
+
+	uint32_t findFree(uint32_t begin) const;
+	uint32_t findUsed(uint32_t begin, uint32_t end) const;
+
+	void setFree(uint32_t begin, uint32_t end, bool free);
+
+	uintptr_t mStart;
+
+	uint64_t* mFree;
+	uint64_t* mSummary;
+	uint32_t  mNumWords;
+	uint32_t  mNumSummaryWords;
+
+	uint32_t mLowestFree; // No block below it is free.
+	uint32_t mNumBlocks;
+	uint32_t mNumFreeBlocks;
+	uint32_t mBlockSize;
+};
+
+
+inline BitmapAllocator::BitmapAllocator(void* start, uint32_t numBlocks, uint32_t blockSize)
+		: mStart(reinterpret_cast<uintptr_t>(start))
+		, mFree(nullptr)
+		, mSummary(nullptr)
+		, mNumWords((numBlocks + 63) / 64)
+		, mNumSummaryWords((mNumWords + 63) / 64)
+		, mLowestFree(0)
+		, mNumBlocks(numBlocks)
+		, mNumFreeBlocks(0)
+		, mBlockSize(blockSize) {
+	assert(numBlocks > 0 && blockSize > 0);
+
+	mFree    = reinterpret_cast<uint64_t*>(std::malloc(mNumWords * sizeof(uint64_t)));
+	mSummary = reinterpret_cast<uint64_t*>(std::malloc(mNumSummaryWords * sizeof(uint64_t)));
+
+	clean();
+}
+
+inline BitmapAllocator::~BitmapAllocator() {
+	assert(mNumFreeBlocks == mNumBlocks);
+
+	std::free(mSummary);
+	std::free(mFree);
+}
+
+inline void BitmapAllocator::clean() {
+	std::memset(mFree, 0, mNumWords * sizeof(uint64_t));
+	std::memset(mSummary, 0, mNumSummaryWords * sizeof(uint64_t));
+
+	// Bits past the last block stay clear and are never handed out.
+	setFree(0, mNumBlocks, true);
+
+	mLowestFree    = 0;
+	mNumFreeBlocks = mNumBlocks;
+}
+
+inline uint32_t BitmapAllocator::getNumBlocks() const {
+	return mNumBlocks;
+}
+
+inline uint32_t BitmapAllocator::getNumFreeBlocks() const {
+	return mNumFreeBlocks;
+}
+
+inline uint32_t BitmapAllocator::getBlockSize() const {
+	return mBlockSize;
+}
+
+inline uint32_t BitmapAllocator::getIndex(const void* block) const {
+	auto offset = reinterpret_cast<uintptr_t>(block) - mStart;
+
+	assert(offset % mBlockSize == 0 && offset / mBlockSize < mNumBlocks);
+
+	return static_cast<uint32_t>(offset / mBlockSize);
+}
+
+inline void* BitmapAllocator::getBlock(uint32_t index) const {
+	assert(index < mNumBlocks);
+	return reinterpret_cast<void*>(mStart + uintptr_t(index) * mBlockSize);
+}
+
+inline void* BitmapAllocator::allocate(uint32_t count) {
+	assert(count > 0);
+
+	if (count > mNumFreeBlocks) { return nullptr; }
+
+	mLowestFree = findFree(mLowestFree);
+
+	// Jump from one free run to the next, a run ends at the first used block.
+	for (uint32_t begin = mLowestFree; begin + count <= mNumBlocks;) {
+		uint32_t end = findUsed(begin, begin + count);
+
+		if (end - begin == count) {
+			setFree(begin, end, false);
+
+			if (begin == mLowestFree) { mLowestFree = end; }
+
+			mNumFreeBlocks -= count;
+
+			return getBlock(begin);
+		}
+
+		begin = findFree(end);
+	}
+
+	return nullptr;
+}
+
+inline void BitmapAllocator::deallocate(void* block, uint32_t count) {
+	assert(block && count > 0);
+
+	uint32_t begin = getIndex(block);
+
+	assert(begin + count <= mNumBlocks);
+	assert(findFree(begin) >= begin + count && "BitmapAllocator double free");
+
+	setFree(begin, begin + count, true);
+
+	if (begin < mLowestFree) { mLowestFree = begin; }
+
+	mNumFreeBlocks += count;
+}
+
+inline uint32_t BitmapAllocator::findFree(uint32_t begin) const {
+	if (begin >= mNumBlocks) { return mNumBlocks; }
+
+	uint32_t word = begin / 64;
+	uint64_t bits = mFree[word] & (~uint64_t(0) << (begin % 64));
+
+	if (!bits) {
+		// Look for the next word with a free block in the summary, whole summary words at a time.
+		uint32_t next = word + 1;
+
+		if (next >= mNumWords) { return mNumBlocks; }
+
+		uint32_t summaryWord = next / 64;
+		uint64_t summary     = mSummary[summaryWord] & (~uint64_t(0) << (next % 64));
+
+		if (!summary) {
+			summaryWord = allocator::findNonZeroWord(mSummary, summaryWord + 1, mNumSummaryWords);
+			if (summaryWord == mNumSummaryWords) { return mNumBlocks; }
+
+			summary = mSummary[summaryWord];
+		}
+
+		word = summaryWord * 64 + allocator::countTrailingZeros(summary);
+		bits = mFree[word];
+	}
+
+	return word * 64 + allocator::countTrailingZeros(bits);
+}
+
+inline uint32_t BitmapAllocator::findUsed(uint32_t begin, uint32_t end) const {
+	// Returns the first used block in [begin, end) or end if all of them are free.
+	uint32_t word = begin / 64;
+	uint64_t bits = ~mFree[word] & (~uint64_t(0) << (begin % 64));
+
+	if (!bits) {
+		uint32_t endWord = (end + 63) / 64;
+
+		word = allocator::findNonFullWord(mFree, word + 1, endWord);
+		if (word == endWord) { return end; }
+
+		bits = ~mFree[word];
+	}
+
+	uint32_t used = word * 64 + allocator::countTrailingZeros(bits);
+
+	return used < end ? used : end;
+}
+
+inline void BitmapAllocator::setFree(uint32_t begin, uint32_t end, bool free) {
+	for (uint32_t word = begin / 64; word * 64 < end; ++word) {
+		uint32_t first = word * 64 < begin ? begin % 64 : 0;
+		uint32_t last  = (word + 1) * 64 > end ? end % 64 : 64;
+
+		uint64_t mask = (last == 64 ? ~uint64_t(0) : (uint64_t(1) << last) - 1) & (~uint64_t(0) << first);
+
+		if (free) {
+			mFree[word] |= mask;
+		} else {
+			mFree[word] &= ~mask;
+		}
+
+		uint64_t summaryBit = uint64_t(1) << (word % 64);
+
+		if (mFree[word]) {
+			mSummary[word / 64] |= summaryBit;
+		} else {
+			mSummary[word / 64] &= ~summaryBit;
+		}
+	}
+}
+
+} // namespace simple
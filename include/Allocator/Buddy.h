@@ -0,0 +1,421 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#pragma once
+
+#include "Allocator.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+namespace simple {
+
+// Binary buddy allocator over a caller-provided buffer. A block of order n is minBlockSize << n
+// bytes and starts at a multiple of its size from the start of the buffer. Free blocks of every
+// order sit in a list of their own; one bit per buddy pair holds "exactly one of the two is free",
+// so free finds out whether to merge without touching the buddy. Blocks are as aligned as the
+// start of the buffer allows.
+class BuddyAllocator {
+	struct FreeBlock {
+		FreeBlock* mNext;
+		FreeBlock* mPrevious;
+	};
+public:
+	static constexpr uint32_t MaxOrders = 32;
+
+	// With storeOrders a byte per minimal block remembers the order of every allocation, which
+	// enables free(pointer) without the order.
+	BuddyAllocator(void* start, uint32_t size, uint32_t minBlockSize = 64, bool storeOrders = false);
+	~BuddyAllocator();
+
+	void clean();
+
+	uint32_t getSize() const;
+	uint32_t getUsedMemory() const;
+	uint32_t getNumAllocations() const;
+
+	uint32_t getMinBlockSize() const;
+	uint32_t getMaxOrder() const;
+	uint32_t getNumFreeBlocks(uint32_t order) const;
+
+	// Smallest order whose blocks hold size bytes.
+	uint32_t getOrder(uint32_t size) const;
+
+	void* allocate(uint32_t order);
+	void free(void* pointer, uint32_t order);
+	void free(void* pointer);
+
+	template <typename T, typename... Args>
+	T* create(Args&&... args);
+
+	template <typename T>
+	T* createNoConstruct();
+
+	template <typename T, typename... Args>
+	T* createArray(uint32_t length, Args&&... args);
+
+	template <typename T>
+	T* createArrayNoConstruct(uint32_t length);
+
+	template <typename T>
+	void remove(T* object);
+
+	template <typename T>
+	void removeNoDestruct(T* object);
+
+	template <typename T>
+	void removeArray(T* object);
+
+	template <typename T>
+	void removeArrayNoDestruct(T* object);
+private:
+	BuddyAllocator(BuddyAllocator&) = delete;
+	BuddyAllocator(const BuddyAllocator&) = delete;
+
+	BuddyAllocator& operator=(BuddyAllocator&) = delete;
+	BuddyAllocator& operator=(const BuddyAllocator&) = delete;
+
+	template <typename T>
+	static uint32_t getArraySize(uint32_t length);
+
+	bool togglePair(uintptr_t offset, uint32_t order);
+
+	void insert(uintptr_t offset, uint32_t order);
+	void erase(uintptr_t offset, uint32_t order);
+
+	uintptr_t mStart;
+
+	FreeBlock* mFreeLists[MaxOrders];
+	uint32_t   mNumFreeBlocks[MaxOrders];
+	uint32_t   mFreeOrders; // Bit n is set while the list of order n is not empty.
+
+	uint64_t* mPairs;
+	uint32_t  mPairOffsets[MaxOrders];
+	uint32_t  mNumPairWords;
+
+	uint8_t* mOrders;
+
+	uint32_t mSize;
+	uint32_t mUsableSize;
+	uint32_t mMinBlockShift;
+	uint32_t mMaxOrder;
+	uint32_t mUsedMemory;
+	uint32_t mNumAllocations;
+};
+
+
+inline BuddyAllocator::BuddyAllocator(void* start, uint32_t size, uint32_t minBlockSize, bool storeOrders)
+		: mStart(0)
+		, mFreeLists()
+		, mNumFreeBlocks()
+		, mFreeOrders(0)
+		, mPairs(nullptr)
+		, mPairOffsets()
+		, mNumPairWords(0)
+		, mOrders(nullptr)
+		, mSize(size)
+		, mUsableSize(0)
+		, mMinBlockShift(0)
+		, mMaxOrder(0)
+		, mUsedMemory(0)
+		, mNumAllocations(0) {
+	assert(minBlockSize >= sizeof(FreeBlock) && (minBlockSize & (minBlockSize - 1)) == 0);
+
+	mMinBlockShift = allocator::countTrailingZeros(minBlockSize);
+
+	uint8_t adjustment = allocator::alignForwardAdjustment(start, alignof(FreeBlock));
+
+	assert(size >= adjustment + minBlockSize);
+
+	mStart      = reinterpret_cast<uintptr_t>(start) + adjustment;
+	mUsableSize = (size - adjustment) & ~(minBlockSize - 1);
+	mMaxOrder   = 63 - allocator::countLeadingZeros(mUsableSize) - mMinBlockShift;
+
+	// Pair bits of order n cover the range of the largest block in pairs of 2 << n minimal blocks.
+	uint32_t numBits = 0;
+
+	for (uint32_t order = 0; order < mMaxOrder; ++order) {
+		mPairOffsets[order] = numBits;
+		numBits += (mUsableSize >> (mMinBlockShift + order + 1)) + 1;
+	}
+
+	mNumPairWords = (numBits + 63) / 64;
+	mPairs = reinterpret_cast<uint64_t*>(std::malloc((mNumPairWords ? mNumPairWords : 1) * sizeof(uint64_t)));
+
+	if (storeOrders) {
+		mOrders = reinterpret_cast<uint8_t*>(std::malloc(mUsableSize >> mMinBlockShift));
+	}
+
+	clean();
+}
+
+inline BuddyAllocator::~BuddyAllocator() {
+	assert(mNumAllocations == 0 && mUsedMemory == 0);
+
+	std::free(mOrders);
+	std::free(mPairs);
+}
+
+inline void BuddyAllocator::clean() {
+	for (uint32_t order = 0; order < MaxOrders; ++order) {
+		mFreeLists[order]     = nullptr;
+		mNumFreeBlocks[order] = 0;
+	}
+
+	mFreeOrders = 0;
+
+	std::memset(mPairs, 0, mNumPairWords * sizeof(uint64_t));
+
+	// A size that is not a power of two is covered by blocks of decreasing order. Their buddies lie
+	// past the end and never become free, so they never merge.
+	uintptr_t offset = 0;
+
+	for (uint32_t order = mMaxOrder + 1; order-- > 0;) {
+		uint32_t blockSize = 1u << (mMinBlockShift + order);
+
+		if (offset + blockSize <= mUsableSize) {
+			insert(offset, order);
+			if (order < mMaxOrder) { togglePair(offset, order); }
+			offset += blockSize;
+		}
+	}
+
+	mUsedMemory     = 0;
+	mNumAllocations = 0;
+}
+
+inline uint32_t BuddyAllocator::getSize() const {
+	return mSize;
+}
+
+inline uint32_t BuddyAllocator::getUsedMemory() const {
+	return mUsedMemory;
+}
+
+inline uint32_t BuddyAllocator::getNumAllocations() const {
+	return mNumAllocations;
+}
+
+inline uint32_t BuddyAllocator::getMinBlockSize() const {
+	return 1u << mMinBlockShift;
+}
+
+inline uint32_t BuddyAllocator::getMaxOrder() const {
+	return mMaxOrder;
+}
+
+inline uint32_t BuddyAllocator::getNumFreeBlocks(uint32_t order) const {
+	assert(order <= mMaxOrder);
+	return mNumFreeBlocks[order];
+}
+
+inline uint32_t BuddyAllocator::getOrder(uint32_t size) const {
+	assert(size != 0);
+
+	if (size <= (1u << mMinBlockShift)) { return 0; }
+
+	return 64 - allocator::countLeadingZeros(size - 1) - mMinBlockShift;
+}
+
+inline void* BuddyAllocator::allocate(uint32_t order) {
+	assert(order <= mMaxOrder);
+
+	uint32_t available = mFreeOrders & (~0u << order);
+
+	assert(available && "BuddyAllocator is out of memory");
+
+	uint32_t current = allocator::countTrailingZeros(available);
+
+	auto offset = reinterpret_cast<uintptr_t>(mFreeLists[current]) - mStart;
+
+	erase(offset, current);
+	if (current < mMaxOrder) { togglePair(offset, current); }
+
+	// Split down, every upper half goes back as a free block of its own.
+	while (current > order) {
+		--current;
+
+		uintptr_t buddy = offset + (uintptr_t(1) << (mMinBlockShift + current));
+
+		insert(buddy, current);
+		togglePair(buddy, current);
+	}
+
+	if (mOrders) { mOrders[offset >> mMinBlockShift] = static_cast<uint8_t>(order); }
+
+	mUsedMemory += 1u << (mMinBlockShift + order);
+	++mNumAllocations;
+
+	return reinterpret_cast<void*>(mStart + offset);
+}
+
+inline void BuddyAllocator::free(void* pointer, uint32_t order) {
+	assert(pointer);
+	assert(order <= mMaxOrder);
+
+	uintptr_t offset = reinterpret_cast<uintptr_t>(pointer) - mStart;
+
+	assert(offset < mUsableSize);
+	assert((offset & ((uintptr_t(1) << (mMinBlockShift + order)) - 1)) == 0);
+	assert(!mOrders || mOrders[offset >> mMinBlockShift] == order);
+
+	mUsedMemory -= 1u << (mMinBlockShift + order);
+	--mNumAllocations;
+
+	// A cleared pair bit after the toggle means the buddy is free as well.
+	while (order < mMaxOrder && !togglePair(offset, order)) {
+		uintptr_t buddy = offset ^ (uintptr_t(1) << (mMinBlockShift + order));
+
+		erase(buddy, order);
+
+		offset &= ~(uintptr_t(1) << (mMinBlockShift + order));
+		++order;
+	}
+
+	insert(offset, order);
+}
+
+inline void BuddyAllocator::free(void* pointer) {
+	assert(mOrders && "BuddyAllocator::free without order needs storeOrders");
+
+	uintptr_t offset = reinterpret_cast<uintptr_t>(pointer) - mStart;
+
+	free(pointer, mOrders[offset >> mMinBlockShift]);
+}
+
+template <typename T, typename... Args>
+T* BuddyAllocator::create(Args&&... args) {
+	return new (allocate(getOrder(sizeof(T)))) T(std::forward<Args>(args)...);
+}
+
+template <typename T>
+T* BuddyAllocator::createNoConstruct() {
+	return reinterpret_cast<T*>(allocate(getOrder(sizeof(T))));
+}
+
+template <typename T, typename... Args>
+T* BuddyAllocator::createArray(uint32_t length, Args&&... args) {
+	assert(length != 0);
+
+	uint8_t headerSize = sizeof(uint32_t) / sizeof(T);
+
+	if (sizeof(uint32_t) % sizeof(T) > 0) { headerSize += 1; }
+
+	T* pointer = reinterpret_cast<T*>(allocate(getOrder(getArraySize<T>(length)))) + headerSize;
+
+	*(reinterpret_cast<uint32_t*>(pointer) - 1) = length;
+
+	for (uint32_t i = 0; i < length; ++i) {
+		new (&pointer[i]) T(std::forward<Args>(args)...);
+	}
+
+	return pointer;
+}
+
+template <typename T>
+T* BuddyAllocator::createArrayNoConstruct(uint32_t length) {
+	assert(length != 0);
+
+	uint8_t headerSize = sizeof(uint32_t) / sizeof(T);
+
+	if (sizeof(uint32_t) % sizeof(T) > 0) { headerSize += 1; }
+
+	T* pointer = reinterpret_cast<T*>(allocate(getOrder(getArraySize<T>(length)))) + headerSize;
+
+	*(reinterpret_cast<uint32_t*>(pointer) - 1) = length;
+
+	return pointer;
+}
+
+template <typename T>
+void BuddyAllocator::remove(T* object) {
+	assert(object);
+	object->~T();
+	free(object, getOrder(sizeof(T)));
+}
+
+template <typename T>
+void BuddyAllocator::removeNoDestruct(T* object) {
+	assert(object);
+	free(object, getOrder(sizeof(T)));
+}
+
+template <typename T>
+void BuddyAllocator::removeArray(T* object) {
+	assert(object);
+
+	uint32_t length = *(reinterpret_cast<uint32_t*>(object) - 1);
+
+	for (uint32_t i = 0; i < length; ++i) {
+		object[i].~T();
+	}
+
+	uint8_t headerSize = sizeof(uint32_t) / sizeof(T);
+
+	if (sizeof(uint32_t) % sizeof(T) > 0) { headerSize += 1; }
+
+	free(object - headerSize, getOrder(getArraySize<T>(length)));
+}
+
+template <typename T>
+void BuddyAllocator::removeArrayNoDestruct(T* object) {
+	assert(object);
+
+	uint32_t length = *(reinterpret_cast<uint32_t*>(object) - 1);
+
+	uint8_t headerSize = sizeof(uint32_t) / sizeof(T);
+
+	if (sizeof(uint32_t) % sizeof(T) > 0) { headerSize += 1; }
+
+	free(object - headerSize, getOrder(getArraySize<T>(length)));
+}
+
+template <typename T>
+uint32_t BuddyAllocator::getArraySize(uint32_t length) {
+	uint8_t headerSize = sizeof(uint32_t) / sizeof(T);
+
+	if (sizeof(uint32_t) % sizeof(T) > 0) { headerSize += 1; }
+
+	return sizeof(T) * (length + headerSize);
+}
+
+inline bool BuddyAllocator::togglePair(uintptr_t offset, uint32_t order) {
+	uint32_t bit = mPairOffsets[order] + static_cast<uint32_t>(offset >> (mMinBlockShift + order + 1));
+
+	mPairs[bit / 64] ^= uint64_t(1) << (bit % 64);
+
+	return (mPairs[bit / 64] >> (bit % 64)) & 1;
+}
+
+inline void BuddyAllocator::insert(uintptr_t offset, uint32_t order) {
+	auto* block = reinterpret_cast<FreeBlock*>(mStart + offset);
+
+	block->mPrevious = nullptr;
+	block->mNext     = mFreeLists[order];
+
+	if (block->mNext) { block->mNext->mPrevious = block; }
+
+	mFreeLists[order] = block;
+	mFreeOrders |= 1u << order;
+
+	++mNumFreeBlocks[order];
+}
+
+inline void BuddyAllocator::erase(uintptr_t offset, uint32_t order) {
+	auto* block = reinterpret_cast<FreeBlock*>(mStart + offset);
+
+	if (block->mPrevious) {
+		block->mPrevious->mNext = block->mNext;
+	} else {
+		mFreeLists[order] = block->mNext;
+		if (!block->mNext) { mFreeOrders &= ~(1u << order); }
+	}
+
+	if (block->mNext) { block->mNext->mPrevious = block->mPrevious; }
+
+	--mNumFreeBlocks[order];
+}
+
+} // namespace simple
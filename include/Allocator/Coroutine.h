@@ -0,0 +1,316 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#pragma once
+
+// Needs C++20 coroutines, the header is empty otherwise.
+#if defined(__cpp_impl_coroutine)
+
+#include "Allocator/Linear.h"
+#include "Allocator/Stack.h"
+
+#include <cassert>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace simple {
+
+// Source of coroutine frames: a StackAllocator when frames are destroyed in reverse order of
+// creation, as with coroutines awaited one inside the other, or a request scoped LinearAllocator
+// that drops all frames at once when it is cleaned. A frame that no longer fits into the arena
+// comes from the heap instead. Every frame carries one header in front of it that remembers where
+// it came from, so frames of all sources can be freed the same way.
+class CoroutineArena {
+public:
+	explicit CoroutineArena(StackAllocator& stack);
+	explicit CoroutineArena(LinearAllocator& linear);
+
+	// Number of frames that went to the heap because the arena was full.
+	uint32_t getNumFallbacks() const;
+
+	// The arena coroutines without an explicit one use on this thread, see CoroutineArenaScope.
+	static CoroutineArena* getCurrent();
+
+	// A null arena allocates from the heap.
+	static void* allocate(CoroutineArena* arena, size_t size);
+	static void deallocate(void* frame);
+private:
+	friend class CoroutineArenaScope;
+
+	CoroutineArena(CoroutineArena&) = delete;
+	CoroutineArena(const CoroutineArena&) = delete;
+
+	CoroutineArena& operator=(CoroutineArena&) = delete;
+	CoroutineArena& operator=(const CoroutineArena&) = delete;
+
+	struct alignas(alignof(std::max_align_t)) Block {
+		CoroutineArena* mArena; // Null for frames from the heap.
+	};
+
+	static CoroutineArena*& getCurrentSlot();
+
+	StackAllocator*  mStack;
+	LinearAllocator* mLinear;
+	uint32_t         mNumFallbacks;
+};
+
+// Makes arena the current one of the calling thread until the scope ends.
+class CoroutineArenaScope {
+public:
+	explicit CoroutineArenaScope(CoroutineArena& arena);
+	~CoroutineArenaScope();
+private:
+	CoroutineArenaScope(CoroutineArenaScope&) = delete;
+	CoroutineArenaScope(const CoroutineArenaScope&) = delete;
+
+	CoroutineArenaScope& operator=(CoroutineArenaScope&) = delete;
+	CoroutineArenaScope& operator=(const CoroutineArenaScope&) = delete;
+
+	CoroutineArena* mPrevious;
+};
+
+// Base for promise types whose frames should come from a CoroutineArena. The arena is taken from
+// a leading (std::allocator_arg, arena) pair of coroutine parameters, following *this for member
+// coroutines, and otherwise from the current CoroutineArenaScope; without either the frame comes
+// from the heap.
+struct ArenaFramePromise {
+	template <typename... Args>
+	static void* operator new(size_t size, std::allocator_arg_t, CoroutineArena& arena, const Args&...);
+
+	template <typename C, typename... Args>
+	static void* operator new(size_t size, const C&, std::allocator_arg_t, CoroutineArena& arena, const Args&...);
+
+	static void* operator new(size_t size);
+
+	static void operator delete(void* frame, size_t size);
+};
+
+// Lazily started coroutine returning a T, its frame comes from a CoroutineArena as described for
+// ArenaFramePromise. Awaiting a task runs it and resumes the awaiter once it finishes; get runs a
+// task that awaits nothing but other tasks to the end.
+template <typename T>
+class ArenaTask {
+	struct FinalAwaiter;
+public:
+	struct promise_type;
+
+	explicit ArenaTask(std::coroutine_handle<promise_type> handle);
+	ArenaTask(ArenaTask&& other) noexcept;
+	~ArenaTask();
+
+	bool await_ready() const noexcept;
+	std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept;
+	T await_resume();
+
+	T get();
+private:
+	ArenaTask(ArenaTask&) = delete;
+	ArenaTask(const ArenaTask&) = delete;
+
+	ArenaTask& operator=(ArenaTask&) = delete;
+	ArenaTask& operator=(const ArenaTask&) = delete;
+
+	std::coroutine_handle<promise_type> mHandle;
+};
+
+template <typename T>
+struct ArenaTask<T>::FinalAwaiter {
+	bool await_ready() noexcept;
+	std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept;
+	void await_resume() noexcept;
+};
+
+template <typename T>
+struct ArenaTask<T>::promise_type : ArenaFramePromise {
+	ArenaTask get_return_object();
+
+	std::suspend_always initial_suspend() noexcept;
+	FinalAwaiter final_suspend() noexcept;
+
+	void return_value(T value);
+	void unhandled_exception();
+
+	std::coroutine_handle<> mContinuation;
+	T mValue {};
+};
+
+
+inline CoroutineArena::CoroutineArena(StackAllocator& stack)
+		: mStack(&stack)
+		, mLinear(nullptr)
+		, mNumFallbacks(0) {
+}
+
+inline CoroutineArena::CoroutineArena(LinearAllocator& linear)
+		: mStack(nullptr)
+		, mLinear(&linear)
+		, mNumFallbacks(0) {
+}
+
+inline uint32_t CoroutineArena::getNumFallbacks() const {
+	return mNumFallbacks;
+}
+
+inline CoroutineArena* CoroutineArena::getCurrent() {
+	return getCurrentSlot();
+}
+
+inline void* CoroutineArena::allocate(CoroutineArena* arena, size_t size) {
+	auto length = static_cast<uint32_t>((size + sizeof(Block) - 1) / sizeof(Block)) + 1;
+
+	Block* block = nullptr;
+
+	if (arena) {
+		// Room for the length of the array and the worst case alignment of the arena.
+		size_t required = (size_t(length) + 3) * sizeof(Block);
+
+		if (arena->mStack && arena->mStack->getUsedMemory() + required <= arena->mStack->getSize()) {
+			block = arena->mStack->createArrayNoConstruct<Block>(length);
+		} else if (arena->mLinear && arena->mLinear->getUsedMemory() + required <= arena->mLinear->getSize()) {
+			block = arena->mLinear->createArrayNoConstruct<Block>(length);
+		} else {
+			++arena->mNumFallbacks;
+			arena = nullptr;
+		}
+	}
+
+	if (!block) { block = reinterpret_cast<Block*>(::operator new(length * sizeof(Block))); }
+
+	block->mArena = arena;
+
+	return block + 1;
+}
+
+inline void CoroutineArena::deallocate(void* frame) {
+	Block* block = reinterpret_cast<Block*>(frame) - 1;
+
+	CoroutineArena* arena = block->mArena;
+
+	if (!arena) {
+		::operator delete(block);
+	} else if (arena->mStack) {
+		arena->mStack->removeArrayNoDestruct(block);
+	}
+
+	// Frames of a LinearAllocator go away when it is cleaned.
+}
+
+inline CoroutineArena*& CoroutineArena::getCurrentSlot() {
+	static thread_local CoroutineArena* current = nullptr;
+	return current;
+}
+
+inline CoroutineArenaScope::CoroutineArenaScope(CoroutineArena& arena)
+		: mPrevious(CoroutineArena::getCurrentSlot()) {
+	CoroutineArena::getCurrentSlot() = &arena;
+}
+
+inline CoroutineArenaScope::~CoroutineArenaScope() {
+	CoroutineArena::getCurrentSlot() = mPrevious;
+}
+
+template <typename... Args>
+void* ArenaFramePromise::operator new(size_t size, std::allocator_arg_t, CoroutineArena& arena, const Args&...) {
+	return CoroutineArena::allocate(&arena, size);
+}
+
+template <typename C, typename... Args>
+void* ArenaFramePromise::operator new(size_t size, const C&, std::allocator_arg_t, CoroutineArena& arena, const Args&...) {
+	return CoroutineArena::allocate(&arena, size);
+}
+
+inline void* ArenaFramePromise::operator new(size_t size) {
+	return CoroutineArena::allocate(CoroutineArena::getCurrent(), size);
+}
+
+inline void ArenaFramePromise::operator delete(void* frame, size_t) {
+	CoroutineArena::deallocate(frame);
+}
+
+template <typename T>
+ArenaTask<T>::ArenaTask(std::coroutine_handle<promise_type> handle)
+		: mHandle(handle) {
+}
+
+template <typename T>
+ArenaTask<T>::ArenaTask(ArenaTask&& other) noexcept
+		: mHandle(std::exchange(other.mHandle, nullptr)) {
+}
+
+template <typename T>
+ArenaTask<T>::~ArenaTask() {
+	if (mHandle) { mHandle.destroy(); }
+}
+
+template <typename T>
+bool ArenaTask<T>::await_ready() const noexcept {
+	return false;
+}
+
+template <typename T>
+std::coroutine_handle<> ArenaTask<T>::await_suspend(std::coroutine_handle<> awaiter) noexcept {
+	mHandle.promise().mContinuation = awaiter;
+	return mHandle;
+}
+
+template <typename T>
+T ArenaTask<T>::await_resume() {
+	return std::move(mHandle.promise().mValue);
+}
+
+template <typename T>
+T ArenaTask<T>::get() {
+	mHandle.resume();
+
+	assert(mHandle.done() && "ArenaTask::get of a task that suspended on something else");
+
+	return std::move(mHandle.promise().mValue);
+}
+
+template <typename T>
+bool ArenaTask<T>::FinalAwaiter::await_ready() noexcept {
+	return false;
+}
+
+template <typename T>
+std::coroutine_handle<> ArenaTask<T>::FinalAwaiter::await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+	std::coroutine_handle<> continuation = handle.promise().mContinuation;
+	return continuation ? continuation : std::noop_coroutine();
+}
+
+template <typename T>
+void ArenaTask<T>::FinalAwaiter::await_resume() noexcept {
+}
+
+template <typename T>
+ArenaTask<T> ArenaTask<T>::promise_type::get_return_object() {
+	return ArenaTask(std::coroutine_handle<promise_type>::from_promise(*this));
+}
+
+template <typename T>
+std::suspend_always ArenaTask<T>::promise_type::initial_suspend() noexcept {
+	return {};
+}
+
+template <typename T>
+typename ArenaTask<T>::FinalAwaiter ArenaTask<T>::promise_type::final_suspend() noexcept {
+	return {};
+}
+
+template <typename T>
+void ArenaTask<T>::promise_type::return_value(T value) {
+	mValue = std::move(value);
+}
+
+template <typename T>
+void ArenaTask<T>::promise_type::unhandled_exception() {
+	std::terminate();
+}
+
+} // namespace simple
+
+#endif
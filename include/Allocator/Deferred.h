@@ -0,0 +1,191 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <cstdint>
+#include <new>
+
+namespace simple {
+namespace allocator {
+
+// Bounded single-producer single-consumer queue. Both sides are wait free: a push or pop is a
+// couple of loads and one release store, and each side rereads the other's index only when its
+// cached copy says the queue is full or empty.
+template <typename E>
+class SpscQueue {
+public:
+	SpscQueue(uint32_t capacity);
+	~SpscQueue();
+
+	uint32_t getCapacity() const;
+
+	// Approximate unless called from one of the two sides while the other one is idle.
+	uint32_t getSize() const;
+
+	bool push(const E& element);
+	bool pop(E& element);
+private:
+	SpscQueue(SpscQueue&) = delete;
+	SpscQueue(const SpscQueue&) = delete;
+
+	SpscQueue& operator=(SpscQueue&) = delete;
+	SpscQueue& operator=(const SpscQueue&) = delete;
+
+	E*       mElements;
+	uint32_t mMask;
+
+	alignas(64) std::atomic<uint32_t> mTail;
+	uint32_t mCachedHead;
+
+	alignas(64) std::atomic<uint32_t> mHead;
+	uint32_t mCachedTail;
+};
+
+
+template <typename E>
+SpscQueue<E>::SpscQueue(uint32_t capacity)
+		: mElements(nullptr)
+		, mMask(0)
+		, mTail(0)
+		, mCachedHead(0)
+		, mHead(0)
+		, mCachedTail(0) {
+	assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+
+	mElements = reinterpret_cast<E*>(std::malloc(capacity * sizeof(E)));
+	mMask     = capacity - 1;
+}
+
+template <typename E>
+SpscQueue<E>::~SpscQueue() {
+	std::free(mElements);
+}
+
+template <typename E>
+uint32_t SpscQueue<E>::getCapacity() const {
+	return mMask + 1;
+}
+
+template <typename E>
+uint32_t SpscQueue<E>::getSize() const {
+	uint32_t head = mHead.load(std::memory_order_acquire);
+	return mTail.load(std::memory_order_acquire) - head;
+}
+
+template <typename E>
+bool SpscQueue<E>::push(const E& element) {
+	uint32_t tail = mTail.load(std::memory_order_relaxed);
+
+	if (tail - mCachedHead > mMask) {
+		mCachedHead = mHead.load(std::memory_order_acquire);
+		if (tail - mCachedHead > mMask) { return false; }
+	}
+
+	new (&mElements[tail & mMask]) E(element);
+
+	mTail.store(tail + 1, std::memory_order_release);
+
+	return true;
+}
+
+template <typename E>
+bool SpscQueue<E>::pop(E& element) {
+	uint32_t head = mHead.load(std::memory_order_relaxed);
+
+	if (head == mCachedTail) {
+		mCachedTail = mTail.load(std::memory_order_acquire);
+		if (head == mCachedTail) { return false; }
+	}
+
+	element = mElements[head & mMask];
+
+	mHead.store(head + 1, std::memory_order_release);
+
+	return true;
+}
+
+} // namespace allocator
+
+// "Free later" queue for realtime threads. The realtime thread pushes released pointers together
+// with the allocator that owns them, a wait-free store into a ring; a housekeeping thread drains
+// the queue and does the actual frees, however long they take. A push fails instead of blocking
+// when the queue is full.
+class DeferredFreeQueue {
+public:
+	DeferredFreeQueue(uint32_t capacity);
+	~DeferredFreeQueue();
+
+	uint32_t getCapacity() const;
+	uint32_t getNumPending() const;
+
+	// Producer side.
+	bool push(void* pointer, void* allocator, void (*free)(void* allocator, void* pointer));
+
+	// Frees object later through allocator.remove(object), which also runs the destructor.
+	template <typename T, typename A>
+	bool pushRemove(A& allocator, T* object);
+
+	// Consumer side, returns the number of pointers freed.
+	uint32_t drain();
+private:
+	DeferredFreeQueue(DeferredFreeQueue&) = delete;
+	DeferredFreeQueue(const DeferredFreeQueue&) = delete;
+
+	DeferredFreeQueue& operator=(DeferredFreeQueue&) = delete;
+	DeferredFreeQueue& operator=(const DeferredFreeQueue&) = delete;
+
+	struct Entry {
+		void* mPointer;
+		void* mAllocator;
+		void (*mFree)(void* allocator, void* pointer);
+	};
+
+	allocator::SpscQueue<Entry> mQueue;
+};
+
+
+inline DeferredFreeQueue::DeferredFreeQueue(uint32_t capacity)
+		: mQueue(capacity) {
+}
+
+inline DeferredFreeQueue::~DeferredFreeQueue() {
+	drain();
+}
+
+inline uint32_t DeferredFreeQueue::getCapacity() const {
+	return mQueue.getCapacity();
+}
+
+inline uint32_t DeferredFreeQueue::getNumPending() const {
+	return mQueue.getSize();
+}
+
+inline bool DeferredFreeQueue::push(void* pointer, void* allocator, void (*free)(void* allocator, void* pointer)) {
+	assert(pointer && free);
+	return mQueue.push(Entry { pointer, allocator, free });
+}
+
+template <typename T, typename A>
+bool DeferredFreeQueue::pushRemove(A& allocator, T* object) {
+	return push(object, &allocator, [](void* owner, void* pointer) {
+		reinterpret_cast<A*>(owner)->remove(reinterpret_cast<T*>(pointer));
+	});
+}
+
+inline uint32_t DeferredFreeQueue::drain() {
+	uint32_t numFreed = 0;
+
+	Entry entry;
+
+	while (mQueue.pop(entry)) {
+		entry.mFree(entry.mAllocator, entry.mPointer);
+		++numFreed;
+	}
+
+	return numFreed;
+}
+
+} // namespace simple
@@ -0,0 +1,274 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#pragma once
+
+#include "Allocator/Linear.h"
+#include "Allocator/Pool.h"
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+namespace simple {
+
+// Epoch-based reclamation for lock-free data structures. Threads register once and wrap every
+// access to shared nodes in enter/exit (or call quiescent between operations). A retired node
+// goes into a per-thread bag of the current epoch; the global epoch advances once every active
+// thread has observed it, and a bag is freed two epochs after it was filled, when no thread can
+// still hold a reference. Retire touches no shared state; a bag goes back to its allocator in one
+// pass, one batch call per run of nodes with the same sink.
+class EpochReclaimer {
+public:
+	// Where retired nodes go: mFree(mContext, pointers, count) frees a whole run at once.
+	struct Sink {
+		void* mContext;
+		void (*mFree)(void* context, void* const* pointers, uint32_t count);
+	};
+
+	// Destroys retired objects through PoolAllocator::removeBatch. The pool must be safe to use
+	// from the thread that collects, as with any sink.
+	template <typename T, uint32_t Flags>
+	static Sink makeSink(PoolAllocator<T, Flags>& pool);
+
+	// Destroys retired objects and leaves their memory to LinearAllocator::clean, which must not
+	// run while nodes of the arena are still retired. StackAllocator has no sink, bags free in
+	// retire order rather than in reverse allocation order.
+	template <typename T>
+	static Sink makeSink(LinearAllocator& arena);
+
+	static constexpr uint32_t CollectThreshold = 128;
+
+	EpochReclaimer(uint32_t maxThreads);
+	~EpochReclaimer();
+
+	// Returns the slot of the calling thread, the other calls take it.
+	uint32_t registerThread();
+	void unregisterThread(uint32_t thread);
+
+	void enter(uint32_t thread);
+	void exit(uint32_t thread);
+
+	// Same as exit followed by enter, for threads that hold no references between operations.
+	void quiescent(uint32_t thread);
+
+	// Only between enter and exit. Every CollectThreshold retires the thread collects on its own.
+	void retire(uint32_t thread, void* pointer, const Sink* sink);
+
+	// Advances the epoch if every active thread has caught up and frees the bags of the calling
+	// thread that became safe. Returns the number of nodes freed.
+	uint32_t collect(uint32_t thread);
+
+	uint64_t getEpoch() const;
+	uint32_t getNumRetired(uint32_t thread) const;
+private:
+	EpochReclaimer(EpochReclaimer&) = delete;
+	EpochReclaimer(const EpochReclaimer&) = delete;
+
+	EpochReclaimer& operator=(EpochReclaimer&) = delete;
+	EpochReclaimer& operator=(const EpochReclaimer&) = delete;
+
+	struct Bag {
+		std::vector<void*>       mPointers;
+		std::vector<const Sink*> mSinks;
+		uint64_t                 mEpoch;
+	};
+
+	struct alignas(64) Participant {
+		std::atomic<uint64_t> mState; // Epoch << 1 | 1 while inside a critical section.
+		std::atomic<bool>     mRegistered;
+		uint32_t              mNumSinceCollect;
+		Bag                   mBags[3];
+	};
+
+	bool tryAdvance(uint64_t epoch);
+
+	static uint32_t freeBag(Bag& bag);
+
+	Participant* mParticipants;
+	uint32_t     mMaxThreads;
+
+	alignas(64) std::atomic<uint64_t> mEpoch;
+};
+
+
+template <typename T, uint32_t Flags>
+EpochReclaimer::Sink EpochReclaimer::makeSink(PoolAllocator<T, Flags>& pool) {
+	return Sink { &pool, [](void* context, void* const* pointers, uint32_t count) {
+		reinterpret_cast<PoolAllocator<T, Flags>*>(context)->removeBatch(reinterpret_cast<T* const*>(pointers), count);
+	} };
+}
+
+template <typename T>
+EpochReclaimer::Sink EpochReclaimer::makeSink(LinearAllocator& arena) {
+	return Sink { &arena, [](void*, void* const* pointers, uint32_t count) {
+		for (uint32_t i = 0; i < count; ++i) { reinterpret_cast<T*>(pointers[i])->~T(); }
+	} };
+}
+
+inline EpochReclaimer::EpochReclaimer(uint32_t maxThreads)
+		: mParticipants(nullptr)
+		, mMaxThreads(maxThreads)
+		, mEpoch(1) {
+	assert(maxThreads > 0);
+
+	mParticipants = reinterpret_cast<Participant*>(std::aligned_alloc(alignof(Participant), maxThreads * sizeof(Participant)));
+
+	for (uint32_t i = 0; i < maxThreads; ++i) {
+		Participant* participant = new (&mParticipants[i]) Participant;
+
+		participant->mState.store(0, std::memory_order_relaxed);
+		participant->mRegistered.store(false, std::memory_order_relaxed);
+		participant->mNumSinceCollect = 0;
+
+		// Collecting every CollectThreshold retires keeps bags about this size, so retire does
+		// not reallocate in steady state.
+		for (Bag& bag : participant->mBags) {
+			bag.mPointers.reserve(CollectThreshold);
+			bag.mSinks.reserve(CollectThreshold);
+			bag.mEpoch = 0;
+		}
+	}
+}
+
+inline EpochReclaimer::~EpochReclaimer() {
+	for (uint32_t i = 0; i < mMaxThreads; ++i) {
+		assert(!(mParticipants[i].mState.load(std::memory_order_relaxed) & 1));
+
+		for (Bag& bag : mParticipants[i].mBags) { freeBag(bag); }
+
+		mParticipants[i].~Participant();
+	}
+
+	std::free(mParticipants);
+}
+
+inline uint32_t EpochReclaimer::registerThread() {
+	for (uint32_t i = 0; i < mMaxThreads; ++i) {
+		bool registered = false;
+
+		if (mParticipants[i].mRegistered.compare_exchange_strong(registered, true, std::memory_order_acquire)) {
+			return i;
+		}
+	}
+
+	assert(false && "EpochReclaimer has no free thread slot");
+	return mMaxThreads;
+}
+
+inline void EpochReclaimer::unregisterThread(uint32_t thread) {
+	assert(!(mParticipants[thread].mState.load(std::memory_order_relaxed) & 1));
+
+	// Bags that are left stay with the slot for its next thread or the destructor.
+	mParticipants[thread].mRegistered.store(false, std::memory_order_release);
+}
+
+inline void EpochReclaimer::enter(uint32_t thread) {
+	Participant& participant = mParticipants[thread];
+
+	participant.mState.store(mEpoch.load(std::memory_order_relaxed) << 1 | 1, std::memory_order_relaxed);
+
+	// The announcement must be visible before any shared node is read.
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+inline void EpochReclaimer::exit(uint32_t thread) {
+	Participant& participant = mParticipants[thread];
+
+	participant.mState.store(participant.mState.load(std::memory_order_relaxed) & ~uint64_t(1), std::memory_order_release);
+}
+
+inline void EpochReclaimer::quiescent(uint32_t thread) {
+	exit(thread);
+	enter(thread);
+}
+
+inline void EpochReclaimer::retire(uint32_t thread, void* pointer, const Sink* sink) {
+	Participant& participant = mParticipants[thread];
+
+	assert((participant.mState.load(std::memory_order_relaxed) & 1) && "EpochReclaimer::retire outside of enter/exit");
+
+	// The thread may be pinned one epoch behind the global one, and a reader pinned at the global
+	// epoch may still hold the node. Tag it with the global epoch, read after the node was unlinked.
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	uint64_t epoch = mEpoch.load(std::memory_order_relaxed);
+	Bag& bag = participant.mBags[epoch % 3];
+
+	// A bag from three epochs ago is safe by now.
+	if (bag.mEpoch != epoch) {
+		freeBag(bag);
+		bag.mEpoch = epoch;
+	}
+
+	bag.mPointers.push_back(pointer);
+	bag.mSinks.push_back(sink);
+
+	if (++participant.mNumSinceCollect >= CollectThreshold) { collect(thread); }
+}
+
+inline uint32_t EpochReclaimer::collect(uint32_t thread) {
+	Participant& participant = mParticipants[thread];
+
+	participant.mNumSinceCollect = 0;
+
+	uint64_t epoch = mEpoch.load(std::memory_order_acquire);
+
+	if (tryAdvance(epoch)) { epoch = mEpoch.load(std::memory_order_acquire); }
+
+	uint32_t numFreed = 0;
+
+	for (Bag& bag : participant.mBags) {
+		if (!bag.mPointers.empty() && bag.mEpoch + 2 <= epoch) { numFreed += freeBag(bag); }
+	}
+
+	return numFreed;
+}
+
+inline uint64_t EpochReclaimer::getEpoch() const {
+	return mEpoch.load(std::memory_order_relaxed);
+}
+
+inline uint32_t EpochReclaimer::getNumRetired(uint32_t thread) const {
+	uint32_t numRetired = 0;
+
+	for (const Bag& bag : mParticipants[thread].mBags) { numRetired += static_cast<uint32_t>(bag.mPointers.size()); }
+
+	return numRetired;
+}
+
+inline bool EpochReclaimer::tryAdvance(uint64_t epoch) {
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	for (uint32_t i = 0; i < mMaxThreads; ++i) {
+		uint64_t state = mParticipants[i].mState.load(std::memory_order_acquire);
+
+		if ((state & 1) && (state >> 1) != epoch) { return false; }
+	}
+
+	return mEpoch.compare_exchange_strong(epoch, epoch + 1, std::memory_order_acq_rel);
+}
+
+inline uint32_t EpochReclaimer::freeBag(Bag& bag) {
+	auto count = static_cast<uint32_t>(bag.mPointers.size());
+
+	// One call per run of nodes that share a sink, usually the whole bag.
+	for (uint32_t begin = 0; begin < count;) {
+		uint32_t end = begin + 1;
+
+		while (end < count && bag.mSinks[end] == bag.mSinks[begin]) { ++end; }
+
+		bag.mSinks[begin]->mFree(bag.mSinks[begin]->mContext, bag.mPointers.data() + begin, end - begin);
+
+		begin = end;
+	}
+
+	bag.mPointers.clear();
+	bag.mSinks.clear();
+
+	return count;
+}
+
+} // namespace simple
@@ -0,0 +1,166 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace simple {
+
+// Pool of fiber stacks carved from one reserved region, every stack sitting between two
+// PROT_NONE guard pages so an overflow faults instead of running into the neighbour. All mapping
+// and protection happens in the constructor; allocate pops an index off an out-of-band free list
+// and deallocate pushes it back, most recently used first. deallocate decommits the part of the
+// stack below its top retainedSize bytes, where stacks grow down from, so returned stacks keep
+// only their hot pages resident. Each stack is its own mapping as far as the kernel is concerned,
+// which bounds numStacks by vm.max_map_count / 2. Stacks the constructor cannot map or protect are
+// left out of getNumTotalStacks, so allocate returns nullptr early instead of handing them out.
+class FiberStackAllocator {
+public:
+	FiberStackAllocator(uint32_t numStacks, size_t stackSize, size_t retainedSize = 0);
+	~FiberStackAllocator();
+
+	uint32_t getNumTotalStacks() const;
+	uint32_t getNumFreeStacks() const;
+
+	// Usable size, stackSize rounded up to whole pages.
+	size_t getStackSize() const;
+
+	uint32_t getIndex(const void* stack) const;
+	bool owns(const void* pointer) const;
+
+	// Lowest address of a free stack, or nullptr when all are in use. The fiber starts at
+	// getTop(stack).
+	void* allocate();
+	void deallocate(void* stack);
+
+	void* getTop(void* stack) const;
+private:
+	FiberStackAllocator(FiberStackAllocator&) = delete;
+	FiberStackAllocator(const FiberStackAllocator&) = delete;
+
+	FiberStackAllocator& operator=(FiberStackAllocator&) = delete;
+	FiberStackAllocator& operator=(const FiberStackAllocator&) = delete;
+
+	uintptr_t getStack(uint32_t index) const;
+
+	void*  mMemory;
+	size_t mMappingSize;
+
+	uint32_t* mFreeStacks;
+
+	size_t mPageSize;
+	size_t mStackSize;
+	size_t mSlotSize; // Guard page and stack.
+	size_t mRetainedSize;
+
+	uint32_t mNumTotalStacks;
+	uint32_t mNumFreeStacks;
+};
+
+
+inline FiberStackAllocator::FiberStackAllocator(uint32_t numStacks, size_t stackSize, size_t retainedSize)
+		: mMemory(nullptr)
+		, mMappingSize(0)
+		, mFreeStacks(nullptr)
+		, mPageSize(static_cast<size_t>(sysconf(_SC_PAGESIZE)))
+		, mStackSize(0)
+		, mSlotSize(0)
+		, mRetainedSize(0)
+		, mNumTotalStacks(numStacks)
+		, mNumFreeStacks(numStacks) {
+	assert(numStacks > 0 && stackSize > 0);
+
+	mStackSize    = (stackSize + mPageSize - 1) & ~(mPageSize - 1);
+	mSlotSize     = mPageSize + mStackSize;
+	mRetainedSize = retainedSize < mStackSize ? (retainedSize + mPageSize - 1) & ~(mPageSize - 1) : mStackSize;
+
+	// A guard page below every stack and one above the last.
+	mMappingSize = mSlotSize * numStacks + mPageSize;
+
+	mMemory = mmap(nullptr, mMappingSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+	if (mMemory == MAP_FAILED) {
+		mMemory         = nullptr;
+		mMappingSize    = 0;
+		mNumTotalStacks = mNumFreeStacks = 0;
+		return;
+	}
+
+	for (uint32_t i = 0; i < numStacks; ++i) {
+		// Out of mappings, see vm.max_map_count; the stacks set up so far stay usable.
+		if (mprotect(reinterpret_cast<void*>(getStack(i)), mStackSize, PROT_READ | PROT_WRITE) != 0) {
+			mNumTotalStacks = mNumFreeStacks = numStacks = i;
+			break;
+		}
+	}
+
+	// Lowest stacks on top of the free list.
+	mFreeStacks = reinterpret_cast<uint32_t*>(std::malloc((numStacks > 0 ? numStacks : 1) * sizeof(uint32_t)));
+
+	for (uint32_t i = 0; i < numStacks; ++i) { mFreeStacks[i] = numStacks - 1 - i; }
+}
+
+inline FiberStackAllocator::~FiberStackAllocator() {
+	assert(mNumFreeStacks == mNumTotalStacks);
+
+	if (mMemory) { munmap(mMemory, mMappingSize); }
+	std::free(mFreeStacks);
+}
+
+inline uint32_t FiberStackAllocator::getNumTotalStacks() const {
+	return mNumTotalStacks;
+}
+
+inline uint32_t FiberStackAllocator::getNumFreeStacks() const {
+	return mNumFreeStacks;
+}
+
+inline size_t FiberStackAllocator::getStackSize() const {
+	return mStackSize;
+}
+
+inline uint32_t FiberStackAllocator::getIndex(const void* stack) const {
+	assert(owns(stack));
+	return static_cast<uint32_t>((reinterpret_cast<uintptr_t>(stack) - reinterpret_cast<uintptr_t>(mMemory)) / mSlotSize);
+}
+
+inline bool FiberStackAllocator::owns(const void* pointer) const {
+	auto address = reinterpret_cast<uintptr_t>(pointer);
+	auto begin   = reinterpret_cast<uintptr_t>(mMemory);
+
+	return address >= begin && address < begin + mMappingSize;
+}
+
+inline void* FiberStackAllocator::allocate() {
+	if (mNumFreeStacks == 0) { return nullptr; }
+
+	return reinterpret_cast<void*>(getStack(mFreeStacks[--mNumFreeStacks]));
+}
+
+inline void FiberStackAllocator::deallocate(void* stack) {
+	uint32_t index = getIndex(stack);
+
+	assert(reinterpret_cast<uintptr_t>(stack) == getStack(index));
+	assert(mNumFreeStacks < mNumTotalStacks);
+
+	// Pages never touched are skipped by the kernel, so this costs little for shallow fibers.
+	if (mRetainedSize < mStackSize) { madvise(stack, mStackSize - mRetainedSize, MADV_DONTNEED); }
+
+	mFreeStacks[mNumFreeStacks++] = index;
+}
+
+inline void* FiberStackAllocator::getTop(void* stack) const {
+	return reinterpret_cast<uint8_t*>(stack) + mStackSize;
+}
+
+inline uintptr_t FiberStackAllocator::getStack(uint32_t index) const {
+	return reinterpret_cast<uintptr_t>(mMemory) + index * mSlotSize + mPageSize;
+}
+
+} // namespace simple
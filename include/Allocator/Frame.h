@@ -0,0 +1,158 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#pragma once
+
+#include "Allocator/Linear.h"
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <utility>
+
+namespace simple {
+
+// Multi-buffered per-frame allocator for a pipeline with numFrames frames in flight. Every frame
+// allocates from its own LinearAllocator, so data of frame k stays valid until frame k retires
+// (its fence signalled) and is reset only when frame k + numFrames begins in the same arena.
+// Frames retire in order; retire may be called from another thread, the rest from the frame
+// thread only.
+class FrameAllocator {
+public:
+	// The frames share start, which must hold numFrames * frameSize bytes.
+	FrameAllocator(void* start, uint32_t frameSize, uint32_t numFrames);
+	~FrameAllocator();
+
+	// Moves to the next frame and resets its arena. Returns false and stays on the current frame
+	// while the frame that last used that arena has not retired yet.
+	bool beginFrame();
+
+	// Marks frame and every frame before it as retired, for example from a fence callback.
+	void retire(uint64_t frame);
+
+	bool isRetired(uint64_t frame) const;
+
+	uint64_t getFrame() const;
+	uint32_t getNumFrames() const;
+	uint32_t getNumFramesInFlight() const;
+
+	LinearAllocator& getArena();
+
+	template <typename T, typename... Args>
+	T* create(Args&&... args);
+
+	template <typename T>
+	T* createNoConstruct();
+
+	template <typename T, typename... Args>
+	T* createArray(uint32_t length, Args&&... args);
+
+	template <typename T>
+	T* createArrayNoConstruct(uint32_t length);
+private:
+	FrameAllocator(FrameAllocator&) = delete;
+	FrameAllocator(const FrameAllocator&) = delete;
+
+	FrameAllocator& operator=(FrameAllocator&) = delete;
+	FrameAllocator& operator=(const FrameAllocator&) = delete;
+
+	LinearAllocator* mArenas;
+	uint32_t         mNumFrames;
+
+	uint64_t mFrame;
+
+	std::atomic<uint64_t> mNumRetired; // Frames [0, mNumRetired) are retired.
+};
+
+
+inline FrameAllocator::FrameAllocator(void* start, uint32_t frameSize, uint32_t numFrames)
+		: mArenas(nullptr)
+		, mNumFrames(numFrames)
+		, mFrame(0)
+		, mNumRetired(0) {
+	assert(numFrames > 0);
+
+	mArenas = reinterpret_cast<LinearAllocator*>(std::malloc(numFrames * sizeof(LinearAllocator)));
+
+	auto position = reinterpret_cast<uintptr_t>(start);
+
+	for (uint32_t i = 0; i < numFrames; ++i) {
+		new (&mArenas[i]) LinearAllocator(reinterpret_cast<void*>(position), frameSize);
+		position += frameSize;
+	}
+}
+
+inline FrameAllocator::~FrameAllocator() {
+	for (uint32_t i = 0; i < mNumFrames; ++i) {
+		mArenas[i].clean();
+		mArenas[i].~LinearAllocator();
+	}
+
+	std::free(mArenas);
+}
+
+inline bool FrameAllocator::beginFrame() {
+	uint64_t frame = mFrame + 1;
+
+	// The arena was last used by frame - mNumFrames.
+	if (frame >= mNumRetired.load(std::memory_order_acquire) + mNumFrames) { return false; }
+
+	mFrame = frame;
+	mArenas[frame % mNumFrames].clean();
+
+	return true;
+}
+
+inline void FrameAllocator::retire(uint64_t frame) {
+	uint64_t numRetired = mNumRetired.load(std::memory_order_relaxed);
+
+	while (numRetired < frame + 1) {
+		if (mNumRetired.compare_exchange_weak(numRetired, frame + 1, std::memory_order_release, std::memory_order_relaxed)) {
+			break;
+		}
+	}
+}
+
+inline bool FrameAllocator::isRetired(uint64_t frame) const {
+	return frame < mNumRetired.load(std::memory_order_acquire);
+}
+
+inline uint64_t FrameAllocator::getFrame() const {
+	return mFrame;
+}
+
+inline uint32_t FrameAllocator::getNumFrames() const {
+	return mNumFrames;
+}
+
+inline uint32_t FrameAllocator::getNumFramesInFlight() const {
+	uint64_t numRetired = mNumRetired.load(std::memory_order_acquire);
+	return numRetired > mFrame ? 0 : static_cast<uint32_t>(mFrame + 1 - numRetired);
+}
+
+inline LinearAllocator& FrameAllocator::getArena() {
+	return mArenas[mFrame % mNumFrames];
+}
+
+template <typename T, typename... Args>
+T* FrameAllocator::create(Args&&... args) {
+	return getArena().create<T>(std::forward<Args>(args)...);
+}
+
+template <typename T>
+T* FrameAllocator::createNoConstruct() {
+	return getArena().createNoConstruct<T>();
+}
+
+template <typename T, typename... Args>
+T* FrameAllocator::createArray(uint32_t length, Args&&... args) {
+	return getArena().createArray<T>(length, std::forward<Args>(args)...);
+}
+
+template <typename T>
+T* FrameAllocator::createArrayNoConstruct(uint32_t length) {
+	return getArena().createArrayNoConstruct<T>(length);
+}
+
+} // namespace simple
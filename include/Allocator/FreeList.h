@@ -0,0 +1,405 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#pragma once
+
+#include "Allocator.h"
+
+#include <cassert>
+#include <cstdint>
+#include <utility>
+
+namespace simple {
+
+// General-purpose allocator over a caller-provided buffer: variable sizes, freed in any order.
+// Every block starts with a header holding its own size and the size of the block before it, so
+// a freed block merges with both neighbours in O(1). Free blocks form an explicit doubly linked list.
+class FreeListAllocator {
+	struct Block {
+		uint32_t mSize;         // Whole block including the header, AllocatedBit set while in use.
+		uint32_t mPreviousSize; // 0 for the first block.
+	};
+
+	struct FreeBlock : Block {
+		FreeBlock* mNext;
+		FreeBlock* mPrevious;
+	};
+public:
+	enum class Policy {
+		FirstFit,
+		BestFit,
+	};
+
+	FreeListAllocator(void* start, uint32_t size, Policy policy = Policy::FirstFit);
+	~FreeListAllocator();
+
+	void clean();
+
+	uint32_t getSize() const;
+	uint32_t getUsedMemory() const;
+	uint32_t getNumAllocations() const;
+	uint32_t getNumFreeBlocks() const;
+
+	void* allocate(uint32_t size, uint8_t alignment);
+	void deallocate(void* pointer);
+
+	template <typename T, typename... Args>
+	T* create(Args&&... args);
+
+	template <typename T>
+	T* createNoConstruct();
+
+	template <typename T, typename... Args>
+	T* createArray(uint32_t length, Args&&... args);
+
+	template <typename T>
+	T* createArrayNoConstruct(uint32_t length);
+
+	template <typename T>
+	void remove(T* object);
+
+	template <typename T>
+	void removeNoDestruct(T* object);
+
+	template <typename T>
+	void removeArray(T* object);
+
+	template <typename T>
+	void removeArrayNoDestruct(T* object);
+private:
+	FreeListAllocator(FreeListAllocator&) = delete;
+	FreeListAllocator(const FreeListAllocator&) = delete;
+
+	FreeListAllocator& operator=(FreeListAllocator&) = delete;
+	FreeListAllocator& operator=(const FreeListAllocator&) = delete;
+
+	static constexpr uint32_t Granularity  = 8;
+	static constexpr uint32_t AllocatedBit = 1;
+	static constexpr uint32_t MinBlockSize = (sizeof(FreeBlock) + Granularity - 1) & ~(Granularity - 1);
+
+	static uint32_t getBlockSize(const Block* block);
+	static bool isAllocated(const Block* block);
+	static Block* getNextBlock(Block* block);
+	static uint32_t getPadding(const Block* block, uint32_t alignment);
+
+	FreeBlock* findFirstFit(uint32_t size, uint32_t alignment) const;
+	FreeBlock* findBestFit(uint32_t size, uint32_t alignment) const;
+
+	void insert(FreeBlock* block);
+	void erase(FreeBlock* block);
+
+	uintptr_t mStart;
+	uintptr_t mEnd;
+
+	FreeBlock* mFreeList;
+	Policy     mPolicy;
+
+	uint32_t mSize;
+	uint32_t mUsedMemory;
+	uint32_t mNumAllocations;
+	uint32_t mNumFreeBlocks;
+};
+
+
+inline FreeListAllocator::FreeListAllocator(void* start, uint32_t size, Policy policy)
+		: mStart(0)
+		, mEnd(0)
+		, mFreeList(nullptr)
+		, mPolicy(policy)
+		, mSize(size)
+		, mUsedMemory(0)
+		, mNumAllocations(0)
+		, mNumFreeBlocks(0) {
+	uint8_t adjustment = allocator::alignForwardAdjustment(start, Granularity);
+
+	assert(size >= adjustment + MinBlockSize + sizeof(Block));
+
+	mStart = reinterpret_cast<uintptr_t>(start) + adjustment;
+	mEnd   = mStart + ((size - adjustment - sizeof(Block)) & ~(Granularity - 1));
+
+	clean();
+}
+
+inline FreeListAllocator::~FreeListAllocator() {
+	assert(mNumAllocations == 0 && mUsedMemory == 0);
+}
+
+inline void FreeListAllocator::clean() {
+	auto* block = reinterpret_cast<FreeBlock*>(mStart);
+
+	block->mSize         = static_cast<uint32_t>(mEnd - mStart);
+	block->mPreviousSize = 0;
+
+	// The sentinel at the end is a zero-sized allocated block, so merging never runs past it.
+	auto* sentinel = reinterpret_cast<Block*>(mEnd);
+
+	sentinel->mSize         = AllocatedBit;
+	sentinel->mPreviousSize = block->mSize;
+
+	mFreeList      = nullptr;
+	mNumFreeBlocks = 0;
+
+	insert(block);
+
+	mUsedMemory     = 0;
+	mNumAllocations = 0;
+}
+
+inline uint32_t FreeListAllocator::getSize() const {
+	return mSize;
+}
+
+inline uint32_t FreeListAllocator::getUsedMemory() const {
+	return mUsedMemory;
+}
+
+inline uint32_t FreeListAllocator::getNumAllocations() const {
+	return mNumAllocations;
+}
+
+inline uint32_t FreeListAllocator::getNumFreeBlocks() const {
+	return mNumFreeBlocks;
+}
+
+inline void* FreeListAllocator::allocate(uint32_t size, uint8_t alignment) {
+	assert(size != 0);
+	assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+
+	uint32_t align = alignment < Granularity ? Granularity : alignment;
+	uint32_t needed = ((size + Granularity - 1) & ~(Granularity - 1)) + sizeof(Block);
+
+	if (needed < MinBlockSize) { needed = MinBlockSize; }
+
+	FreeBlock* block = mPolicy == Policy::FirstFit ? findFirstFit(needed, align) : findBestFit(needed, align);
+
+	assert(block && "FreeListAllocator is out of memory");
+
+	erase(block);
+
+	Block* allocated = block;
+
+	// Alignment padding in front becomes a free block of its own.
+	uint32_t padding = getPadding(block, align);
+
+	if (padding > 0) {
+		allocated = reinterpret_cast<Block*>(reinterpret_cast<uintptr_t>(block) + padding);
+
+		allocated->mSize         = block->mSize - padding;
+		allocated->mPreviousSize = padding;
+
+		block->mSize = padding;
+		insert(block);
+
+		getNextBlock(allocated)->mPreviousSize = allocated->mSize;
+	}
+
+	uint32_t remainder = allocated->mSize - needed;
+
+	if (remainder >= MinBlockSize) {
+		auto* tail = reinterpret_cast<FreeBlock*>(reinterpret_cast<uintptr_t>(allocated) + needed);
+
+		tail->mSize         = remainder;
+		tail->mPreviousSize = needed;
+
+		getNextBlock(tail)->mPreviousSize = remainder;
+
+		allocated->mSize = needed;
+		insert(tail);
+	}
+
+	mUsedMemory += allocated->mSize;
+	++mNumAllocations;
+
+	allocated->mSize |= AllocatedBit;
+
+	return allocated + 1;
+}
+
+inline void FreeListAllocator::deallocate(void* pointer) {
+	assert(pointer);
+
+	Block* block = reinterpret_cast<Block*>(pointer) - 1;
+
+	assert(reinterpret_cast<uintptr_t>(block) >= mStart && reinterpret_cast<uintptr_t>(block) < mEnd);
+	assert(isAllocated(block));
+
+	block->mSize &= ~AllocatedBit;
+
+	mUsedMemory -= block->mSize;
+	--mNumAllocations;
+
+	Block* next = getNextBlock(block);
+
+	if (!isAllocated(next)) {
+		erase(static_cast<FreeBlock*>(next));
+		block->mSize += next->mSize;
+	}
+
+	if (block->mPreviousSize != 0) {
+		Block* previous = reinterpret_cast<Block*>(reinterpret_cast<uintptr_t>(block) - block->mPreviousSize);
+
+		if (!isAllocated(previous)) {
+			erase(static_cast<FreeBlock*>(previous));
+			previous->mSize += block->mSize;
+			block = previous;
+		}
+	}
+
+	getNextBlock(block)->mPreviousSize = block->mSize;
+
+	insert(static_cast<FreeBlock*>(block));
+}
+
+template <typename T, typename... Args>
+T* FreeListAllocator::create(Args&&... args) {
+	return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+}
+
+template <typename T>
+T* FreeListAllocator::createNoConstruct() {
+	return reinterpret_cast<T*>(allocate(sizeof(T), alignof(T)));
+}
+
+template <typename T, typename... Args>
+T* FreeListAllocator::createArray(uint32_t length, Args&&... args) {
+	assert(length != 0);
+
+	uint8_t headerSize = sizeof(uint32_t) / sizeof(T);
+
+	if (sizeof(uint32_t) % sizeof(T) > 0) { headerSize += 1; }
+
+	T* pointer = reinterpret_cast<T*>(allocate(sizeof(T) * (length + headerSize), alignof(T))) + headerSize;
+
+	*(reinterpret_cast<uint32_t*>(pointer) - 1) = length;
+
+	for (uint32_t i = 0; i < length; ++i) {
+		new (&pointer[i]) T(std::forward<Args>(args)...);
+	}
+
+	return pointer;
+}
+
+template <typename T>
+T* FreeListAllocator::createArrayNoConstruct(uint32_t length) {
+	assert(length != 0);
+
+	uint8_t headerSize = sizeof(uint32_t) / sizeof(T);
+
+	if (sizeof(uint32_t) % sizeof(T) > 0) { headerSize += 1; }
+
+	T* pointer = reinterpret_cast<T*>(allocate(sizeof(T) * (length + headerSize), alignof(T))) + headerSize;
+
+	*(reinterpret_cast<uint32_t*>(pointer) - 1) = length;
+
+	return pointer;
+}
+
+template <typename T>
+void FreeListAllocator::remove(T* object) {
+	assert(object);
+	object->~T();
+	deallocate(object);
+}
+
+template <typename T>
+void FreeListAllocator::removeNoDestruct(T* object) {
+	assert(object);
+	deallocate(object);
+}
+
+template <typename T>
+void FreeListAllocator::removeArray(T* object) {
+	assert(object);
+
+	uint32_t length = *(reinterpret_cast<uint32_t*>(object) - 1);
+
+	for (uint32_t i = 0; i < length; ++i) {
+		object[i].~T();
+	}
+
+	uint8_t headerSize = sizeof(uint32_t) / sizeof(T);
+
+	if (sizeof(uint32_t) % sizeof(T) > 0) { headerSize += 1; }
+
+	deallocate(object - headerSize);
+}
+
+template <typename T>
+void FreeListAllocator::removeArrayNoDestruct(T* object) {
+	assert(object);
+
+	uint8_t headerSize = sizeof(uint32_t) / sizeof(T);
+
+	if (sizeof(uint32_t) % sizeof(T) > 0) { headerSize += 1; }
+
+	deallocate(object - headerSize);
+}
+
+inline uint32_t FreeListAllocator::getBlockSize(const Block* block) {
+	return block->mSize & ~AllocatedBit;
+}
+
+inline bool FreeListAllocator::isAllocated(const Block* block) {
+	return (block->mSize & AllocatedBit) != 0;
+}
+
+inline FreeListAllocator::Block* FreeListAllocator::getNextBlock(Block* block) {
+	return reinterpret_cast<Block*>(reinterpret_cast<uintptr_t>(block) + getBlockSize(block));
+}
+
+inline uint32_t FreeListAllocator::getPadding(const Block* block, uint32_t alignment) {
+	// A gap in front of the aligned block has to be big enough to stand as a free block itself.
+	auto data = reinterpret_cast<uintptr_t>(block + 1);
+	uint32_t padding = static_cast<uint32_t>(((data + alignment - 1) & ~uintptr_t(alignment - 1)) - data);
+
+	while (padding != 0 && padding < MinBlockSize) { padding += alignment; }
+
+	return padding;
+}
+
+inline FreeListAllocator::FreeBlock* FreeListAllocator::findFirstFit(uint32_t size, uint32_t alignment) const {
+	for (FreeBlock* block = mFreeList; block; block = block->mNext) {
+		if (getPadding(block, alignment) + size <= block->mSize) { return block; }
+	}
+
+	return nullptr;
+}
+
+inline FreeListAllocator::FreeBlock* FreeListAllocator::findBestFit(uint32_t size, uint32_t alignment) const {
+	FreeBlock* best = nullptr;
+
+	for (FreeBlock* block = mFreeList; block; block = block->mNext) {
+		uint32_t needed = getPadding(block, alignment) + size;
+
+		if (needed <= block->mSize && (!best || block->mSize < best->mSize)) {
+			best = block;
+			if (needed == block->mSize) { break; }
+		}
+	}
+
+	return best;
+}
+
+inline void FreeListAllocator::insert(FreeBlock* block) {
+	block->mPrevious = nullptr;
+	block->mNext     = mFreeList;
+
+	if (mFreeList) { mFreeList->mPrevious = block; }
+
+	mFreeList = block;
+
+	++mNumFreeBlocks;
+}
+
+inline void FreeListAllocator::erase(FreeBlock* block) {
+	if (block->mPrevious) {
+		block->mPrevious->mNext = block->mNext;
+	} else {
+		mFreeList = block->mNext;
+	}
+
+	if (block->mNext) { block->mNext->mPrevious = block->mPrevious; }
+
+	--mNumFreeBlocks;
+}
+
+} // namespace simple
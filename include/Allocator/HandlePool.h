@@ -0,0 +1,271 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#pragma once
+
+#include "Allocator.h"
+#include "Allocator/Pool.h"
+
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <cstdint>
+#include <utility>
+
+namespace simple {
+
+// Pool that hands out 32-bit handles (slot index + generation) instead of raw pointers.
+// Objects live in one contiguous PoolAllocator block; handles go through a slot table,
+// so a stale handle is detected in O(1) and objects can be moved without invalidating handles.
+template <typename T, uint32_t IndexBits = 20>
+class HandlePoolAllocator {
+	static_assert(IndexBits > 0 && IndexBits < 32, "IndexBits must leave room for the generation");
+public:
+	class Handle {
+	public:
+		Handle();
+
+		uint32_t getIndex() const;
+		uint32_t getGeneration() const;
+		uint32_t getValue() const;
+
+		bool isNull() const;
+
+		bool operator==(Handle other) const;
+		bool operator!=(Handle other) const;
+	private:
+		friend class HandlePoolAllocator;
+
+		Handle(uint32_t index, uint32_t generation);
+
+		uint32_t mValue;
+	};
+
+	static constexpr uint32_t IndexMask      = (1u << IndexBits) - 1;
+	static constexpr uint32_t GenerationMask = 0xFFFFFFFFu >> IndexBits;
+
+	HandlePoolAllocator(uint32_t numObjects);
+	~HandlePoolAllocator();
+
+	void clean();
+
+	uint32_t getNumTotalObjects() const;
+	uint32_t getNumFreeObjects() const;
+
+	template <typename... Args>
+	Handle create(Args&&... args);
+
+	Handle createNoConstruct();
+
+	void remove(Handle handle);
+	void removeNoDestruct(Handle handle);
+
+	bool isValid(Handle handle) const;
+
+	T* get(Handle handle) const;
+
+	// Moves objects towards the start of the block and repoints their slots, handles stay valid.
+	// Returns true once the pool is fully compacted, see PoolAllocator::compact.
+	bool compact(std::chrono::nanoseconds budget = std::chrono::nanoseconds::max());
+private:
+	HandlePoolAllocator(HandlePoolAllocator&) = delete;
+	HandlePoolAllocator(const HandlePoolAllocator&) = delete;
+
+	HandlePoolAllocator& operator=(HandlePoolAllocator&) = delete;
+	HandlePoolAllocator& operator=(const HandlePoolAllocator&) = delete;
+
+	struct Slot {
+		T*       mObject;
+		uint32_t mGeneration;
+		uint32_t mNextFree;
+	};
+
+	Handle acquire(T* object);
+	T* release(Handle handle);
+	void slotsInit();
+
+	PoolAllocator<T, PoolFlagOccupancy> mPool;
+
+	Slot*     mSlots;
+	uint32_t* mOwners;
+	uint32_t  mFreeSlot;
+	uint32_t  mNumTotalObjects;
+};
+
+
+template <typename T, uint32_t IndexBits>
+HandlePoolAllocator<T, IndexBits>::Handle::Handle() : mValue(0xFFFFFFFFu) {}
+
+template <typename T, uint32_t IndexBits>
+HandlePoolAllocator<T, IndexBits>::Handle::Handle(uint32_t index, uint32_t generation)
+		: mValue((generation << IndexBits) | index) {}
+
+template <typename T, uint32_t IndexBits>
+uint32_t HandlePoolAllocator<T, IndexBits>::Handle::getIndex() const {
+	return mValue & IndexMask;
+}
+
+template <typename T, uint32_t IndexBits>
+uint32_t HandlePoolAllocator<T, IndexBits>::Handle::getGeneration() const {
+	return mValue >> IndexBits;
+}
+
+template <typename T, uint32_t IndexBits>
+uint32_t HandlePoolAllocator<T, IndexBits>::Handle::getValue() const {
+	return mValue;
+}
+
+template <typename T, uint32_t IndexBits>
+bool HandlePoolAllocator<T, IndexBits>::Handle::isNull() const {
+	return mValue == 0xFFFFFFFFu;
+}
+
+template <typename T, uint32_t IndexBits>
+bool HandlePoolAllocator<T, IndexBits>::Handle::operator==(Handle other) const {
+	return mValue == other.mValue;
+}
+
+template <typename T, uint32_t IndexBits>
+bool HandlePoolAllocator<T, IndexBits>::Handle::operator!=(Handle other) const {
+	return mValue != other.mValue;
+}
+
+template <typename T, uint32_t IndexBits>
+HandlePoolAllocator<T, IndexBits>::HandlePoolAllocator(uint32_t numObjects)
+		: mPool(numObjects)
+		, mSlots(nullptr)
+		, mOwners(nullptr)
+		, mFreeSlot(0)
+		, mNumTotalObjects(numObjects) {
+	// The all-ones index is reserved for the null handle.
+	assert(numObjects > 0 && numObjects <= IndexMask);
+
+	mSlots  = reinterpret_cast<Slot*>(std::malloc(numObjects * sizeof(Slot)));
+	mOwners = reinterpret_cast<uint32_t*>(std::malloc(numObjects * sizeof(uint32_t)));
+	slotsInit();
+}
+
+template <typename T, uint32_t IndexBits>
+HandlePoolAllocator<T, IndexBits>::~HandlePoolAllocator() {
+	std::free(mOwners);
+	std::free(mSlots);
+}
+
+template <typename T, uint32_t IndexBits>
+void HandlePoolAllocator<T, IndexBits>::clean() {
+	mPool.clean();
+
+	for (uint32_t i = 0; i < mNumTotalObjects; ++i) {
+		Slot& slot = mSlots[i];
+
+		if (slot.mObject) { slot.mGeneration = (slot.mGeneration + 1) & GenerationMask; }
+
+		slot.mObject   = nullptr;
+		slot.mNextFree = i + 1;
+	}
+
+	mFreeSlot = 0;
+}
+
+template <typename T, uint32_t IndexBits>
+uint32_t HandlePoolAllocator<T, IndexBits>::getNumTotalObjects() const {
+	return mNumTotalObjects;
+}
+
+template <typename T, uint32_t IndexBits>
+uint32_t HandlePoolAllocator<T, IndexBits>::getNumFreeObjects() const {
+	return mPool.getNumFreeObjects();
+}
+
+template <typename T, uint32_t IndexBits>
+template <typename... Args>
+typename HandlePoolAllocator<T, IndexBits>::Handle HandlePoolAllocator<T, IndexBits>::create(Args&&... args) {
+	return acquire(mPool.create(std::forward<Args>(args)...));
+}
+
+template <typename T, uint32_t IndexBits>
+typename HandlePoolAllocator<T, IndexBits>::Handle HandlePoolAllocator<T, IndexBits>::createNoConstruct() {
+	return acquire(mPool.createNoConstruct());
+}
+
+template <typename T, uint32_t IndexBits>
+void HandlePoolAllocator<T, IndexBits>::remove(Handle handle) {
+	mPool.remove(release(handle));
+}
+
+template <typename T, uint32_t IndexBits>
+void HandlePoolAllocator<T, IndexBits>::removeNoDestruct(Handle handle) {
+	mPool.removeNoDestruct(release(handle));
+}
+
+template <typename T, uint32_t IndexBits>
+bool HandlePoolAllocator<T, IndexBits>::isValid(Handle handle) const {
+	uint32_t index = handle.getIndex();
+
+	if (index >= mNumTotalObjects) { return false; }
+
+	const Slot& slot = mSlots[index];
+
+	return slot.mObject && slot.mGeneration == handle.getGeneration();
+}
+
+template <typename T, uint32_t IndexBits>
+T* HandlePoolAllocator<T, IndexBits>::get(Handle handle) const {
+	return isValid(handle) ? mSlots[handle.getIndex()].mObject : nullptr;
+}
+
+template <typename T, uint32_t IndexBits>
+bool HandlePoolAllocator<T, IndexBits>::compact(std::chrono::nanoseconds budget) {
+	return mPool.compact([this](T* from, T* to) {
+		uint32_t owner = mOwners[mPool.getIndex(from)];
+
+		mSlots[owner].mObject = to;
+		mOwners[mPool.getIndex(to)] = owner;
+	}, budget);
+}
+
+template <typename T, uint32_t IndexBits>
+typename HandlePoolAllocator<T, IndexBits>::Handle HandlePoolAllocator<T, IndexBits>::acquire(T* object) {
+	assert(mFreeSlot < mNumTotalObjects);
+
+	uint32_t index = mFreeSlot;
+	Slot& slot = mSlots[index];
+
+	mFreeSlot = slot.mNextFree;
+
+	slot.mObject = object;
+
+	mOwners[mPool.getIndex(object)] = index;
+
+	return Handle(index, slot.mGeneration);
+}
+
+template <typename T, uint32_t IndexBits>
+T* HandlePoolAllocator<T, IndexBits>::release(Handle handle) {
+	assert(isValid(handle));
+
+	uint32_t index = handle.getIndex();
+	Slot& slot = mSlots[index];
+
+	T* object = slot.mObject;
+
+	slot.mObject     = nullptr;
+	slot.mGeneration = (slot.mGeneration + 1) & GenerationMask;
+	slot.mNextFree   = mFreeSlot;
+
+	mFreeSlot = index;
+
+	return object;
+}
+
+template <typename T, uint32_t IndexBits>
+void HandlePoolAllocator<T, IndexBits>::slotsInit() {
+	for (uint32_t i = 0; i < mNumTotalObjects; ++i) {
+		mSlots[i].mObject     = nullptr;
+		mSlots[i].mGeneration = 0;
+		mSlots[i].mNextFree   = i + 1;
+	}
+
+	mFreeSlot = 0;
+}
+
+} // namespace simple
@@ -0,0 +1,419 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#pragma once
+
+#include "Allocator/Linear.h"
+
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace simple {
+
+// Marks the current position of a LinearAllocator and rewinds to it on destruction, releasing
+// everything allocated in between at once. Scopes on the same arena must nest.
+class ScratchScope {
+public:
+	ScratchScope(LinearAllocator& arena);
+	~ScratchScope();
+private:
+	ScratchScope(ScratchScope&) = delete;
+	ScratchScope(const ScratchScope&) = delete;
+
+	ScratchScope& operator=(ScratchScope&) = delete;
+	ScratchScope& operator=(const ScratchScope&) = delete;
+
+	LinearAllocator& mArena;
+	uintptr_t        mPosition;
+	bool             mEmpty;
+};
+
+class JobSystem;
+
+// What a running job sees: the worker it runs on and that worker's scratch arena. Memory taken
+// from the scratch arena is released when the job returns.
+class JobContext {
+public:
+	JobSystem& getSystem() const;
+	uint32_t getWorker() const;
+	LinearAllocator& getScratch() const;
+private:
+	friend class JobSystem;
+
+	JobContext(JobSystem& system, uint32_t worker, LinearAllocator& scratch);
+
+	JobSystem&       mSystem;
+	uint32_t         mWorker;
+	LinearAllocator& mScratch;
+};
+
+using JobCounter = std::atomic<uint32_t>;
+
+struct Job {
+	void (*mFunction)(JobContext& context, void* data);
+	void* mData;
+};
+
+// Work-stealing job scheduler in which every worker owns a LinearAllocator scratch arena, so
+// jobs get temporary memory without any shared lock. Each worker pushes and pops its own jobs at
+// the bottom of a Chase-Lev deque and idle workers steal from the top of the others. Every job
+// runs inside a ScratchScope on the worker that executes it; jobs that a job waits for run
+// nested on the same worker, which keeps the scopes of a worker in stack order.
+//
+// The constructing thread is worker 0 and runs jobs only while it waits; the other workers are
+// threads of their own. spawn and wait may only be called from workers.
+class JobSystem {
+public:
+	static constexpr uint32_t DequeSize = 4096;
+
+	JobSystem(uint32_t numWorkers, uint32_t scratchSize);
+	~JobSystem();
+
+	uint32_t getNumWorkers() const;
+
+	// The worker the calling thread is, and its arena.
+	uint32_t getWorker() const;
+	LinearAllocator& getScratch();
+
+	// counter is incremented now and decremented once the job has finished. A full deque runs
+	// the job right away.
+	void spawn(const Job& job, JobCounter& counter);
+
+	// Copies function into the scratch arena of the calling worker, which must therefore wait
+	// for counter before the enclosing scope ends.
+	template <typename F>
+	void spawn(JobCounter& counter, F&& function);
+
+	// Runs own and stolen jobs until counter drops to zero.
+	void wait(JobCounter& counter);
+private:
+	JobSystem(JobSystem&) = delete;
+	JobSystem(const JobSystem&) = delete;
+
+	JobSystem& operator=(JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	// Fields are written before the bottom index is published and read before a thief claims
+	// the top one, so relaxed atomics are enough to keep them free of data races.
+	struct Slot {
+		std::atomic<void (*)(JobContext&, void*)> mFunction;
+		std::atomic<void*>                        mData;
+		std::atomic<JobCounter*>                  mCounter;
+	};
+
+	struct alignas(64) Worker {
+		alignas(64) std::atomic<int64_t> mTop;
+		alignas(64) std::atomic<int64_t> mBottom;
+
+		Slot mSlots[DequeSize];
+
+		LinearAllocator* mScratch;
+		void*            mMemory;
+		std::thread      mThread;
+	};
+
+	struct Current {
+		JobSystem* mSystem;
+		uint32_t   mWorker;
+	};
+
+	static Current& getCurrent();
+
+	bool push(Worker& worker, const Job& job, JobCounter* counter);
+	bool pop(Worker& worker, Job& job, JobCounter*& counter);
+	bool steal(Worker& worker, Job& job, JobCounter*& counter);
+
+	bool runOne(uint32_t worker);
+	void run(uint32_t worker, const Job& job, JobCounter* counter);
+
+	void loop(uint32_t worker);
+
+	Worker*  mWorkers;
+	uint32_t mNumWorkers;
+
+	std::atomic<uint32_t> mNumQueued;
+	std::atomic<uint32_t> mNumSleeping;
+	std::atomic<bool>     mStop;
+
+	std::mutex              mMutex;
+	std::condition_variable mWake;
+};
+
+
+inline ScratchScope::ScratchScope(LinearAllocator& arena)
+		: mArena(arena)
+		, mPosition(arena.getCurrentPosition())
+		, mEmpty(arena.getUsedMemory() == 0) {
+}
+
+inline ScratchScope::~ScratchScope() {
+	if (mEmpty) {
+		mArena.clean();
+	} else if (mArena.getCurrentPosition() != mPosition) {
+		mArena.setCurrentPosition(mPosition);
+	}
+}
+
+inline JobContext::JobContext(JobSystem& system, uint32_t worker, LinearAllocator& scratch)
+		: mSystem(system)
+		, mWorker(worker)
+		, mScratch(scratch) {
+}
+
+inline JobSystem& JobContext::getSystem() const {
+	return mSystem;
+}
+
+inline uint32_t JobContext::getWorker() const {
+	return mWorker;
+}
+
+inline LinearAllocator& JobContext::getScratch() const {
+	return mScratch;
+}
+
+inline JobSystem::JobSystem(uint32_t numWorkers, uint32_t scratchSize)
+		: mWorkers(nullptr)
+		, mNumWorkers(numWorkers)
+		, mNumQueued(0)
+		, mNumSleeping(0)
+		, mStop(false) {
+	assert(numWorkers > 0);
+	assert(getCurrent().mSystem == nullptr && "JobSystem on a thread that already is a worker");
+
+	mWorkers = reinterpret_cast<Worker*>(std::aligned_alloc(alignof(Worker), numWorkers * sizeof(Worker)));
+
+	for (uint32_t i = 0; i < numWorkers; ++i) {
+		Worker* worker = new (&mWorkers[i]) Worker;
+
+		worker->mTop.store(0, std::memory_order_relaxed);
+		worker->mBottom.store(0, std::memory_order_relaxed);
+
+		worker->mMemory  = std::malloc(scratchSize);
+		worker->mScratch = new LinearAllocator(worker->mMemory, scratchSize);
+	}
+
+	getCurrent() = Current { this, 0 };
+
+	for (uint32_t i = 1; i < numWorkers; ++i) {
+		mWorkers[i].mThread = std::thread([this, i] { loop(i); });
+	}
+}
+
+inline JobSystem::~JobSystem() {
+	assert(mNumQueued.load() == 0);
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStop.store(true);
+	}
+
+	mWake.notify_all();
+
+	for (uint32_t i = 1; i < mNumWorkers; ++i) { mWorkers[i].mThread.join(); }
+
+	getCurrent() = Current { nullptr, 0 };
+
+	for (uint32_t i = 0; i < mNumWorkers; ++i) {
+		mWorkers[i].mScratch->clean();
+
+		delete mWorkers[i].mScratch;
+		std::free(mWorkers[i].mMemory);
+
+		mWorkers[i].~Worker();
+	}
+
+	std::free(mWorkers);
+}
+
+inline uint32_t JobSystem::getNumWorkers() const {
+	return mNumWorkers;
+}
+
+inline uint32_t JobSystem::getWorker() const {
+	assert(getCurrent().mSystem == this && "Not a worker of this JobSystem");
+	return getCurrent().mWorker;
+}
+
+inline LinearAllocator& JobSystem::getScratch() {
+	return *mWorkers[getWorker()].mScratch;
+}
+
+inline void JobSystem::spawn(const Job& job, JobCounter& counter) {
+	assert(job.mFunction);
+
+	uint32_t worker = getWorker();
+
+	counter.fetch_add(1, std::memory_order_relaxed);
+
+	// Counted before the push, so a thief that takes the job at once never drops the count below
+	// zero. Pairs with the sleeping count in loop, so either the sleeper sees the job or it gets woken.
+	mNumQueued.fetch_add(1, std::memory_order_seq_cst);
+
+	if (!push(mWorkers[worker], job, &counter)) {
+		mNumQueued.fetch_sub(1, std::memory_order_relaxed);
+		run(worker, job, &counter);
+		return;
+	}
+
+	if (mNumSleeping.load(std::memory_order_seq_cst) > 0) {
+		std::lock_guard<std::mutex> lock(mMutex);
+		mWake.notify_one();
+	}
+}
+
+template <typename F>
+void JobSystem::spawn(JobCounter& counter, F&& function) {
+	using Closure = std::decay_t<F>;
+
+	Closure* closure = getScratch().create<Closure>(std::forward<F>(function));
+
+	spawn(Job { [](JobContext& context, void* data) {
+		Closure* closure = reinterpret_cast<Closure*>(data);
+
+		(*closure)(context);
+
+		closure->~Closure();
+	}, closure }, counter);
+}
+
+inline void JobSystem::wait(JobCounter& counter) {
+	uint32_t worker = getWorker();
+
+	while (counter.load(std::memory_order_acquire) != 0) {
+		if (!runOne(worker)) { std::this_thread::yield(); }
+	}
+}
+
+inline JobSystem::Current& JobSystem::getCurrent() {
+	static thread_local Current current { nullptr, 0 };
+	return current;
+}
+
+inline bool JobSystem::push(Worker& worker, const Job& job, JobCounter* counter) {
+	int64_t bottom = worker.mBottom.load(std::memory_order_relaxed);
+	int64_t top    = worker.mTop.load(std::memory_order_acquire);
+
+	if (bottom - top >= int64_t(DequeSize)) { return false; }
+
+	Slot& slot = worker.mSlots[bottom & (DequeSize - 1)];
+
+	slot.mFunction.store(job.mFunction, std::memory_order_relaxed);
+	slot.mData.store(job.mData, std::memory_order_relaxed);
+	slot.mCounter.store(counter, std::memory_order_relaxed);
+
+	std::atomic_thread_fence(std::memory_order_release);
+
+	worker.mBottom.store(bottom + 1, std::memory_order_relaxed);
+
+	return true;
+}
+
+inline bool JobSystem::pop(Worker& worker, Job& job, JobCounter*& counter) {
+	int64_t bottom = worker.mBottom.load(std::memory_order_relaxed) - 1;
+
+	worker.mBottom.store(bottom, std::memory_order_relaxed);
+
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	int64_t top = worker.mTop.load(std::memory_order_relaxed);
+
+	if (top > bottom) {
+		worker.mBottom.store(bottom + 1, std::memory_order_relaxed);
+		return false;
+	}
+
+	Slot& slot = worker.mSlots[bottom & (DequeSize - 1)];
+
+	job.mFunction = slot.mFunction.load(std::memory_order_relaxed);
+	job.mData     = slot.mData.load(std::memory_order_relaxed);
+	counter       = slot.mCounter.load(std::memory_order_relaxed);
+
+	if (top != bottom) { return true; }
+
+	// The last job, race thieves for it.
+	bool taken = worker.mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+
+	worker.mBottom.store(bottom + 1, std::memory_order_relaxed);
+
+	return taken;
+}
+
+inline bool JobSystem::steal(Worker& worker, Job& job, JobCounter*& counter) {
+	int64_t top = worker.mTop.load(std::memory_order_acquire);
+
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	int64_t bottom = worker.mBottom.load(std::memory_order_acquire);
+
+	if (top >= bottom) { return false; }
+
+	Slot& slot = worker.mSlots[top & (DequeSize - 1)];
+
+	job.mFunction = slot.mFunction.load(std::memory_order_relaxed);
+	job.mData     = slot.mData.load(std::memory_order_relaxed);
+	counter       = slot.mCounter.load(std::memory_order_relaxed);
+
+	return worker.mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+}
+
+inline bool JobSystem::runOne(uint32_t worker) {
+	Job job;
+	JobCounter* counter;
+
+	bool found = pop(mWorkers[worker], job, counter);
+
+	for (uint32_t i = 1; !found && i < mNumWorkers; ++i) {
+		found = steal(mWorkers[(worker + i) % mNumWorkers], job, counter);
+	}
+
+	if (!found) { return false; }
+
+	mNumQueued.fetch_sub(1, std::memory_order_relaxed);
+
+	run(worker, job, counter);
+
+	return true;
+}
+
+inline void JobSystem::run(uint32_t worker, const Job& job, JobCounter* counter) {
+	LinearAllocator& scratch = *mWorkers[worker].mScratch;
+
+	{
+		ScratchScope scope(scratch);
+		JobContext context(*this, worker, scratch);
+
+		job.mFunction(context, job.mData);
+	}
+
+	counter->fetch_sub(1, std::memory_order_release);
+}
+
+inline void JobSystem::loop(uint32_t worker) {
+	getCurrent() = Current { this, worker };
+
+	while (!mStop.load(std::memory_order_relaxed)) {
+		if (runOne(worker)) { continue; }
+
+		std::unique_lock<std::mutex> lock(mMutex);
+
+		mNumSleeping.fetch_add(1, std::memory_order_seq_cst);
+
+		mWake.wait(lock, [this] {
+			return mNumQueued.load(std::memory_order_seq_cst) > 0 || mStop.load(std::memory_order_relaxed);
+		});
+
+		mNumSleeping.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	getCurrent() = Current { nullptr, 0 };
+}
+
+} // namespace simple
@@ -0,0 +1,387 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace simple {
+
+// Maps every allocation directly from the OS. Data starts on a page boundary right after a page
+// holding the block header, growth goes through mremap, which moves page table entries instead of
+// copying, and deallocate unmaps at once. Meant for blocks of a few megabytes and more, either on
+// its own or as the overflow tier of LinearAllocator and StackAllocator.
+class LargeObjectAllocator {
+	struct Block;
+public:
+	// Blocks mapped on behalf of one arena, so arenas sharing the allocator release only their own.
+	struct Owner {
+		Block* mBlocks = nullptr;
+	};
+
+	LargeObjectAllocator();
+	~LargeObjectAllocator();
+
+	// Unmaps every live block.
+	void clean();
+
+	// Unmaps the blocks of owner only.
+	void clean(Owner& owner);
+
+	size_t getUsedMemory() const;
+	uint32_t getNumAllocations() const;
+
+	static size_t getPageSize();
+
+	// Usable size of the block, the requested size rounded up to whole pages.
+	size_t getSize(const void* pointer) const;
+
+	void* allocate(size_t size);
+	void* allocate(size_t size, Owner& owner);
+	void* reallocate(void* pointer, size_t size);
+	void deallocate(void* pointer);
+
+	template <typename T, typename... Args>
+	T* create(Args&&... args);
+
+	template <typename T>
+	T* createNoConstruct();
+
+	template <typename T, typename... Args>
+	T* createArray(uint32_t length, Args&&... args);
+
+	template <typename T>
+	T* createArrayNoConstruct(uint32_t length);
+
+	// Grows or shrinks the array in place or by remapping, new elements are left uninitialized.
+	template <typename T>
+	T* resizeArrayNoConstruct(T* object, uint32_t length);
+
+	template <typename T>
+	void remove(T* object);
+
+	template <typename T>
+	void removeNoDestruct(T* object);
+
+	template <typename T>
+	void removeArray(T* object);
+
+	template <typename T>
+	void removeArrayNoDestruct(T* object);
+private:
+	LargeObjectAllocator(LargeObjectAllocator&) = delete;
+	LargeObjectAllocator(const LargeObjectAllocator&) = delete;
+
+	LargeObjectAllocator& operator=(LargeObjectAllocator&) = delete;
+	LargeObjectAllocator& operator=(const LargeObjectAllocator&) = delete;
+
+	struct Block {
+		Block*   mNext;
+		Block*   mPrevious;
+		size_t   mSize; // Whole mapping including the header page.
+		uint32_t mLength;
+
+		Owner* mOwner;
+		Block* mOwnerNext;
+		Block* mOwnerPrevious;
+	};
+
+	static size_t getMappingSize(size_t size);
+
+	Block* getBlock(const void* pointer) const;
+
+	void link(Block* block);
+	void unlink(Block* block);
+
+	void link(Block* block, Owner* owner);
+	void unlinkOwner(Block* block);
+
+	Block* mBlocks;
+
+	size_t   mUsedMemory;
+	uint32_t mNumAllocations;
+};
+
+
+inline LargeObjectAllocator::LargeObjectAllocator()
+		: mBlocks(nullptr)
+		, mUsedMemory(0)
+		, mNumAllocations(0) {
+}
+
+inline LargeObjectAllocator::~LargeObjectAllocator() {
+	assert(mNumAllocations == 0 && mUsedMemory == 0);
+}
+
+inline void LargeObjectAllocator::clean() {
+	while (mBlocks) {
+		Block* block = mBlocks;
+		mBlocks = block->mNext;
+
+		if (block->mOwner) { block->mOwner->mBlocks = nullptr; }
+
+		munmap(block, block->mSize);
+	}
+
+	mUsedMemory     = 0;
+	mNumAllocations = 0;
+}
+
+inline void LargeObjectAllocator::clean(Owner& owner) {
+	while (owner.mBlocks) {
+		Block* block = owner.mBlocks;
+		owner.mBlocks = block->mOwnerNext;
+
+		unlink(block);
+
+		mUsedMemory -= block->mSize;
+		--mNumAllocations;
+
+		munmap(block, block->mSize);
+	}
+}
+
+inline size_t LargeObjectAllocator::getUsedMemory() const {
+	return mUsedMemory;
+}
+
+inline uint32_t LargeObjectAllocator::getNumAllocations() const {
+	return mNumAllocations;
+}
+
+inline size_t LargeObjectAllocator::getPageSize() {
+	static const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	return pageSize;
+}
+
+inline size_t LargeObjectAllocator::getSize(const void* pointer) const {
+	return getBlock(pointer)->mSize - getPageSize();
+}
+
+inline void* LargeObjectAllocator::allocate(size_t size) {
+	assert(size != 0);
+
+	size_t mappingSize = getMappingSize(size);
+
+	void* mapping = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	assert(mapping != MAP_FAILED && "LargeObjectAllocator is out of memory");
+	if (mapping == MAP_FAILED) { return nullptr; }
+
+	auto* block = reinterpret_cast<Block*>(mapping);
+
+	block->mSize   = mappingSize;
+	block->mLength = 0;
+	block->mOwner  = nullptr;
+
+	link(block);
+
+	mUsedMemory += mappingSize;
+	++mNumAllocations;
+
+	return reinterpret_cast<uint8_t*>(mapping) + getPageSize();
+}
+
+inline void* LargeObjectAllocator::allocate(size_t size, Owner& owner) {
+	void* pointer = allocate(size);
+
+	if (pointer) { link(getBlock(pointer), &owner); }
+
+	return pointer;
+}
+
+inline void* LargeObjectAllocator::reallocate(void* pointer, size_t size) {
+	if (!pointer) { return allocate(size); }
+
+	assert(size != 0);
+
+	Block* block = getBlock(pointer);
+
+	size_t oldSize = block->mSize;
+	size_t newSize = getMappingSize(size);
+
+	if (newSize == oldSize) { return pointer; }
+
+	// The header may move, both lists are relinked afterwards.
+	Owner* owner = block->mOwner;
+
+	unlink(block);
+	unlinkOwner(block);
+
+	void* mapping = mremap(block, oldSize, newSize, MREMAP_MAYMOVE);
+
+	assert(mapping != MAP_FAILED && "LargeObjectAllocator is out of memory");
+
+	if (mapping == MAP_FAILED) {
+		link(block);
+		link(block, owner);
+		return nullptr;
+	}
+
+	block = reinterpret_cast<Block*>(mapping);
+	block->mSize = newSize;
+
+	link(block);
+	link(block, owner);
+
+	mUsedMemory += newSize;
+	mUsedMemory -= oldSize;
+
+	return reinterpret_cast<uint8_t*>(mapping) + getPageSize();
+}
+
+inline void LargeObjectAllocator::deallocate(void* pointer) {
+	assert(pointer);
+
+	Block* block = getBlock(pointer);
+
+	unlink(block);
+	unlinkOwner(block);
+
+	mUsedMemory -= block->mSize;
+	--mNumAllocations;
+
+	munmap(block, block->mSize);
+}
+
+template <typename T, typename... Args>
+T* LargeObjectAllocator::create(Args&&... args) {
+	return new (allocate(sizeof(T))) T(std::forward<Args>(args)...);
+}
+
+template <typename T>
+T* LargeObjectAllocator::createNoConstruct() {
+	return reinterpret_cast<T*>(allocate(sizeof(T)));
+}
+
+template <typename T, typename... Args>
+T* LargeObjectAllocator::createArray(uint32_t length, Args&&... args) {
+	T* pointer = createArrayNoConstruct<T>(length);
+
+	for (uint32_t i = 0; i < length; ++i) {
+		new (&pointer[i]) T(std::forward<Args>(args)...);
+	}
+
+	return pointer;
+}
+
+template <typename T>
+T* LargeObjectAllocator::createArrayNoConstruct(uint32_t length) {
+	assert(length != 0);
+
+	// The length lives in the block header, so the array itself stays page aligned.
+	auto* pointer = reinterpret_cast<T*>(allocate(sizeof(T) * size_t(length)));
+
+	getBlock(pointer)->mLength = length;
+
+	return pointer;
+}
+
+template <typename T>
+T* LargeObjectAllocator::resizeArrayNoConstruct(T* object, uint32_t length) {
+	static_assert(std::is_trivially_copyable<T>::value, "Remapping moves the array bytewise");
+
+	assert(object && length != 0);
+
+	auto* pointer = reinterpret_cast<T*>(reallocate(object, sizeof(T) * size_t(length)));
+
+	getBlock(pointer)->mLength = length;
+
+	return pointer;
+}
+
+template <typename T>
+void LargeObjectAllocator::remove(T* object) {
+	assert(object);
+	object->~T();
+	deallocate(object);
+}
+
+template <typename T>
+void LargeObjectAllocator::removeNoDestruct(T* object) {
+	assert(object);
+	deallocate(object);
+}
+
+template <typename T>
+void LargeObjectAllocator::removeArray(T* object) {
+	assert(object);
+
+	uint32_t length = getBlock(object)->mLength;
+
+	for (uint32_t i = 0; i < length; ++i) {
+		object[i].~T();
+	}
+
+	deallocate(object);
+}
+
+template <typename T>
+void LargeObjectAllocator::removeArrayNoDestruct(T* object) {
+	assert(object);
+	deallocate(object);
+}
+
+inline size_t LargeObjectAllocator::getMappingSize(size_t size) {
+	size_t pageSize = getPageSize();
+	return pageSize + (size + pageSize - 1) / pageSize * pageSize;
+}
+
+inline LargeObjectAllocator::Block* LargeObjectAllocator::getBlock(const void* pointer) const {
+	assert(reinterpret_cast<uintptr_t>(pointer) % getPageSize() == 0);
+	return reinterpret_cast<Block*>(reinterpret_cast<uintptr_t>(pointer) - getPageSize());
+}
+
+inline void LargeObjectAllocator::link(Block* block) {
+	block->mPrevious = nullptr;
+	block->mNext     = mBlocks;
+
+	if (mBlocks) { mBlocks->mPrevious = block; }
+
+	mBlocks = block;
+}
+
+inline void LargeObjectAllocator::unlink(Block* block) {
+	if (block->mPrevious) {
+		block->mPrevious->mNext = block->mNext;
+	} else {
+		mBlocks = block->mNext;
+	}
+
+	if (block->mNext) { block->mNext->mPrevious = block->mPrevious; }
+}
+
+inline void LargeObjectAllocator::link(Block* block, Owner* owner) {
+	block->mOwner = owner;
+
+	if (!owner) { return; }
+
+	block->mOwnerPrevious = nullptr;
+	block->mOwnerNext     = owner->mBlocks;
+
+	if (owner->mBlocks) { owner->mBlocks->mOwnerPrevious = block; }
+
+	owner->mBlocks = block;
+}
+
+inline void LargeObjectAllocator::unlinkOwner(Block* block) {
+	Owner* owner = block->mOwner;
+
+	if (!owner) { return; }
+
+	if (block->mOwnerPrevious) {
+		block->mOwnerPrevious->mOwnerNext = block->mOwnerNext;
+	} else {
+		owner->mBlocks = block->mOwnerNext;
+	}
+
+	if (block->mOwnerNext) { block->mOwnerNext->mOwnerPrevious = block->mOwnerPrevious; }
+}
+
+} // namespace simple
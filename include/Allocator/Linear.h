@@ -3,6 +3,7 @@
 #pragma once
 
 #include "Allocator.h"
+#include "Allocator/LargeObject.h"
 
 #include <cassert>
 #include <cstdint>
@@ -24,6 +25,11 @@ public:
 	uint32_t getUsedMemory() const;
 	uint32_t getNumAllocations() const;
 
+	// Requests of at least threshold bytes, and any request that no longer fits, are mapped by
+	// overflow instead. clean() releases them together with the arena, other users of overflow keep
+	// their blocks.
+	void setOverflow(LargeObjectAllocator* overflow, uint32_t threshold);
+
 	template <typename T, typename... Args>
 	T* create(Args&&... args);
 
@@ -47,6 +53,10 @@ private:
 	uintptr_t mStart;
 	uintptr_t mCurrentPosition;
 
+	LargeObjectAllocator* mOverflow;
+	LargeObjectAllocator::Owner mOverflowBlocks;
+	uint32_t mOverflowThreshold;
+
 	uint32_t mSize;
 	uint32_t mUsedMemory;
 	uint32_t mNumAllocations;
@@ -56,6 +66,8 @@ private:
 inline LinearAllocator::LinearAllocator(void* start, uint32_t size)
 		: mStart(reinterpret_cast<uintptr_t>(start))
 		, mCurrentPosition(reinterpret_cast<uintptr_t>(start))
+		, mOverflow(nullptr)
+		, mOverflowThreshold(0)
 		, mSize(size)
 		, mUsedMemory(0)
 		, mNumAllocations(0) {
@@ -65,12 +77,17 @@ inline LinearAllocator::LinearAllocator(void* start, uint32_t size)
 inline LinearAllocator::~LinearAllocator() {
 	assert(mNumAllocations == 0 && mUsedMemory == 0);
 
+	// Overflow blocks are not counted above, they must not outlive the list that tracks them.
+	if (mOverflow) { mOverflow->clean(mOverflowBlocks); }
+
 	mStart           = 0;
 	mCurrentPosition = 0;
 	mSize            = 0;
 }
 
 inline void LinearAllocator::clean() {
+	if (mOverflow) { mOverflow->clean(mOverflowBlocks); }
+
 	mNumAllocations  = 0;
 	mUsedMemory      = 0;
 	mCurrentPosition = mStart;
@@ -100,6 +117,11 @@ inline uint32_t LinearAllocator::getNumAllocations() const {
 	return mNumAllocations;
 }
 
+inline void LinearAllocator::setOverflow(LargeObjectAllocator* overflow, uint32_t threshold) {
+	mOverflow          = overflow;
+	mOverflowThreshold = threshold;
+}
+
 template <typename T, typename... Args>
 T* LinearAllocator::create(Args&&... args) {
 	return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
@@ -150,6 +172,10 @@ inline void* LinearAllocator::allocate(uint32_t size, uint8_t alignment) {
 
 	uint8_t adjustment = allocator::alignForwardAdjustment(mCurrentPosition, alignment);
 
+	if (mOverflow && (size >= mOverflowThreshold || mUsedMemory + adjustment + size > mSize)) {
+		return mOverflow->allocate(size, mOverflowBlocks);
+	}
+
 	assert(mUsedMemory + adjustment + size <= mSize);
 
 	uintptr_t alignedAddress = mCurrentPosition + adjustment;
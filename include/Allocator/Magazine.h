@@ -0,0 +1,155 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#pragma once
+
+#include "Allocator/Deferred.h"
+#include "Allocator/Pool.h"
+
+#include <cassert>
+#include <cstdint>
+#include <utility>
+
+namespace simple {
+
+// Pre-filled supply of PoolAllocator slots for a realtime thread. The realtime side only pops
+// slots from and pushes objects back onto wait-free queues; the pool itself is touched only by the
+// thread that owns it, which calls service() from its own loop or any periodic task to take
+// returned objects back and top the magazine up again.
+template <typename T, uint32_t Flags = PoolFlagNone>
+class PoolMagazine {
+public:
+	// Fills the magazine right away; capacity must be a power of two.
+	PoolMagazine(PoolAllocator<T, Flags>& pool, uint32_t capacity);
+	~PoolMagazine();
+
+	// Realtime side. create returns nullptr when the magazine ran dry, remove returns false when
+	// the return queue is full and the caller still owns the object.
+	template <typename... Args>
+	T* create(Args&&... args);
+
+	T* createNoConstruct();
+
+	// The destructor runs later on the housekeeping thread.
+	bool remove(T* object);
+	bool removeNoDestruct(T* object);
+
+	uint32_t getNumAvailable() const;
+
+	// Housekeeping side, each returns the number of slots moved.
+	uint32_t reclaim();
+	uint32_t refill();
+	uint32_t service();
+private:
+	PoolMagazine(PoolMagazine&) = delete;
+	PoolMagazine(const PoolMagazine&) = delete;
+
+	PoolMagazine& operator=(PoolMagazine&) = delete;
+	PoolMagazine& operator=(const PoolMagazine&) = delete;
+
+	struct Returned {
+		T*   mObject;
+		bool mDestruct;
+	};
+
+	PoolAllocator<T, Flags>& mPool;
+
+	allocator::SpscQueue<T*>       mAvailable; // Housekeeping to realtime.
+	allocator::SpscQueue<Returned> mReturned;  // Realtime to housekeeping.
+};
+
+
+template <typename T, uint32_t Flags>
+PoolMagazine<T, Flags>::PoolMagazine(PoolAllocator<T, Flags>& pool, uint32_t capacity)
+		: mPool(pool)
+		, mAvailable(capacity)
+		, mReturned(capacity) {
+	refill();
+}
+
+template <typename T, uint32_t Flags>
+PoolMagazine<T, Flags>::~PoolMagazine() {
+	reclaim();
+
+	T* object;
+
+	while (mAvailable.pop(object)) { mPool.removeNoDestruct(object); }
+}
+
+template <typename T, uint32_t Flags>
+template <typename... Args>
+T* PoolMagazine<T, Flags>::create(Args&&... args) {
+	T* object;
+	if (!mAvailable.pop(object)) { return nullptr; }
+
+	return new (object) T(std::forward<Args>(args)...);
+}
+
+template <typename T, uint32_t Flags>
+T* PoolMagazine<T, Flags>::createNoConstruct() {
+	T* object;
+	if (!mAvailable.pop(object)) { return nullptr; }
+
+	return object;
+}
+
+template <typename T, uint32_t Flags>
+bool PoolMagazine<T, Flags>::remove(T* object) {
+	assert(object);
+	return mReturned.push(Returned { object, true });
+}
+
+template <typename T, uint32_t Flags>
+bool PoolMagazine<T, Flags>::removeNoDestruct(T* object) {
+	assert(object);
+	return mReturned.push(Returned { object, false });
+}
+
+template <typename T, uint32_t Flags>
+uint32_t PoolMagazine<T, Flags>::getNumAvailable() const {
+	return mAvailable.getSize();
+}
+
+template <typename T, uint32_t Flags>
+uint32_t PoolMagazine<T, Flags>::reclaim() {
+	uint32_t numReclaimed = 0;
+
+	Returned returned;
+
+	while (mReturned.pop(returned)) {
+		if (returned.mDestruct) {
+			mPool.remove(returned.mObject);
+		} else {
+			mPool.removeNoDestruct(returned.mObject);
+		}
+
+		++numReclaimed;
+	}
+
+	return numReclaimed;
+}
+
+template <typename T, uint32_t Flags>
+uint32_t PoolMagazine<T, Flags>::refill() {
+	uint32_t numAdded = 0;
+
+	while (mAvailable.getSize() < mAvailable.getCapacity() && mPool.getNumFreeObjects() > 0) {
+		T* object = mPool.createNoConstruct();
+
+		if (!mAvailable.push(object)) {
+			mPool.removeNoDestruct(object);
+			break;
+		}
+
+		++numAdded;
+	}
+
+	return numAdded;
+}
+
+template <typename T, uint32_t Flags>
+uint32_t PoolMagazine<T, Flags>::service() {
+	uint32_t numMoved = reclaim();
+	return numMoved + refill();
+}
+
+} // namespace simple
@@ -0,0 +1,122 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#pragma once
+
+#include "Allocator.h"
+#include "Allocator/Pool.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <cstdint>
+#include <utility>
+
+namespace simple {
+namespace allocator {
+
+struct NoReset {
+	template <typename T>
+	void operator()(T&) const {}
+};
+
+} // namespace allocator
+
+// Object cache on top of PoolAllocator in the spirit of Bonwick's slab caches. Removed objects
+// are not destroyed: reset puts them back into a reusable state and they wait in the cache fully
+// constructed, so create is a pointer pop. Destructors only run when the cache is trimmed.
+template <typename T, typename Reset = allocator::NoReset>
+class ObjectCache {
+public:
+	ObjectCache(uint32_t numObjects, Reset reset = Reset());
+	~ObjectCache();
+
+	uint32_t getNumTotalObjects() const;
+	uint32_t getNumFreeObjects() const;
+	uint32_t getNumCachedObjects() const;
+
+	// The arguments only reach the constructor when no cached object is left.
+	template <typename... Args>
+	T* create(Args&&... args);
+
+	void remove(T* object);
+
+	// Destroys cached objects until at most keep are left and returns how many were destroyed.
+	uint32_t trim(uint32_t keep = 0);
+private:
+	ObjectCache(ObjectCache&) = delete;
+	ObjectCache(const ObjectCache&) = delete;
+
+	ObjectCache& operator=(ObjectCache&) = delete;
+	ObjectCache& operator=(const ObjectCache&) = delete;
+
+	PoolAllocator<T> mPool;
+
+	// Kept out of band, a cached object is constructed and its memory is not ours to link through.
+	T**      mCached;
+	uint32_t mNumCached;
+
+	Reset mReset;
+};
+
+
+template <typename T, typename Reset>
+ObjectCache<T, Reset>::ObjectCache(uint32_t numObjects, Reset reset)
+		: mPool(numObjects)
+		, mCached(nullptr)
+		, mNumCached(0)
+		, mReset(std::move(reset)) {
+	mCached = reinterpret_cast<T**>(std::malloc(numObjects * sizeof(T*)));
+}
+
+template <typename T, typename Reset>
+ObjectCache<T, Reset>::~ObjectCache() {
+	trim();
+
+	std::free(mCached);
+}
+
+template <typename T, typename Reset>
+uint32_t ObjectCache<T, Reset>::getNumTotalObjects() const {
+	return mPool.getNumTotalObjects();
+}
+
+template <typename T, typename Reset>
+uint32_t ObjectCache<T, Reset>::getNumFreeObjects() const {
+	return mPool.getNumFreeObjects() + mNumCached;
+}
+
+template <typename T, typename Reset>
+uint32_t ObjectCache<T, Reset>::getNumCachedObjects() const {
+	return mNumCached;
+}
+
+template <typename T, typename Reset>
+template <typename... Args>
+T* ObjectCache<T, Reset>::create(Args&&... args) {
+	if (mNumCached) { return mCached[--mNumCached]; }
+
+	return mPool.create(std::forward<Args>(args)...);
+}
+
+template <typename T, typename Reset>
+void ObjectCache<T, Reset>::remove(T* object) {
+	assert(object);
+	assert(mNumCached < mPool.getNumTotalObjects());
+
+	mReset(*object);
+
+	mCached[mNumCached++] = object;
+}
+
+template <typename T, typename Reset>
+uint32_t ObjectCache<T, Reset>::trim(uint32_t keep) {
+	uint32_t numDestroyed = 0;
+
+	while (mNumCached > keep) {
+		mPool.remove(mCached[--mNumCached]);
+		++numDestroyed;
+	}
+
+	return numDestroyed;
+}
+
+} // namespace simple
@@ -0,0 +1,180 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+#include <sys/mman.h>
+
+namespace simple {
+
+// Maps every page of a 48-bit address space to the allocator that owns it, so an arbitrary
+// pointer can be checked with owns and freed through free without knowing where it came from.
+// It is a three level radix tree keyed by address >> PageShift; inner nodes and leaves are mapped
+// lazily on first insert and never released, which makes lookups lock free: three dependent
+// loads and no writes. Inserts and erases of the same pages must not race each other.
+class PageMap {
+public:
+	static constexpr uint32_t PageShift   = 12;
+	static constexpr uint32_t AddressBits = 48;
+	static constexpr uint32_t LevelBits   = (AddressBits - PageShift) / 3;
+	static constexpr uint32_t LevelSize   = 1u << LevelBits;
+
+	// Allocators register an Owner that outlives their ranges; free calls mFree(mAllocator, pointer).
+	struct Owner {
+		void* mAllocator;
+		void (*mFree)(void* allocator, void* pointer);
+	};
+
+	PageMap();
+	~PageMap();
+
+	void insert(const void* begin, size_t size, const Owner* owner);
+	void erase(const void* begin, size_t size);
+
+	const Owner* lookup(const void* pointer) const;
+
+	bool owns(const void* pointer) const;
+
+	void free(void* pointer) const;
+private:
+	PageMap(PageMap&) = delete;
+	PageMap(const PageMap&) = delete;
+
+	PageMap& operator=(PageMap&) = delete;
+	PageMap& operator=(const PageMap&) = delete;
+
+	struct Leaf {
+		std::atomic<const Owner*> mOwners[LevelSize];
+	};
+
+	struct Node {
+		std::atomic<Leaf*> mLeaves[LevelSize];
+	};
+
+	template <typename N>
+	static N* getOrMap(std::atomic<N*>& slot);
+
+	template <typename N>
+	static void unmap(N* node);
+
+	void set(uintptr_t page, const Owner* owner);
+
+	std::atomic<Node*> mNodes[LevelSize];
+};
+
+// The process wide map the allocators register in.
+PageMap& getPageMap();
+
+
+inline PageMap::PageMap() {
+	for (auto& node : mNodes) { node.store(nullptr, std::memory_order_relaxed); }
+}
+
+inline PageMap::~PageMap() {
+	for (auto& slot : mNodes) {
+		Node* node = slot.load(std::memory_order_relaxed);
+		if (!node) { continue; }
+
+		for (auto& leaf : node->mLeaves) {
+			if (Leaf* pointer = leaf.load(std::memory_order_relaxed)) { unmap(pointer); }
+		}
+
+		unmap(node);
+	}
+}
+
+inline void PageMap::insert(const void* begin, size_t size, const Owner* owner) {
+	assert(owner && size != 0);
+
+	auto first = reinterpret_cast<uintptr_t>(begin) >> PageShift;
+	auto last  = (reinterpret_cast<uintptr_t>(begin) + size - 1) >> PageShift;
+
+	for (uintptr_t page = first; page <= last; ++page) { set(page, owner); }
+}
+
+inline void PageMap::erase(const void* begin, size_t size) {
+	assert(size != 0);
+
+	auto first = reinterpret_cast<uintptr_t>(begin) >> PageShift;
+	auto last  = (reinterpret_cast<uintptr_t>(begin) + size - 1) >> PageShift;
+
+	for (uintptr_t page = first; page <= last; ++page) { set(page, nullptr); }
+}
+
+inline const PageMap::Owner* PageMap::lookup(const void* pointer) const {
+	auto page = reinterpret_cast<uintptr_t>(pointer) >> PageShift;
+
+	if (page >> (3 * LevelBits)) { return nullptr; }
+
+	Node* node = mNodes[page >> (2 * LevelBits)].load(std::memory_order_acquire);
+	if (!node) { return nullptr; }
+
+	Leaf* leaf = node->mLeaves[(page >> LevelBits) & (LevelSize - 1)].load(std::memory_order_acquire);
+	if (!leaf) { return nullptr; }
+
+	return leaf->mOwners[page & (LevelSize - 1)].load(std::memory_order_acquire);
+}
+
+inline bool PageMap::owns(const void* pointer) const {
+	return lookup(pointer) != nullptr;
+}
+
+inline void PageMap::free(void* pointer) const {
+	const Owner* owner = lookup(pointer);
+
+	assert(owner && "PageMap::free of a pointer no allocator registered");
+
+	owner->mFree(owner->mAllocator, pointer);
+}
+
+template <typename N>
+N* PageMap::getOrMap(std::atomic<N*>& slot) {
+	N* node = slot.load(std::memory_order_acquire);
+	if (node) { return node; }
+
+	// Anonymous pages come zeroed, which is a valid empty node. Two racing inserts may both map
+	// one; the loser unmaps its copy.
+	void* mapping = mmap(nullptr, sizeof(N), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	assert(mapping != MAP_FAILED);
+
+	auto* created = reinterpret_cast<N*>(mapping);
+
+	if (slot.compare_exchange_strong(node, created, std::memory_order_acq_rel, std::memory_order_acquire)) {
+		return created;
+	}
+
+	unmap(created);
+
+	return node;
+}
+
+template <typename N>
+void PageMap::unmap(N* node) {
+	munmap(node, sizeof(N));
+}
+
+inline void PageMap::set(uintptr_t page, const Owner* owner) {
+	assert(!(page >> (3 * LevelBits)) && "PageMap covers 48-bit addresses only");
+
+	std::atomic<Node*>& nodeSlot = mNodes[page >> (2 * LevelBits)];
+
+	if (!owner && !nodeSlot.load(std::memory_order_acquire)) { return; }
+
+	std::atomic<Leaf*>& leafSlot = getOrMap(nodeSlot)->mLeaves[(page >> LevelBits) & (LevelSize - 1)];
+
+	if (!owner && !leafSlot.load(std::memory_order_acquire)) { return; }
+
+	getOrMap(leafSlot)->mOwners[page & (LevelSize - 1)].store(owner, std::memory_order_release);
+}
+
+inline PageMap& getPageMap() {
+	static PageMap pageMap;
+	return pageMap;
+}
+
+} // namespace simple
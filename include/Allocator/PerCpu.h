@@ -0,0 +1,519 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#pragma once
+
+#include "Allocator.h"
+#include "Allocator/Pool.h"
+
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+#if defined(__x86_64__) && defined(__linux__) && defined(__GLIBC__) \
+		&& (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 35))
+#define SIMPLE_ALLOCATOR_HAS_RSEQ 1
+#include <sys/rseq.h>
+#endif
+
+namespace simple {
+namespace allocator {
+
+constexpr uint32_t CpuCacheCapacity = 63;
+
+struct alignas(64) CpuCache {
+	uint32_t mCount;
+	uint32_t mPadding;
+	void*    mItems[CpuCacheCapacity];
+};
+
+enum RseqStatus : uint32_t {
+	RseqDone    = 0,
+	RseqAborted = 1, // Preempted, migrated or signalled: nothing was committed, try again.
+	RseqFull    = 2,
+};
+
+bool isRseqAvailable();
+
+// Both run as restartable sequences on the cache of the given cpu: they commit with a single store
+// and the kernel restarts them at the abort handler if the thread leaves the cpu in between.
+uint32_t getRseqCpu();
+uint32_t rseqPop(CpuCache* cache, uint32_t cpu, void** item);
+uint32_t rseqPush(CpuCache* cache, uint32_t cpu, void* item);
+
+// Caches of the fallback mode, owned by the thread. At thread exit every cache is handed to
+// mFlush under the owner registry lock, which skips owners that no longer exist.
+struct ThreadCache {
+	uint64_t mOwnerId;
+	void (*mFlush)(void* owner, CpuCache& cache);
+	CpuCache mCache;
+};
+
+std::mutex& getOwnerMutex();
+std::unordered_map<uint64_t, void*>& getOwners();
+
+std::vector<ThreadCache*>& getThreadCaches();
+
+
+#if defined(SIMPLE_ALLOCATOR_HAS_RSEQ)
+
+inline struct rseq* getRseq() {
+	return reinterpret_cast<struct rseq*>(reinterpret_cast<uint8_t*>(__builtin_thread_pointer()) + __rseq_offset);
+}
+
+inline bool isRseqAvailable() {
+	return __rseq_size > 0 && static_cast<int32_t>(getRseq()->cpu_id) >= 0;
+}
+
+inline uint32_t getRseqCpu() {
+	return *reinterpret_cast<volatile uint32_t*>(&getRseq()->cpu_id_start);
+}
+
+// The critical section descriptor goes to __rseq_cs, the abort handler to __rseq_failure behind
+// the signature glibc registered (RSEQ_SIG, 0x53053053 on x86).
+#define SIMPLE_RSEQ_BEGIN \
+		".pushsection __rseq_cs, \"aw\"\n\t" \
+		".balign 32\n\t" \
+		"3:\n\t" \
+		".long 0x0, 0x0\n\t" \
+		".quad 1f, (2f - 1f), 4f\n\t" \
+		".popsection\n\t" \
+		"leaq 3b(%%rip), %%rax\n\t" \
+		"movq %%rax, 8(%[rseq])\n\t" \
+		"1:\n\t" \
+		"xorl %k[status], %k[status]\n\t" \
+		"cmpl %[cpu], 4(%[rseq])\n\t" \
+		"jnz 4f\n\t"
+
+#define SIMPLE_RSEQ_END \
+		"2:\n\t" \
+		".pushsection __rseq_failure, \"ax\"\n\t" \
+		".byte 0x0f, 0xb9, 0x3d\n\t" \
+		".long 0x53053053\n\t" \
+		"4:\n\t" \
+		"movl $1, %k[status]\n\t" \
+		"jmp 5f\n\t" \
+		".popsection\n\t" \
+		"5:\n\t"
+
+inline uint32_t rseqPop(CpuCache* cache, uint32_t cpu, void** item) {
+	uint64_t status;
+	void* result = nullptr;
+
+	asm volatile (
+		SIMPLE_RSEQ_BEGIN
+		"movl (%[cache]), %%ecx\n\t"
+		"testl %%ecx, %%ecx\n\t"
+		"jz 2f\n\t"
+		"subl $1, %%ecx\n\t"
+		"movq 8(%[cache], %%rcx, 8), %[result]\n\t"
+		"movl %%ecx, (%[cache])\n\t"
+		SIMPLE_RSEQ_END
+		: [status] "=&r" (status), [result] "+&r" (result)
+		: [rseq] "r" (getRseq()), [cpu] "r" (cpu), [cache] "r" (cache)
+		: "rax", "rcx", "memory", "cc");
+
+	*item = result;
+
+	return static_cast<uint32_t>(status);
+}
+
+inline uint32_t rseqPush(CpuCache* cache, uint32_t cpu, void* item) {
+	uint64_t status;
+
+	asm volatile (
+		SIMPLE_RSEQ_BEGIN
+		"movl (%[cache]), %%ecx\n\t"
+		"cmpl %[capacity], %%ecx\n\t"
+		"jb 6f\n\t"
+		"movl $2, %k[status]\n\t"
+		"jmp 2f\n\t"
+		"6:\n\t"
+		"movq %[item], 8(%[cache], %%rcx, 8)\n\t"
+		"addl $1, %%ecx\n\t"
+		"movl %%ecx, (%[cache])\n\t"
+		SIMPLE_RSEQ_END
+		: [status] "=&r" (status)
+		: [rseq] "r" (getRseq()), [cpu] "r" (cpu), [cache] "r" (cache), [item] "r" (item),
+		  [capacity] "i" (CpuCacheCapacity)
+		: "rax", "rcx", "memory", "cc");
+
+	return static_cast<uint32_t>(status);
+}
+
+#undef SIMPLE_RSEQ_BEGIN
+#undef SIMPLE_RSEQ_END
+
+#else
+
+inline bool isRseqAvailable() {
+	return false;
+}
+
+inline uint32_t getRseqCpu() {
+	return 0;
+}
+
+inline uint32_t rseqPop(CpuCache*, uint32_t, void** item) {
+	*item = nullptr;
+	return RseqDone;
+}
+
+inline uint32_t rseqPush(CpuCache*, uint32_t, void*) {
+	return RseqFull;
+}
+
+#endif
+
+inline std::mutex& getOwnerMutex() {
+	static std::mutex mutex;
+	return mutex;
+}
+
+inline std::unordered_map<uint64_t, void*>& getOwners() {
+	static std::unordered_map<uint64_t, void*> owners;
+	return owners;
+}
+
+inline std::vector<ThreadCache*>& getThreadCaches() {
+	struct ThreadCaches {
+		~ThreadCaches() {
+			std::lock_guard<std::mutex> lock(getOwnerMutex());
+
+			for (ThreadCache* cache : mCaches) {
+				auto owner = getOwners().find(cache->mOwnerId);
+				if (owner != getOwners().end()) { cache->mFlush(owner->second, cache->mCache); }
+
+				delete cache;
+			}
+		}
+
+		std::vector<ThreadCache*> mCaches;
+	};
+
+	static thread_local ThreadCaches caches;
+	return caches.mCaches;
+}
+
+} // namespace allocator
+
+// Thread safe PoolAllocator with a small cache of free slots per cpu in front of it. With rseq
+// (Linux 4.18+, glibc 2.35+, x86-64) allocate and free run as restartable sequences on the cache of
+// the current cpu, with no atomics and no lock; only a cache miss takes the pool lock and moves a
+// batch. Cached memory is bounded by the number of cpus, not threads. Without rseq every thread
+// gets a cache of its own instead.
+template <typename T>
+class PerCpuPoolAllocator {
+public:
+	enum class CacheMode {
+		PerCpu,      // Falls back to ThreadLocal when rseq is not available.
+		ThreadLocal,
+	};
+
+	static constexpr uint32_t BatchSize = 32;
+
+	PerCpuPoolAllocator(uint32_t numObjects, CacheMode mode = CacheMode::PerCpu);
+	~PerCpuPoolAllocator();
+
+	CacheMode getCacheMode() const;
+
+	uint32_t getNumTotalObjects() const;
+
+	// Slots parked in caches are not counted.
+	uint32_t getNumFreeObjects();
+
+	template <typename... Args>
+	T* create(Args&&... args);
+
+	T* createNoConstruct();
+
+	void remove(T* object);
+	void removeNoDestruct(T* object);
+
+	// Returns the slots of every cpu cache and of the calling thread's cache to the pool.
+	// Per-cpu caches are drained directly, so no other thread may use the allocator meanwhile.
+	void flush();
+private:
+	PerCpuPoolAllocator(PerCpuPoolAllocator&) = delete;
+	PerCpuPoolAllocator(const PerCpuPoolAllocator&) = delete;
+
+	PerCpuPoolAllocator& operator=(PerCpuPoolAllocator&) = delete;
+	PerCpuPoolAllocator& operator=(const PerCpuPoolAllocator&) = delete;
+
+	void* allocate();
+	void free(void* object);
+
+	void* allocateSlow(allocator::CpuCache* threadCache);
+	void freeSlow(void* object, allocator::CpuCache* threadCache);
+
+	allocator::CpuCache* getThreadCache();
+
+	static void flushThreadCache(void* owner, allocator::CpuCache& cache);
+
+	void drain(allocator::CpuCache& cache);
+
+	PoolAllocator<T> mPool;
+	std::mutex       mMutex;
+
+	allocator::CpuCache* mCpuCaches;
+	uint32_t             mNumCpus;
+
+	CacheMode mMode;
+	uint64_t  mId;
+};
+
+
+template <typename T>
+PerCpuPoolAllocator<T>::PerCpuPoolAllocator(uint32_t numObjects, CacheMode mode)
+		: mPool(numObjects)
+		, mCpuCaches(nullptr)
+		, mNumCpus(0)
+		, mMode(mode)
+		, mId(0) {
+	static std::atomic<uint64_t> lastId(0);
+
+	mId = lastId.fetch_add(1, std::memory_order_relaxed) + 1;
+
+	if (mMode == CacheMode::PerCpu && !allocator::isRseqAvailable()) { mMode = CacheMode::ThreadLocal; }
+
+	if (mMode == CacheMode::PerCpu) {
+		mNumCpus   = static_cast<uint32_t>(sysconf(_SC_NPROCESSORS_CONF));
+		mCpuCaches = reinterpret_cast<allocator::CpuCache*>(
+				std::aligned_alloc(alignof(allocator::CpuCache), mNumCpus * sizeof(allocator::CpuCache)));
+
+		for (uint32_t cpu = 0; cpu < mNumCpus; ++cpu) { mCpuCaches[cpu].mCount = 0; }
+	}
+
+	std::lock_guard<std::mutex> lock(allocator::getOwnerMutex());
+	allocator::getOwners().emplace(mId, this);
+}
+
+template <typename T>
+PerCpuPoolAllocator<T>::~PerCpuPoolAllocator() {
+	{
+		std::lock_guard<std::mutex> lock(allocator::getOwnerMutex());
+		allocator::getOwners().erase(mId);
+	}
+
+	std::free(mCpuCaches);
+}
+
+template <typename T>
+typename PerCpuPoolAllocator<T>::CacheMode PerCpuPoolAllocator<T>::getCacheMode() const {
+	return mMode;
+}
+
+template <typename T>
+uint32_t PerCpuPoolAllocator<T>::getNumTotalObjects() const {
+	return mPool.getNumTotalObjects();
+}
+
+template <typename T>
+uint32_t PerCpuPoolAllocator<T>::getNumFreeObjects() {
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mPool.getNumFreeObjects();
+}
+
+template <typename T>
+template <typename... Args>
+T* PerCpuPoolAllocator<T>::create(Args&&... args) {
+	return new (allocate()) T(std::forward<Args>(args)...);
+}
+
+template <typename T>
+T* PerCpuPoolAllocator<T>::createNoConstruct() {
+	return reinterpret_cast<T*>(allocate());
+}
+
+template <typename T>
+void PerCpuPoolAllocator<T>::remove(T* object) {
+	assert(object);
+	object->~T();
+	free(object);
+}
+
+template <typename T>
+void PerCpuPoolAllocator<T>::removeNoDestruct(T* object) {
+	assert(object);
+	free(object);
+}
+
+template <typename T>
+void PerCpuPoolAllocator<T>::flush() {
+	for (uint32_t cpu = 0; cpu < mNumCpus; ++cpu) { drain(mCpuCaches[cpu]); }
+
+	if (mMode == CacheMode::ThreadLocal) { drain(*getThreadCache()); }
+}
+
+template <typename T>
+void* PerCpuPoolAllocator<T>::allocate() {
+	if (mMode == CacheMode::ThreadLocal) {
+		allocator::CpuCache* cache = getThreadCache();
+
+		if (cache->mCount) { return cache->mItems[--cache->mCount]; }
+
+		return allocateSlow(cache);
+	}
+
+	for (;;) {
+		uint32_t cpu = allocator::getRseqCpu();
+		if (cpu >= mNumCpus) { break; }
+
+		void* item;
+
+		if (allocator::rseqPop(&mCpuCaches[cpu], cpu, &item) == allocator::RseqAborted) { continue; }
+		if (item) { return item; }
+
+		break;
+	}
+
+	return allocateSlow(nullptr);
+}
+
+template <typename T>
+void PerCpuPoolAllocator<T>::free(void* object) {
+	if (mMode == CacheMode::ThreadLocal) {
+		allocator::CpuCache* cache = getThreadCache();
+
+		if (cache->mCount < allocator::CpuCacheCapacity) {
+			cache->mItems[cache->mCount++] = object;
+			return;
+		}
+
+		freeSlow(object, cache);
+		return;
+	}
+
+	for (;;) {
+		uint32_t cpu = allocator::getRseqCpu();
+		if (cpu >= mNumCpus) { break; }
+
+		uint32_t status = allocator::rseqPush(&mCpuCaches[cpu], cpu, object);
+
+		if (status == allocator::RseqDone) { return; }
+		if (status == allocator::RseqFull) { break; }
+	}
+
+	freeSlow(object, nullptr);
+}
+
+template <typename T>
+void* PerCpuPoolAllocator<T>::allocateSlow(allocator::CpuCache* threadCache) {
+	// Take a batch from the pool, hand out one slot and cache the rest.
+	T* batch[BatchSize];
+	uint32_t count;
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		count = mPool.getNumFreeObjects() < BatchSize ? mPool.getNumFreeObjects() : BatchSize;
+
+		assert(count > 0 && "PerCpuPoolAllocator is out of memory");
+
+		mPool.createBatchNoConstruct(count, batch);
+	}
+
+	uint32_t next = 1;
+
+	if (threadCache) {
+		for (; next < count; ++next) { threadCache->mItems[threadCache->mCount++] = batch[next]; }
+	} else {
+		while (next < count) {
+			uint32_t cpu = allocator::getRseqCpu();
+			if (cpu >= mNumCpus) { break; }
+
+			uint32_t status = allocator::rseqPush(&mCpuCaches[cpu], cpu, batch[next]);
+
+			if (status == allocator::RseqDone) { ++next; }
+			if (status == allocator::RseqFull) { break; }
+		}
+
+		// Another thread on this cpu filled the cache meanwhile.
+		if (next < count) {
+			std::lock_guard<std::mutex> lock(mMutex);
+			mPool.removeBatchNoDestruct(batch + next, count - next);
+		}
+	}
+
+	return batch[0];
+}
+
+template <typename T>
+void PerCpuPoolAllocator<T>::freeSlow(void* object, allocator::CpuCache* threadCache) {
+	// The cache is full: send the object and half a cache worth of slots back to the pool.
+	T* batch[BatchSize + 1];
+	uint32_t count = 0;
+
+	batch[count++] = reinterpret_cast<T*>(object);
+
+	if (threadCache) {
+		while (count <= BatchSize) { batch[count++] = reinterpret_cast<T*>(threadCache->mItems[--threadCache->mCount]); }
+	} else {
+		while (count <= BatchSize) {
+			uint32_t cpu = allocator::getRseqCpu();
+			if (cpu >= mNumCpus) { break; }
+
+			void* item;
+			uint32_t status = allocator::rseqPop(&mCpuCaches[cpu], cpu, &item);
+
+			if (status == allocator::RseqAborted) { continue; }
+			if (!item) { break; }
+
+			batch[count++] = reinterpret_cast<T*>(item);
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	mPool.removeBatchNoDestruct(batch, count);
+}
+
+template <typename T>
+allocator::CpuCache* PerCpuPoolAllocator<T>::getThreadCache() {
+	static thread_local allocator::ThreadCache* last = nullptr;
+
+	if (last && last->mOwnerId == mId) { return &last->mCache; }
+
+	std::vector<allocator::ThreadCache*>& caches = allocator::getThreadCaches();
+
+	for (allocator::ThreadCache* cache : caches) {
+		if (cache->mOwnerId == mId) {
+			last = cache;
+			return &cache->mCache;
+		}
+	}
+
+	auto* cache = new allocator::ThreadCache;
+
+	cache->mOwnerId       = mId;
+	cache->mFlush         = &flushThreadCache;
+	cache->mCache.mCount  = 0;
+
+	caches.push_back(cache);
+
+	last = cache;
+
+	return &cache->mCache;
+}
+
+template <typename T>
+void PerCpuPoolAllocator<T>::flushThreadCache(void* owner, allocator::CpuCache& cache) {
+	reinterpret_cast<PerCpuPoolAllocator*>(owner)->drain(cache);
+}
+
+template <typename T>
+void PerCpuPoolAllocator<T>::drain(allocator::CpuCache& cache) {
+	if (!cache.mCount) { return; }
+
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	mPool.removeBatchNoDestruct(reinterpret_cast<T* const*>(cache.mItems), cache.mCount);
+	cache.mCount = 0;
+}
+
+} // namespace simple
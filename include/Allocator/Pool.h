@@ -3,18 +3,35 @@
 #pragma once
 
 #include "Allocator.h"
+#include "Allocator/PageMap.h"
 
 #include <cassert>
+#include <chrono>
+#include <cstddef>
 #include <cstdlib>
 #include <cstdint>
+#include <cstring>
 #include <utility>
 
+#include <sys/mman.h>
+#include <unistd.h>
+
 namespace simple {
 
-template <typename T>
+enum PoolFlags : uint32_t {
+	PoolFlagNone           = 0,
+	PoolFlagOccupancy      = 1 << 0, // Keep a bitmap of live slots, required by forEachLive, compact and trim.
+	PoolFlagAddressOrdered = 1 << 1, // Always hand out the lowest free slot, requires PoolFlagOccupancy.
+};
+
+template <typename T, uint32_t Flags = PoolFlagNone>
 class PoolAllocator {
+	static_assert((Flags & PoolFlagAddressOrdered) == 0 || (Flags & PoolFlagOccupancy) != 0,
+			"PoolFlagAddressOrdered requires PoolFlagOccupancy");
 public:
-	PoolAllocator(uint32_t numObjects);
+	// Given a PageMap, the pool takes whole pages for its objects and registers them for its
+	// lifetime, so PageMap::free routes to removeNoDestruct.
+	PoolAllocator(uint32_t numObjects, PageMap* pageMap = nullptr);
 	~PoolAllocator();
 
 	void clean();
@@ -22,6 +39,8 @@ public:
 	uint32_t getNumTotalObjects() const;
 	uint32_t getNumFreeObjects() const;
 
+	uint32_t getIndex(const T* object) const;
+
 	template <typename... Args>
 	T* create(Args&&... args);
 
@@ -29,108 +48,763 @@ public:
 
 	void remove(T* object);
 	void removeNoDestruct(T* object);
+
+	// Batch versions pop or push a whole run of slots in one pass and update the counters once.
+	template <typename... Args>
+	void createBatch(uint32_t count, T** objects, const Args&... args);
+
+	void createBatchNoConstruct(uint32_t count, T** objects);
+
+	void removeBatch(T* const* objects, uint32_t count);
+	void removeBatchNoDestruct(T* const* objects, uint32_t count);
+
+	// Visits every live object in ascending address order.
+	template <typename F>
+	void forEachLive(F&& function);
+
+	// Moves live objects into the lowest free slots by move construction and reports every move
+	// as onMoved(from, to). Stops when the budget runs out; returns true once no free slot is left
+	// below a live object, so the pool can be compacted incrementally across several calls. The
+	// first call of a pass sorts the free list, every further call only touches the slots it moves.
+	// Slots freed while a pass is in progress may be left for the next pass.
+	template <typename F>
+	bool compact(F&& onMoved, std::chrono::nanoseconds budget = std::chrono::nanoseconds::max());
+
+	// Same as compact, but relocate(from, to) does the move itself: it must leave a live object at
+	// the raw slot `to` and end the lifetime of `from`.
+	template <typename R>
+	bool compactRelocate(R&& relocate, std::chrono::nanoseconds budget = std::chrono::nanoseconds::max());
+
+	// Returns whole pages covered only by free slots to the OS and returns the number of bytes newly
+	// released. Slots on released pages are tracked outside of them and handed out again only when
+	// the free list is empty. With lazy the kernel reclaims the pages only under memory pressure.
+	size_t trim(bool lazy = false);
+
+	// Relinks the free list in ascending address order from the occupancy bitmap without touching
+	// live objects, so objects allocated together end up next to each other again after churn.
+	// Pages released by trim stay released.
+	void sortFreeList();
 private:
+	struct Run {
+		uint32_t mBegin;
+		uint32_t mEnd;
+	};
+
 	void* allocate();
 	void free(void* pointer);
+	void allocateBatch(uint32_t count, void** pointers);
+	void freeBatch(void* const* pointers, uint32_t count);
 	void freeListInit();
+	void carveRefill();
+	uint32_t takeLowestFree(uint32_t end);
+	void takeLowestReleased();
+
+	bool isLive(uint32_t index) const;
+	uint32_t findFree(uint32_t begin) const;
+	uint32_t findLive(uint32_t begin) const;
+	uint32_t findLastLive(uint32_t end) const;
+	size_t getReleasedSize(Run run) const;
+
+	uint32_t getIndex(const void* pointer) const;
+	T* getObject(uint32_t index) const;
+
+	size_t getPageMapSize() const;
 
 	void*  mMemory;
 	void** mFreeList;
 
+	uint64_t* mOccupancy;
+	uint32_t  mNumOccupancyWords;
+
+	// Free slots in [mCarveBegin, mCarveEnd) are not linked into the free list and are served by
+	// bumping mCarveBegin, so a fresh or cleaned pool touches no memory. Once the range runs out it
+	// is refilled from the runs released by trim.
+	uint32_t mCarveBegin;
+	uint32_t mCarveEnd;
+
+	// With PoolFlagAddressOrdered the bitmap replaces the free list, all slots below are live.
+	uint32_t mLowestFree;
+
+	// Slots compaction vacated above the live range, handed out once the free list is empty.
+	void** mHighFreeList;
+
+	// No slot at or above it is live. A compaction pass in progress keeps its cursor here.
+	uint32_t mLiveEnd;
+	bool     mCompacting;
+
+	Run*     mReleased;
+	uint32_t mNumReleased;
+	size_t   mReleasedSize;
+
 	uint32_t mNumTotalObjects;
 	uint32_t mNumFreeObjects;
 	uint8_t  mAdjustment;
+
+	PageMap*       mPageMap;
+	PageMap::Owner mPageOwner;
 };
 
 
-template <typename T>
-PoolAllocator<T>::PoolAllocator(uint32_t numObjects) : mFreeList(nullptr), mAdjustment(0) {
+template <typename T, uint32_t Flags>
+PoolAllocator<T, Flags>::PoolAllocator(uint32_t numObjects, PageMap* pageMap)
+		: mFreeList(nullptr)
+		, mOccupancy(nullptr)
+		, mNumOccupancyWords(0)
+		, mCarveBegin(0)
+		, mCarveEnd(0)
+		, mLowestFree(0)
+		, mHighFreeList(nullptr)
+		, mLiveEnd(0)
+		, mCompacting(false)
+		, mReleased(nullptr)
+		, mNumReleased(0)
+		, mReleasedSize(0)
+		, mAdjustment(0)
+		, mPageMap(pageMap)
+		, mPageOwner { this, [](void* allocator, void* pointer) {
+			reinterpret_cast<PoolAllocator*>(allocator)->removeNoDestruct(reinterpret_cast<T*>(pointer));
+		} } {
 	assert(sizeof(T) >= sizeof(void*));
 
-	mMemory = std::malloc(numObjects * sizeof(T));
-	mAdjustment = allocator::alignForwardAdjustment(mMemory, alignof(T));
 	mNumTotalObjects = mNumFreeObjects = numObjects;
+
+	if (mPageMap) {
+		// No other allocation may share a page with a registered pool.
+		mMemory = std::aligned_alloc(static_cast<size_t>(sysconf(_SC_PAGESIZE)), getPageMapSize());
+		mPageMap->insert(mMemory, getPageMapSize(), &mPageOwner);
+	} else {
+		mMemory = std::malloc(numObjects * sizeof(T));
+	}
+
+	mAdjustment = allocator::alignForwardAdjustment(mMemory, alignof(T));
+
+	if constexpr ((Flags & PoolFlagOccupancy) != 0) {
+		mNumOccupancyWords = (numObjects + 63) / 64;
+		mOccupancy = reinterpret_cast<uint64_t*>(std::calloc(mNumOccupancyWords, sizeof(uint64_t)));
+	}
+
 	freeListInit();
 }
 
-template <typename T>
-PoolAllocator<T>::~PoolAllocator() {
+template <typename T, uint32_t Flags>
+PoolAllocator<T, Flags>::~PoolAllocator() {
+	if (mPageMap) { mPageMap->erase(mMemory, getPageMapSize()); }
+
+	std::free(mReleased);
+	std::free(mOccupancy);
 	std::free(mMemory);
 }
 
-template <typename T>
-void PoolAllocator<T>::clean() {
+template <typename T, uint32_t Flags>
+void PoolAllocator<T, Flags>::clean() {
 	mNumFreeObjects = mNumTotalObjects;
+
+	if constexpr ((Flags & PoolFlagOccupancy) != 0) {
+		std::memset(mOccupancy, 0, mNumOccupancyWords * sizeof(uint64_t));
+	}
+
 	freeListInit();
 }
 
-template <typename T>
-void* PoolAllocator<T>::allocate() {
+template <typename T, uint32_t Flags>
+void* PoolAllocator<T, Flags>::allocate() {
 	assert(mNumFreeObjects > 0);
-	assert(mFreeList);
+
+	if constexpr ((Flags & PoolFlagAddressOrdered) != 0) {
+		uint32_t index = takeLowestFree(mNumTotalObjects);
+		assert(index < mNumTotalObjects);
+
+		mOccupancy[index / 64] |= uint64_t(1) << (index % 64);
+
+		if (index >= mLiveEnd) { mLiveEnd = index + 1; }
+
+		--mNumFreeObjects;
+
+		return getObject(index);
+	}
 
 	void* pointer = mFreeList;
-	mFreeList = reinterpret_cast<void**>(*mFreeList);
+
+	if (pointer) {
+		mFreeList = reinterpret_cast<void**>(*mFreeList);
+	} else if (mHighFreeList) {
+		pointer = mHighFreeList;
+		mHighFreeList = reinterpret_cast<void**>(*mHighFreeList);
+	} else {
+		if (mCarveBegin == mCarveEnd) { carveRefill(); }
+		pointer = getObject(mCarveBegin++);
+	}
 
 	--mNumFreeObjects;
 
+	if constexpr ((Flags & PoolFlagOccupancy) != 0) {
+		uint32_t index = getIndex(pointer);
+		mOccupancy[index / 64] |= uint64_t(1) << (index % 64);
+
+		if (index >= mLiveEnd) { mLiveEnd = index + 1; }
+	}
+
 	return pointer;
 }
 
-template <typename T>
-void PoolAllocator<T>::free(void* pointer) {
+template <typename T, uint32_t Flags>
+void PoolAllocator<T, Flags>::free(void* pointer) {
 	assert(pointer >= mMemory);
 	assert(mNumFreeObjects < mNumTotalObjects);
 
+	if constexpr ((Flags & PoolFlagOccupancy) != 0) {
+		uint32_t index = getIndex(pointer);
+		assert(mOccupancy[index / 64] & (uint64_t(1) << (index % 64)));
+		mOccupancy[index / 64] &= ~(uint64_t(1) << (index % 64));
+
+		if constexpr ((Flags & PoolFlagAddressOrdered) != 0) {
+			if (index < mLowestFree) { mLowestFree = index; }
+
+			++mNumFreeObjects;
+			return;
+		}
+	}
+
 	*(reinterpret_cast<void**>(pointer)) = mFreeList;
 	mFreeList = reinterpret_cast<void**>(pointer);
 
 	++mNumFreeObjects;
 }
 
-template <typename T>
-void PoolAllocator<T>::freeListInit() {
-	mFreeList = reinterpret_cast<void**>(reinterpret_cast<uintptr_t>(mMemory) + mAdjustment);
-	void** pointer = mFreeList;
+template <typename T, uint32_t Flags>
+void PoolAllocator<T, Flags>::allocateBatch(uint32_t count, void** pointers) {
+	assert(count <= mNumFreeObjects);
+
+	if constexpr ((Flags & PoolFlagAddressOrdered) != 0) {
+		for (uint32_t i = 0; i < count; ++i) {
+			pointers[i] = allocate();
+		}
+
+		return;
+	}
+
+	uint32_t i = 0;
+	void** node = mFreeList;
+
+	for (; i < count && node; ++i) {
+		pointers[i] = node;
+		node = reinterpret_cast<void**>(*node);
+	}
+
+	mFreeList = node;
 
-	for (uint32_t i = 0; i < mNumTotalObjects - 1; ++i) {
-		*pointer = reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(pointer) + sizeof(T));
-		pointer = reinterpret_cast<void**>(*pointer);
+	for (node = mHighFreeList; i < count && node; ++i) {
+		pointers[i] = node;
+		node = reinterpret_cast<void**>(*node);
 	}
+
+	mHighFreeList = node;
+
+	// The rest comes from the carve range, which is contiguous and needs no loads at all.
+	while (i < count) {
+		if (mCarveBegin == mCarveEnd) { carveRefill(); }
+
+		uint32_t numCarved = count - i < mCarveEnd - mCarveBegin ? count - i : mCarveEnd - mCarveBegin;
+
+		T* object = getObject(mCarveBegin);
+		mCarveBegin += numCarved;
+
+		for (uint32_t end = i + numCarved; i < end; ++i) {
+			pointers[i] = object++;
+		}
+	}
+
+	mNumFreeObjects -= count;
+
+	if constexpr ((Flags & PoolFlagOccupancy) != 0) {
+		for (i = 0; i < count; ++i) {
+			uint32_t index = getIndex(pointers[i]);
+			mOccupancy[index / 64] |= uint64_t(1) << (index % 64);
+
+			if (index >= mLiveEnd) { mLiveEnd = index + 1; }
+		}
+	}
+}
+
+template <typename T, uint32_t Flags>
+void PoolAllocator<T, Flags>::freeBatch(void* const* pointers, uint32_t count) {
+	if (count == 0) { return; }
+
+	assert(mNumFreeObjects + count <= mNumTotalObjects);
+
+	if constexpr ((Flags & PoolFlagAddressOrdered) != 0) {
+		for (uint32_t i = 0; i < count; ++i) {
+			free(pointers[i]);
+		}
+
+		return;
+	}
+
+	// Link the batch into a sublist first, then splice it onto the free list once.
+	void* current = pointers[0];
+
+	for (uint32_t i = 1; i < count; ++i) {
+		void* next = pointers[i];
+		assert(current >= mMemory);
+
+		*(reinterpret_cast<void**>(current)) = next;
+		current = next;
+	}
+
+	*(reinterpret_cast<void**>(current)) = mFreeList;
+	mFreeList = reinterpret_cast<void**>(pointers[0]);
+
+	mNumFreeObjects += count;
+
+	if constexpr ((Flags & PoolFlagOccupancy) != 0) {
+		for (uint32_t i = 0; i < count; ++i) {
+			uint32_t index = getIndex(pointers[i]);
+			assert(mOccupancy[index / 64] & (uint64_t(1) << (index % 64)));
+			mOccupancy[index / 64] &= ~(uint64_t(1) << (index % 64));
+		}
+	}
+}
+
+template <typename T, uint32_t Flags>
+void PoolAllocator<T, Flags>::freeListInit() {
+	mFreeList     = nullptr;
+	mHighFreeList = nullptr;
+	mCarveBegin   = 0;
+	mCarveEnd     = mNumTotalObjects;
+	mLowestFree   = 0;
+	mLiveEnd      = 0;
+	mCompacting   = false;
+	mNumReleased  = 0;
+	mReleasedSize = 0;
 }
 
-template <typename T>
-uint32_t PoolAllocator<T>::getNumTotalObjects() const {
+template <typename T, uint32_t Flags>
+void PoolAllocator<T, Flags>::carveRefill() {
+	assert(mNumReleased > 0);
+
+	Run run = mReleased[--mNumReleased];
+
+	mReleasedSize -= getReleasedSize(run);
+
+	mCarveBegin = run.mBegin;
+	mCarveEnd   = run.mEnd;
+}
+
+template <typename T, uint32_t Flags>
+uint32_t PoolAllocator<T, Flags>::takeLowestFree(uint32_t end) {
+	// Returns mNumTotalObjects if no free slot is left below end.
+	if constexpr ((Flags & PoolFlagAddressOrdered) != 0) {
+		uint32_t index = findFree(mLowestFree);
+		if (index >= end) { return mNumTotalObjects; }
+
+		mLowestFree = index + 1;
+
+		// Every slot below is live, so a released run holding the slot is the lowest one and
+		// starts with it.
+		if (mNumReleased > 0 && mReleased[mNumReleased - 1].mBegin == index) { takeLowestReleased(); }
+
+		return index;
+	}
+
+	// The free list is address ordered during a pass, so its head is its lowest slot. The carve
+	// range and released runs are consumed from their lowest slot as well.
+	uint32_t listIndex  = mFreeList ? getIndex(static_cast<const void*>(mFreeList)) : mNumTotalObjects;
+	uint32_t carveIndex = mCarveBegin < mCarveEnd ? mCarveBegin : mNumTotalObjects;
+	uint32_t runIndex   = mNumReleased > 0 ? mReleased[mNumReleased - 1].mBegin : mNumTotalObjects;
+
+	if (listIndex < end && listIndex < carveIndex && listIndex < runIndex) {
+		mFreeList = reinterpret_cast<void**>(*mFreeList);
+		return listIndex;
+	}
+
+	if (carveIndex < end && carveIndex < runIndex) { return mCarveBegin++; }
+
+	if (runIndex < end) {
+		takeLowestReleased();
+		return runIndex;
+	}
+
 	return mNumTotalObjects;
 }
 
-template <typename T>
-uint32_t PoolAllocator<T>::getNumFreeObjects() const {
+template <typename T, uint32_t Flags>
+void PoolAllocator<T, Flags>::takeLowestReleased() {
+	Run& run = mReleased[mNumReleased - 1];
+
+	size_t size = getReleasedSize(run);
+
+	++run.mBegin;
+	mReleasedSize -= size - getReleasedSize(run);
+
+	if (run.mBegin == run.mEnd) { --mNumReleased; }
+}
+
+template <typename T, uint32_t Flags>
+bool PoolAllocator<T, Flags>::isLive(uint32_t index) const {
+	return (mOccupancy[index / 64] >> (index % 64)) & 1;
+}
+
+template <typename T, uint32_t Flags>
+uint32_t PoolAllocator<T, Flags>::findFree(uint32_t begin) const {
+	for (uint32_t i = begin / 64; i < mNumOccupancyWords; ++i) {
+		uint64_t freeBits = ~mOccupancy[i];
+		if (i == begin / 64) { freeBits &= ~uint64_t(0) << (begin % 64); }
+
+		if (freeBits) {
+			uint32_t index = i * 64 + allocator::countTrailingZeros(freeBits);
+			return index < mNumTotalObjects ? index : mNumTotalObjects;
+		}
+	}
+
+	return mNumTotalObjects;
+}
+
+template <typename T, uint32_t Flags>
+uint32_t PoolAllocator<T, Flags>::findLive(uint32_t begin) const {
+	for (uint32_t i = begin / 64; i < mNumOccupancyWords; ++i) {
+		uint64_t liveBits = mOccupancy[i];
+		if (i == begin / 64) { liveBits &= ~uint64_t(0) << (begin % 64); }
+
+		if (liveBits) { return i * 64 + allocator::countTrailingZeros(liveBits); }
+	}
+
+	return mNumTotalObjects;
+}
+
+template <typename T, uint32_t Flags>
+uint32_t PoolAllocator<T, Flags>::findLastLive(uint32_t end) const {
+	// Returns one past the index of the last live slot below end, 0 if there is none.
+	for (uint32_t i = (end + 63) / 64; i-- > 0;) {
+		uint64_t liveBits = mOccupancy[i];
+		if (i == end / 64) { liveBits &= (uint64_t(1) << (end % 64)) - 1; }
+
+		if (liveBits) { return i * 64 + 64 - allocator::countLeadingZeros(liveBits); }
+	}
+
+	return 0;
+}
+
+template <typename T, uint32_t Flags>
+size_t PoolAllocator<T, Flags>::getReleasedSize(Run run) const {
+	// Only the pages lying completely inside the run can be released.
+	auto pageMask = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE)) - 1;
+
+	uintptr_t begin = (reinterpret_cast<uintptr_t>(getObject(run.mBegin)) + pageMask) & ~pageMask;
+	uintptr_t end   = reinterpret_cast<uintptr_t>(getObject(run.mEnd)) & ~pageMask;
+
+	return begin < end ? end - begin : 0;
+}
+
+template <typename T, uint32_t Flags>
+uint32_t PoolAllocator<T, Flags>::getIndex(const T* object) const {
+	assert(object >= getObject(0) && object < getObject(mNumTotalObjects));
+	return getIndex(static_cast<const void*>(object));
+}
+
+template <typename T, uint32_t Flags>
+uint32_t PoolAllocator<T, Flags>::getIndex(const void* pointer) const {
+	auto offset = reinterpret_cast<uintptr_t>(pointer) - reinterpret_cast<uintptr_t>(getObject(0));
+	assert(offset % sizeof(T) == 0);
+
+	return static_cast<uint32_t>(offset / sizeof(T));
+}
+
+template <typename T, uint32_t Flags>
+T* PoolAllocator<T, Flags>::getObject(uint32_t index) const {
+	return reinterpret_cast<T*>(reinterpret_cast<uintptr_t>(mMemory) + mAdjustment) + index;
+}
+
+template <typename T, uint32_t Flags>
+size_t PoolAllocator<T, Flags>::getPageMapSize() const {
+	auto pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	return (mNumTotalObjects * sizeof(T) + pageSize - 1) & ~(pageSize - 1);
+}
+
+template <typename T, uint32_t Flags>
+uint32_t PoolAllocator<T, Flags>::getNumTotalObjects() const {
+	return mNumTotalObjects;
+}
+
+template <typename T, uint32_t Flags>
+uint32_t PoolAllocator<T, Flags>::getNumFreeObjects() const {
 	return mNumFreeObjects;
 }
 
-template <typename T>
+template <typename T, uint32_t Flags>
 template <typename... Args>
-T* PoolAllocator<T>::create(Args&&... args) {
+T* PoolAllocator<T, Flags>::create(Args&&... args) {
 	return new (allocate()) T(std::forward<Args>(args)...);
 }
 
-template <typename T>
-T* PoolAllocator<T>::createNoConstruct() {
+template <typename T, uint32_t Flags>
+T* PoolAllocator<T, Flags>::createNoConstruct() {
 	return reinterpret_cast<T*>(allocate());
 }
 
-template <typename T>
-void PoolAllocator<T>::remove(T* object) {
+template <typename T, uint32_t Flags>
+void PoolAllocator<T, Flags>::remove(T* object) {
 	assert(object);
 	object->~T();
 	free(object);
 }
 
-template <typename T>
-void PoolAllocator<T>::removeNoDestruct(T* object) {
+template <typename T, uint32_t Flags>
+void PoolAllocator<T, Flags>::removeNoDestruct(T* object) {
 	assert(object);
 	free(object);
 }
 
+template <typename T, uint32_t Flags>
+template <typename... Args>
+void PoolAllocator<T, Flags>::createBatch(uint32_t count, T** objects, const Args&... args) {
+	allocateBatch(count, reinterpret_cast<void**>(objects));
+
+	for (uint32_t i = 0; i < count; ++i) {
+		new (objects[i]) T(args...);
+	}
+}
+
+template <typename T, uint32_t Flags>
+void PoolAllocator<T, Flags>::createBatchNoConstruct(uint32_t count, T** objects) {
+	allocateBatch(count, reinterpret_cast<void**>(objects));
+}
+
+template <typename T, uint32_t Flags>
+void PoolAllocator<T, Flags>::removeBatch(T* const* objects, uint32_t count) {
+	for (uint32_t i = 0; i < count; ++i) {
+		assert(objects[i]);
+		objects[i]->~T();
+	}
+
+	freeBatch(reinterpret_cast<void* const*>(objects), count);
+}
+
+template <typename T, uint32_t Flags>
+void PoolAllocator<T, Flags>::removeBatchNoDestruct(T* const* objects, uint32_t count) {
+	freeBatch(reinterpret_cast<void* const*>(objects), count);
+}
+
+template <typename T, uint32_t Flags>
+template <typename F>
+void PoolAllocator<T, Flags>::forEachLive(F&& function) {
+	static_assert((Flags & PoolFlagOccupancy) != 0, "forEachLive requires PoolFlagOccupancy");
+
+	T* objects = getObject(0);
+
+	for (uint32_t i = 0; i < mNumOccupancyWords; ++i) {
+		i = allocator::findNonZeroWord(mOccupancy, i, mNumOccupancyWords);
+		if (i == mNumOccupancyWords) { break; }
+
+		uint64_t word = mOccupancy[i];
+
+		while (word) {
+			function(objects[i * 64 + allocator::countTrailingZeros(word)]);
+			word &= word - 1;
+		}
+	}
+}
+
+template <typename T, uint32_t Flags>
+template <typename F>
+bool PoolAllocator<T, Flags>::compact(F&& onMoved, std::chrono::nanoseconds budget) {
+	return compactRelocate([&](T* from, T* to) {
+		new (to) T(std::move(*from));
+		from->~T();
+		onMoved(from, to);
+	}, budget);
+}
+
+template <typename T, uint32_t Flags>
+template <typename R>
+bool PoolAllocator<T, Flags>::compactRelocate(R&& relocate, std::chrono::nanoseconds budget) {
+	static_assert((Flags & PoolFlagOccupancy) != 0, "compact requires PoolFlagOccupancy");
+
+	using Clock = std::chrono::steady_clock;
+
+	auto deadline = budget == std::chrono::nanoseconds::max() ? Clock::time_point::max() : Clock::now() + budget;
+
+	if (!mCompacting) {
+		if constexpr ((Flags & PoolFlagAddressOrdered) == 0) { sortFreeList(); }
+
+		mCompacting = true;
+	}
+
+	uint32_t liveEnd  = findLastLive(mLiveEnd);
+	uint32_t numMoves = 0;
+	bool     done     = false;
+
+	for (;;) {
+		// Reading the clock on every move would cost more than the moves of small objects.
+		if (numMoves > 0 && numMoves % 64 == 0 && Clock::now() >= deadline) { break; }
+
+		uint32_t liveIndex = liveEnd - 1;
+		uint32_t freeIndex = liveEnd > 0 ? takeLowestFree(liveIndex) : mNumTotalObjects;
+
+		if (freeIndex == mNumTotalObjects) {
+			done = true;
+			break;
+		}
+
+		relocate(getObject(liveIndex), getObject(freeIndex));
+
+		mOccupancy[freeIndex / 64] |= uint64_t(1) << (freeIndex % 64);
+		mOccupancy[liveIndex / 64] &= ~(uint64_t(1) << (liveIndex % 64));
+
+		// Vacated slots come in descending order, so the list ends up ascending.
+		if constexpr ((Flags & PoolFlagAddressOrdered) == 0) {
+			auto** pointer = reinterpret_cast<void**>(getObject(liveIndex));
+			*pointer = mHighFreeList;
+			mHighFreeList = pointer;
+		}
+
+		liveEnd = findLastLive(liveIndex);
+
+		++numMoves;
+	}
+
+	mLiveEnd = liveEnd;
+
+	if (done) { mCompacting = false; }
+
+	return done;
+}
+
+template <typename T, uint32_t Flags>
+size_t PoolAllocator<T, Flags>::trim(bool lazy) {
+	static_assert((Flags & PoolFlagOccupancy) != 0, "trim requires PoolFlagOccupancy");
+
+	auto pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+	if (!mReleased) {
+		// Released runs are separated by live slots and each one holds a page of its own.
+		uint32_t capacity = static_cast<uint32_t>(mNumTotalObjects * sizeof(T) / pageSize + 1);
+		mReleased = reinterpret_cast<Run*>(std::malloc(capacity * sizeof(Run)));
+	}
+
+	size_t previousSize = mReleasedSize;
+
+	mFreeList     = nullptr;
+	mHighFreeList = nullptr;
+	mCarveBegin   = 0;
+	mCarveEnd     = 0;
+	mNumReleased  = 0;
+	mReleasedSize = 0;
+
+	void** last = nullptr;
+
+	// Runs that are too short to cover a page are linked back in ascending address order.
+	for (uint32_t begin = findFree(0); begin < mNumTotalObjects; begin = findFree(begin)) {
+		Run run { begin, findLive(begin) };
+		size_t size = getReleasedSize(run);
+
+		if (size > 0) {
+			auto pageMask = static_cast<uintptr_t>(pageSize) - 1;
+			auto address  = (reinterpret_cast<uintptr_t>(getObject(run.mBegin)) + pageMask) & ~pageMask;
+
+#ifdef MADV_FREE
+			int advice = lazy ? MADV_FREE : MADV_DONTNEED;
+#else
+			int advice = MADV_DONTNEED;
+			(void)lazy;
+#endif
+
+			madvise(reinterpret_cast<void*>(address), size, advice);
+
+			mReleased[mNumReleased++] = run;
+			mReleasedSize += size;
+		} else {
+			for (uint32_t i = run.mBegin; i < run.mEnd; ++i) {
+				auto** pointer = reinterpret_cast<void**>(getObject(i));
+
+				if (last) { *last = pointer; } else { mFreeList = pointer; }
+				last = pointer;
+			}
+		}
+
+		begin = run.mEnd;
+	}
+
+	if (last) { *last = nullptr; }
+
+	// Runs are taken back from the end of the array, reverse it to reuse the lowest addresses first.
+	for (uint32_t i = 0; i < mNumReleased / 2; ++i) {
+		std::swap(mReleased[i], mReleased[mNumReleased - 1 - i]);
+	}
+
+	return mReleasedSize > previousSize ? mReleasedSize - previousSize : 0;
+}
+
+template <typename T, uint32_t Flags>
+void PoolAllocator<T, Flags>::sortFreeList() {
+	static_assert((Flags & PoolFlagOccupancy) != 0, "sortFreeList requires PoolFlagOccupancy");
+
+	uint32_t liveEnd = findLastLive(mNumTotalObjects);
+
+	// A carve range refilled from a released run may lie below the last live slot. Its untouched
+	// pages go back to the released runs instead of being linked into the free list.
+	if (mCarveBegin < mCarveEnd && mCarveEnd <= liveEnd) {
+		Run carve { mCarveBegin, mCarveEnd };
+		size_t size = getReleasedSize(carve);
+
+		if (size > 0) {
+			uint32_t position = 0;
+			while (position < mNumReleased && mReleased[position].mBegin > carve.mBegin) { ++position; }
+
+			std::memmove(mReleased + position + 1, mReleased + position, (mNumReleased - position) * sizeof(Run));
+
+			mReleased[position] = carve;
+			++mNumReleased;
+			mReleasedSize += size;
+		}
+	}
+
+	// Released runs are stored from the highest to the lowest address.
+	uint32_t run = mNumReleased;
+
+	mFreeList     = nullptr;
+	mHighFreeList = nullptr;
+
+	void** last = nullptr;
+
+	for (uint32_t i = 0; i < (liveEnd + 63) / 64; ++i) {
+		uint64_t freeBits = ~mOccupancy[i];
+
+		if (i == liveEnd / 64) { freeBits &= (uint64_t(1) << (liveEnd % 64)) - 1; }
+
+		while (freeBits) {
+			uint32_t index = i * 64 + allocator::countTrailingZeros(freeBits);
+			freeBits &= freeBits - 1;
+
+			while (run > 0 && mReleased[run - 1].mEnd <= index) { --run; }
+
+			if (run > 0 && mReleased[run - 1].mBegin <= index) { continue; }
+
+			auto** pointer = reinterpret_cast<void**>(getObject(index));
+
+			if (last) { *last = pointer; } else { mFreeList = pointer; }
+			last = pointer;
+		}
+	}
+
+	if (last) { *last = nullptr; }
+
+	// Everything above the last live slot is free, including slots freed after trim between the
+	// released runs there, and is carved in order. Those runs merge into the carve range; their
+	// pages stay released until they are carved.
+	uint32_t numAbove = 0;
+
+	while (numAbove < mNumReleased && mReleased[numAbove].mBegin >= liveEnd) {
+		mReleasedSize -= getReleasedSize(mReleased[numAbove]);
+		++numAbove;
+	}
+
+	if (numAbove > 0) {
+		std::memmove(mReleased, mReleased + numAbove, (mNumReleased - numAbove) * sizeof(Run));
+		mNumReleased -= numAbove;
+	}
+
+	mCarveBegin = liveEnd;
+	mCarveEnd   = mNumTotalObjects;
+}
+
 } // namespace simple
@@ -0,0 +1,324 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#pragma once
+
+#include "Allocator.h"
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+namespace simple {
+
+enum RingFlags : uint32_t {
+	RingFlagNone = 0,
+	RingFlagSpsc = 1 << 0, // One thread allocates while another one frees.
+};
+
+// Circular FIFO allocator over a caller-provided buffer: records are freed in the order they were
+// allocated. A record never wraps; when it does not fit before the end of the buffer, the tail is
+// skipped and the record starts at the beginning again. Allocation returns nullptr while the ring
+// is full, so a producer can wait for the consumer instead.
+template <uint32_t Flags = RingFlagNone>
+class RingAllocator {
+	struct Record {
+		uint32_t mSize;       // Whole record including the header and padding.
+		uint32_t mAdjustment; // From the record to the data, 0 marks a skipped tail.
+	};
+
+	using Counter = std::conditional_t<(Flags & RingFlagSpsc) != 0, std::atomic<uint64_t>, uint64_t>;
+public:
+	RingAllocator(void* start, uint32_t size);
+	~RingAllocator();
+
+	// Not thread safe even with RingFlagSpsc.
+	void clean();
+
+	uint32_t getSize() const;
+	uint32_t getUsedMemory() const;
+	uint32_t getNumAllocations() const;
+
+	void* allocate(uint32_t size, uint8_t alignment);
+
+	// The pointer must be the oldest live allocation.
+	void free(void* pointer);
+
+	template <typename T, typename... Args>
+	T* create(Args&&... args);
+
+	template <typename T>
+	T* createNoConstruct();
+
+	template <typename T, typename... Args>
+	T* createArray(uint32_t length, Args&&... args);
+
+	template <typename T>
+	T* createArrayNoConstruct(uint32_t length);
+
+	template <typename T>
+	void remove(T* object);
+
+	template <typename T>
+	void removeNoDestruct(T* object);
+
+	template <typename T>
+	void removeArray(T* object);
+
+	template <typename T>
+	void removeArrayNoDestruct(T* object);
+private:
+	RingAllocator(RingAllocator&) = delete;
+	RingAllocator(const RingAllocator&) = delete;
+
+	RingAllocator& operator=(RingAllocator&) = delete;
+	RingAllocator& operator=(const RingAllocator&) = delete;
+
+	static uint64_t load(const std::atomic<uint64_t>& counter, std::memory_order order);
+	static uint64_t load(const uint64_t& counter, std::memory_order order);
+
+	static void store(std::atomic<uint64_t>& counter, uint64_t value, std::memory_order order);
+	static void store(uint64_t& counter, uint64_t value, std::memory_order order);
+
+	uintptr_t mStart;
+	uint32_t  mSize;
+
+	// Byte counters that only grow, the offset in the buffer is the counter modulo mSize. The
+	// producer owns the tail, the consumer owns the head.
+	alignas(64) Counter mTail;
+	Counter mNumAllocated;
+
+	alignas(64) Counter mHead;
+	Counter mNumFreed;
+};
+
+
+template <uint32_t Flags>
+RingAllocator<Flags>::RingAllocator(void* start, uint32_t size)
+		: mStart(0)
+		, mSize(0)
+		, mTail(0)
+		, mNumAllocated(0)
+		, mHead(0)
+		, mNumFreed(0) {
+	uint8_t adjustment = allocator::alignForwardAdjustment(start, alignof(Record));
+
+	assert(size >= adjustment + 2 * sizeof(Record));
+
+	mStart = reinterpret_cast<uintptr_t>(start) + adjustment;
+	mSize  = (size - adjustment) & ~static_cast<uint32_t>(sizeof(Record) - 1);
+}
+
+template <uint32_t Flags>
+RingAllocator<Flags>::~RingAllocator() {
+	assert(getNumAllocations() == 0 && getUsedMemory() == 0);
+
+	mStart = 0;
+	mSize  = 0;
+}
+
+template <uint32_t Flags>
+void RingAllocator<Flags>::clean() {
+	store(mTail, 0, std::memory_order_relaxed);
+	store(mNumAllocated, 0, std::memory_order_relaxed);
+	store(mHead, 0, std::memory_order_relaxed);
+	store(mNumFreed, 0, std::memory_order_relaxed);
+}
+
+template <uint32_t Flags>
+uint32_t RingAllocator<Flags>::getSize() const {
+	return mSize;
+}
+
+template <uint32_t Flags>
+uint32_t RingAllocator<Flags>::getUsedMemory() const {
+	uint64_t head = load(mHead, std::memory_order_acquire);
+	return static_cast<uint32_t>(load(mTail, std::memory_order_acquire) - head);
+}
+
+template <uint32_t Flags>
+uint32_t RingAllocator<Flags>::getNumAllocations() const {
+	uint64_t numFreed = load(mNumFreed, std::memory_order_relaxed);
+	return static_cast<uint32_t>(load(mNumAllocated, std::memory_order_relaxed) - numFreed);
+}
+
+template <uint32_t Flags>
+void* RingAllocator<Flags>::allocate(uint32_t size, uint8_t alignment) {
+	assert(size != 0);
+
+	uint64_t tail = load(mTail, std::memory_order_relaxed);
+	uint64_t head = load(mHead, std::memory_order_acquire);
+
+	uint32_t available = mSize - static_cast<uint32_t>(tail - head);
+	uint32_t offset    = static_cast<uint32_t>(tail % mSize);
+	uint32_t skip      = 0;
+
+	uint8_t adjustment = allocator::alignForwardAdjustmentWithHeader(mStart + offset, alignment, sizeof(Record));
+
+	auto recordSize = [&] {
+		uint64_t value = uint64_t(adjustment) + size;
+		return (value + sizeof(Record) - 1) & ~uint64_t(sizeof(Record) - 1);
+	};
+
+	// Does not fit before the end: skip the tail and start over at the beginning.
+	if (offset + recordSize() > mSize) {
+		skip   = mSize - offset;
+		offset = 0;
+
+		adjustment = allocator::alignForwardAdjustmentWithHeader(mStart, alignment, sizeof(Record));
+	}
+
+	if (skip + recordSize() > available) { return nullptr; }
+
+	if (skip) {
+		auto* record = reinterpret_cast<Record*>(mStart + mSize - skip);
+
+		record->mSize       = skip;
+		record->mAdjustment = 0;
+	}
+
+	auto* record = reinterpret_cast<Record*>(mStart + offset);
+
+	record->mSize       = static_cast<uint32_t>(recordSize());
+	record->mAdjustment = adjustment;
+
+	store(mNumAllocated, load(mNumAllocated, std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	store(mTail, tail + skip + record->mSize, std::memory_order_release);
+
+	return reinterpret_cast<void*>(mStart + offset + adjustment);
+}
+
+template <uint32_t Flags>
+void RingAllocator<Flags>::free(void* pointer) {
+	assert(pointer);
+
+	uint64_t head = load(mHead, std::memory_order_relaxed);
+	uint64_t tail = load(mTail, std::memory_order_acquire);
+
+	assert(head != tail);
+	(void)tail;
+
+	auto* record = reinterpret_cast<Record*>(mStart + head % mSize);
+
+	if (record->mAdjustment == 0) {
+		head  += record->mSize;
+		record = reinterpret_cast<Record*>(mStart);
+	}
+
+	assert(reinterpret_cast<uintptr_t>(record) + record->mAdjustment == reinterpret_cast<uintptr_t>(pointer)
+			&& "RingAllocator frees must come in allocation order");
+
+	store(mNumFreed, load(mNumFreed, std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	store(mHead, head + record->mSize, std::memory_order_release);
+}
+
+template <uint32_t Flags>
+template <typename T, typename... Args>
+T* RingAllocator<Flags>::create(Args&&... args) {
+	void* pointer = allocate(sizeof(T), alignof(T));
+	if (!pointer) { return nullptr; }
+
+	return new (pointer) T(std::forward<Args>(args)...);
+}
+
+template <uint32_t Flags>
+template <typename T>
+T* RingAllocator<Flags>::createNoConstruct() {
+	return reinterpret_cast<T*>(allocate(sizeof(T), alignof(T)));
+}
+
+template <uint32_t Flags>
+template <typename T, typename... Args>
+T* RingAllocator<Flags>::createArray(uint32_t length, Args&&... args) {
+	T* pointer = createArrayNoConstruct<T>(length);
+	if (!pointer) { return nullptr; }
+
+	for (uint32_t i = 0; i < length; ++i) {
+		new (&pointer[i]) T(std::forward<Args>(args)...);
+	}
+
+	return pointer;
+}
+
+template <uint32_t Flags>
+template <typename T>
+T* RingAllocator<Flags>::createArrayNoConstruct(uint32_t length) {
+	assert(length != 0);
+
+	uint8_t headerSize = sizeof(uint32_t) / sizeof(T);
+
+	if (sizeof(uint32_t) % sizeof(T) > 0) { headerSize += 1; }
+
+	auto* pointer = reinterpret_cast<T*>(allocate(sizeof(T) * (length + headerSize), alignof(T)));
+	if (!pointer) { return nullptr; }
+
+	pointer += headerSize;
+
+	*(reinterpret_cast<uint32_t*>(pointer) - 1) = length;
+
+	return pointer;
+}
+
+template <uint32_t Flags>
+template <typename T>
+void RingAllocator<Flags>::remove(T* object) {
+	assert(object);
+	object->~T();
+	free(object);
+}
+
+template <uint32_t Flags>
+template <typename T>
+void RingAllocator<Flags>::removeNoDestruct(T* object) {
+	assert(object);
+	free(object);
+}
+
+template <uint32_t Flags>
+template <typename T>
+void RingAllocator<Flags>::removeArray(T* object) {
+	assert(object);
+
+	uint32_t length = *(reinterpret_cast<uint32_t*>(object) - 1);
+
+	for (uint32_t i = 0; i < length; ++i) {
+		object[i].~T();
+	}
+
+	removeArrayNoDestruct(object);
+}
+
+template <uint32_t Flags>
+template <typename T>
+void RingAllocator<Flags>::removeArrayNoDestruct(T* object) {
+	assert(object);
+
+	uint8_t headerSize = sizeof(uint32_t) / sizeof(T);
+
+	if (sizeof(uint32_t) % sizeof(T) > 0) { headerSize += 1; }
+
+	free(object - headerSize);
+}
+
+template <uint32_t Flags>
+uint64_t RingAllocator<Flags>::load(const std::atomic<uint64_t>& counter, std::memory_order order) {
+	return counter.load(order);
+}
+
+template <uint32_t Flags>
+uint64_t RingAllocator<Flags>::load(const uint64_t& counter, std::memory_order) {
+	return counter;
+}
+
+template <uint32_t Flags>
+void RingAllocator<Flags>::store(std::atomic<uint64_t>& counter, uint64_t value, std::memory_order order) {
+	counter.store(value, order);
+}
+
+template <uint32_t Flags>
+void RingAllocator<Flags>::store(uint64_t& counter, uint64_t value, std::memory_order) {
+	counter = value;
+}
+
+} // namespace simple
@@ -0,0 +1,284 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#pragma once
+
+#include "Allocator.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+namespace simple {
+
+// Small-object allocator over a caller-provided buffer. Requests of up to MaxSize bytes are rounded
+// up to one of NumClasses size classes; every class is a pool of raw slots carved from pages of
+// PageSize bytes. A per-page class table lets deallocate find the class of any pointer.
+class SizeClassAllocator {
+public:
+	static constexpr uint32_t PageShift  = 14;
+	static constexpr uint32_t PageSize   = 1u << PageShift;
+	static constexpr uint32_t MaxSize    = 1024;
+	static constexpr uint32_t NumClasses = 21;
+
+	SizeClassAllocator(void* start, uint32_t size);
+	~SizeClassAllocator();
+
+	void clean();
+
+	uint32_t getSize() const;
+	uint32_t getUsedMemory() const;
+	uint32_t getNumAllocations() const;
+
+	bool owns(const void* pointer) const;
+
+	static uint32_t getClassIndex(uint32_t size, uint8_t alignment);
+	static uint32_t getClassSize(uint32_t classIndex);
+
+	void* allocate(uint32_t size, uint8_t alignment);
+
+	// size and alignment must be the ones passed to allocate.
+	void deallocate(void* pointer, uint32_t size, uint8_t alignment = 1);
+	void deallocate(void* pointer);
+
+	template <typename T, typename... Args>
+	T* create(Args&&... args);
+
+	template <typename T>
+	T* createNoConstruct();
+
+	template <typename T>
+	void remove(T* object);
+
+	template <typename T>
+	void removeNoDestruct(T* object);
+private:
+	SizeClassAllocator(SizeClassAllocator&) = delete;
+	SizeClassAllocator(const SizeClassAllocator&) = delete;
+
+	SizeClassAllocator& operator=(SizeClassAllocator&) = delete;
+	SizeClassAllocator& operator=(const SizeClassAllocator&) = delete;
+
+	struct SizeClass {
+		void**    mFreeList;
+		uintptr_t mBump;
+		uintptr_t mBumpEnd;
+	};
+
+	static constexpr uint8_t NoClass = 0xFF;
+
+	void* allocateFromClass(uint32_t classIndex);
+	void deallocateToClass(void* pointer, uint32_t classIndex);
+	uint32_t getPageIndex(const void* pointer) const;
+
+	SizeClass mClasses[NumClasses];
+
+	uintptr_t mStart;
+	uint8_t*  mPageClasses;
+
+	uint32_t mSize;
+	uint32_t mNumPages;
+	uint32_t mNumUsedPages;
+	uint32_t mUsedMemory;
+	uint32_t mNumAllocations;
+};
+
+
+namespace allocator {
+
+constexpr uint32_t SizeClassSizes[SizeClassAllocator::NumClasses] = {
+	8,   16,  32,  48,  64,  80,  96,  112, 128,
+	160, 192, 224, 256,
+	320, 384, 448, 512,
+	640, 768, 896, 1024,
+};
+
+struct SizeClassTable {
+	constexpr SizeClassTable() : mClasses() {
+		uint32_t classIndex = 0;
+
+		for (uint32_t i = 0; i <= SizeClassAllocator::MaxSize / 8; ++i) {
+			while (SizeClassSizes[classIndex] < i * 8) { ++classIndex; }
+			mClasses[i] = static_cast<uint8_t>(classIndex);
+		}
+	}
+
+	uint8_t mClasses[SizeClassAllocator::MaxSize / 8 + 1];
+};
+
+constexpr SizeClassTable SizeClassLookup;
+
+} // namespace allocator
+
+
+inline SizeClassAllocator::SizeClassAllocator(void* start, uint32_t size)
+		: mClasses()
+		, mStart(0)
+		, mPageClasses(nullptr)
+		, mSize(size)
+		, mNumPages(0)
+		, mNumUsedPages(0)
+		, mUsedMemory(0)
+		, mNumAllocations(0) {
+	auto address = reinterpret_cast<uintptr_t>(start);
+	uintptr_t adjustment = (PageSize - (address & (PageSize - 1))) & (PageSize - 1);
+
+	assert(size >= adjustment + PageSize);
+
+	mStart    = address + adjustment;
+	mNumPages = static_cast<uint32_t>((size - adjustment) >> PageShift);
+
+	mPageClasses = reinterpret_cast<uint8_t*>(std::malloc(mNumPages));
+
+	clean();
+}
+
+inline SizeClassAllocator::~SizeClassAllocator() {
+	assert(mNumAllocations == 0 && mUsedMemory == 0);
+
+	std::free(mPageClasses);
+}
+
+inline void SizeClassAllocator::clean() {
+	for (auto& sizeClass : mClasses) {
+		sizeClass.mFreeList = nullptr;
+		sizeClass.mBump     = 0;
+		sizeClass.mBumpEnd  = 0;
+	}
+
+	std::memset(mPageClasses, NoClass, mNumPages);
+
+	mNumUsedPages   = 0;
+	mUsedMemory     = 0;
+	mNumAllocations = 0;
+}
+
+inline uint32_t SizeClassAllocator::getSize() const {
+	return mSize;
+}
+
+inline uint32_t SizeClassAllocator::getUsedMemory() const {
+	return mUsedMemory;
+}
+
+inline uint32_t SizeClassAllocator::getNumAllocations() const {
+	return mNumAllocations;
+}
+
+inline bool SizeClassAllocator::owns(const void* pointer) const {
+	auto address = reinterpret_cast<uintptr_t>(pointer);
+	return address >= mStart && address < mStart + (uintptr_t(mNumPages) << PageShift);
+}
+
+inline uint32_t SizeClassAllocator::getClassIndex(uint32_t size, uint8_t alignment) {
+	assert(size != 0 && size <= MaxSize);
+	assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+
+	uint32_t classIndex = allocator::SizeClassLookup.mClasses[(size + 7) >> 3];
+
+	// Pages are PageSize aligned, so a slot is aligned to every power of two dividing its size.
+	while (allocator::SizeClassSizes[classIndex] % alignment != 0) {
+		++classIndex;
+		assert(classIndex < NumClasses);
+	}
+
+	return classIndex;
+}
+
+inline uint32_t SizeClassAllocator::getClassSize(uint32_t classIndex) {
+	assert(classIndex < NumClasses);
+	return allocator::SizeClassSizes[classIndex];
+}
+
+inline void* SizeClassAllocator::allocate(uint32_t size, uint8_t alignment) {
+	return allocateFromClass(getClassIndex(size, alignment));
+}
+
+inline void SizeClassAllocator::deallocate(void* pointer, uint32_t size, uint8_t alignment) {
+	uint32_t classIndex = getClassIndex(size, alignment);
+
+	assert(mPageClasses[getPageIndex(pointer)] == classIndex);
+
+	deallocateToClass(pointer, classIndex);
+}
+
+inline void SizeClassAllocator::deallocate(void* pointer) {
+	uint32_t classIndex = mPageClasses[getPageIndex(pointer)];
+
+	assert(classIndex != NoClass);
+
+	deallocateToClass(pointer, classIndex);
+}
+
+template <typename T, typename... Args>
+T* SizeClassAllocator::create(Args&&... args) {
+	return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+}
+
+template <typename T>
+T* SizeClassAllocator::createNoConstruct() {
+	return reinterpret_cast<T*>(allocate(sizeof(T), alignof(T)));
+}
+
+template <typename T>
+void SizeClassAllocator::remove(T* object) {
+	assert(object);
+	object->~T();
+	deallocate(object, sizeof(T), alignof(T));
+}
+
+template <typename T>
+void SizeClassAllocator::removeNoDestruct(T* object) {
+	assert(object);
+	deallocate(object, sizeof(T), alignof(T));
+}
+
+inline void* SizeClassAllocator::allocateFromClass(uint32_t classIndex) {
+	SizeClass& sizeClass = mClasses[classIndex];
+	uint32_t slotSize = allocator::SizeClassSizes[classIndex];
+
+	void* pointer = sizeClass.mFreeList;
+
+	if (pointer) {
+		sizeClass.mFreeList = reinterpret_cast<void**>(*sizeClass.mFreeList);
+	} else {
+		if (sizeClass.mBump + slotSize > sizeClass.mBumpEnd) {
+			assert(mNumUsedPages < mNumPages);
+
+			uint32_t page = mNumUsedPages++;
+
+			mPageClasses[page] = static_cast<uint8_t>(classIndex);
+
+			sizeClass.mBump    = mStart + (uintptr_t(page) << PageShift);
+			sizeClass.mBumpEnd = sizeClass.mBump + PageSize;
+		}
+
+		pointer = reinterpret_cast<void*>(sizeClass.mBump);
+		sizeClass.mBump += slotSize;
+	}
+
+	mUsedMemory += slotSize;
+	++mNumAllocations;
+
+	return pointer;
+}
+
+inline void SizeClassAllocator::deallocateToClass(void* pointer, uint32_t classIndex) {
+	assert(mNumAllocations > 0);
+
+	SizeClass& sizeClass = mClasses[classIndex];
+
+	*(reinterpret_cast<void**>(pointer)) = sizeClass.mFreeList;
+	sizeClass.mFreeList = reinterpret_cast<void**>(pointer);
+
+	mUsedMemory -= allocator::SizeClassSizes[classIndex];
+	--mNumAllocations;
+}
+
+inline uint32_t SizeClassAllocator::getPageIndex(const void* pointer) const {
+	assert(owns(pointer));
+	return static_cast<uint32_t>((reinterpret_cast<uintptr_t>(pointer) - mStart) >> PageShift);
+}
+
+} // namespace simple
@@ -0,0 +1,392 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#pragma once
+
+#include "Allocator.h"
+#include "Allocator/PageMap.h"
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <thread>
+#include <utility>
+
+#include <sys/mman.h>
+
+namespace simple {
+
+// Fixed-size object allocator that grows by slabs of SlabSize bytes, each aligned to its size and
+// starting with a header that names the allocator it belongs to. Masking any object pointer finds
+// its slab, so owner and deallocateAny route a free to the right allocator without storing
+// anything per object; a set of SlabAllocators, one per size class, needs no size on free either.
+//
+// The allocator belongs to one thread, the one that created it. Frees from other threads go onto
+// a lock-free list of the slab instead, and the owner takes those lists back in bulk when it runs
+// out of free objects, so neither side takes a lock.
+//
+// Given a PageMap, every slab is registered in it while mapped, so PageMap::free routes to the
+// allocator as well.
+class SlabAllocator {
+	struct Slab {
+		SlabAllocator* mOwner;
+		Slab*          mNext;
+		Slab*          mPrevious;
+		void*          mFreeList;
+		uint32_t       mNumFree;
+		uint32_t       mNumCarved; // Objects past it were never handed out and are not linked.
+
+		std::atomic<void*> mRemoteFree; // Pushed by other threads, taken whole by the owner.
+		std::atomic<Slab*> mNextRemote;
+	};
+public:
+	static constexpr uint32_t SlabShift = 16;
+	static constexpr uint32_t SlabSize  = 1u << SlabShift;
+
+	SlabAllocator(uint32_t objectSize, uint8_t alignment = alignof(std::max_align_t), PageMap* pageMap = nullptr);
+	~SlabAllocator();
+
+	uint32_t getObjectSize() const;
+	uint32_t getNumObjectsPerSlab() const;
+	uint32_t getNumSlabs() const;
+	// Objects freed by other threads count until the owner reclaims them.
+	uint32_t getNumAllocations() const;
+
+	static SlabAllocator* owner(const void* pointer);
+
+	void* allocate();
+	void deallocate(void* pointer);
+
+	// Frees an object of any SlabAllocator.
+	static void deallocateAny(void* pointer);
+
+	// Makes the calling thread the owner, no other thread may allocate meanwhile.
+	void setOwnerThread();
+
+	// Takes back objects freed by other threads and returns their number. allocate does it on its
+	// own when no free object is left.
+	uint32_t reclaimRemote();
+
+	template <typename T, typename... Args>
+	T* create(Args&&... args);
+
+	template <typename T>
+	T* createNoConstruct();
+
+	template <typename T>
+	void remove(T* object);
+
+	template <typename T>
+	void removeNoDestruct(T* object);
+
+	// Unmaps slabs without live objects and returns the number of bytes released.
+	size_t trim();
+private:
+	SlabAllocator(SlabAllocator&) = delete;
+	SlabAllocator(const SlabAllocator&) = delete;
+
+	SlabAllocator& operator=(SlabAllocator&) = delete;
+	SlabAllocator& operator=(const SlabAllocator&) = delete;
+
+	static Slab* getSlab(const void* pointer);
+
+	Slab* mapSlab();
+	void unmapSlab(Slab* slab);
+
+	void link(Slab* slab);
+	void unlink(Slab* slab);
+
+	void deallocateLocal(Slab* slab, void* pointer);
+	void deallocateRemote(Slab* slab, void* pointer);
+
+	Slab* mPartial; // Slabs with at least one free object.
+	Slab* mFull;
+
+	std::atomic<Slab*> mRemoteSlabs; // Slabs whose remote list became non-empty.
+	std::thread::id    mOwnerThread;
+
+	PageMap*       mPageMap;
+	PageMap::Owner mPageOwner;
+
+	uint32_t mObjectSize;
+	uint32_t mFirstOffset;
+	uint32_t mNumObjectsPerSlab;
+	uint32_t mNumSlabs;
+	uint32_t mNumAllocations;
+};
+
+
+inline SlabAllocator::SlabAllocator(uint32_t objectSize, uint8_t alignment, PageMap* pageMap)
+		: mPartial(nullptr)
+		, mFull(nullptr)
+		, mRemoteSlabs(nullptr)
+		, mOwnerThread(std::this_thread::get_id())
+		, mPageMap(pageMap)
+		, mPageOwner { this, [](void* allocator, void* pointer) {
+			reinterpret_cast<SlabAllocator*>(allocator)->deallocate(pointer);
+		} }
+		, mObjectSize(0)
+		, mFirstOffset(0)
+		, mNumObjectsPerSlab(0)
+		, mNumSlabs(0)
+		, mNumAllocations(0) {
+	if (alignment < alignof(void*)) { alignment = alignof(void*); }
+	if (objectSize < sizeof(void*)) { objectSize = sizeof(void*); }
+
+	mObjectSize  = (objectSize + alignment - 1) & ~uint32_t(alignment - 1);
+	mFirstOffset = sizeof(Slab) + allocator::alignForwardAdjustment(uintptr_t(sizeof(Slab)), alignment);
+
+	assert(mFirstOffset + mObjectSize <= SlabSize);
+
+	mNumObjectsPerSlab = (SlabSize - mFirstOffset) / mObjectSize;
+}
+
+inline SlabAllocator::~SlabAllocator() {
+	reclaimRemote();
+
+	assert(mNumAllocations == 0);
+
+	trim();
+}
+
+inline uint32_t SlabAllocator::getObjectSize() const {
+	return mObjectSize;
+}
+
+inline uint32_t SlabAllocator::getNumObjectsPerSlab() const {
+	return mNumObjectsPerSlab;
+}
+
+inline uint32_t SlabAllocator::getNumSlabs() const {
+	return mNumSlabs;
+}
+
+inline uint32_t SlabAllocator::getNumAllocations() const {
+	return mNumAllocations;
+}
+
+inline SlabAllocator* SlabAllocator::owner(const void* pointer) {
+	return getSlab(pointer)->mOwner;
+}
+
+inline void* SlabAllocator::allocate() {
+	if (!mPartial) { reclaimRemote(); }
+
+	Slab* slab = mPartial ? mPartial : mapSlab();
+
+	assert(slab && "SlabAllocator is out of memory");
+
+	void* pointer;
+
+	if (slab->mFreeList) {
+		pointer = slab->mFreeList;
+		slab->mFreeList = *reinterpret_cast<void**>(pointer);
+	} else {
+		pointer = reinterpret_cast<uint8_t*>(slab) + mFirstOffset + slab->mNumCarved * mObjectSize;
+		++slab->mNumCarved;
+	}
+
+	if (--slab->mNumFree == 0) {
+		unlink(slab);
+		slab->mPrevious = nullptr;
+		slab->mNext     = mFull;
+		if (mFull) { mFull->mPrevious = slab; }
+		mFull = slab;
+	}
+
+	++mNumAllocations;
+
+	return pointer;
+}
+
+inline void SlabAllocator::deallocate(void* pointer) {
+	assert(pointer);
+
+	Slab* slab = getSlab(pointer);
+
+	assert(slab->mOwner == this);
+
+	if (std::this_thread::get_id() == mOwnerThread) {
+		deallocateLocal(slab, pointer);
+	} else {
+		deallocateRemote(slab, pointer);
+	}
+}
+
+inline void SlabAllocator::deallocateAny(void* pointer) {
+	owner(pointer)->deallocate(pointer);
+}
+
+inline void SlabAllocator::setOwnerThread() {
+	mOwnerThread = std::this_thread::get_id();
+}
+
+inline uint32_t SlabAllocator::reclaimRemote() {
+	uint32_t numReclaimed = 0;
+
+	Slab* slab = mRemoteSlabs.exchange(nullptr, std::memory_order_acquire);
+
+	while (slab) {
+		// Read the link first: once the list is taken another thread may announce the slab again.
+		// The release half of the exchange keeps the read before it, and the announcing thread
+		// acquires the empty list before it writes the link.
+		Slab* next = slab->mNextRemote.load(std::memory_order_relaxed);
+
+		void* pointer = slab->mRemoteFree.exchange(nullptr, std::memory_order_acq_rel);
+
+		while (pointer) {
+			void* nextPointer = *reinterpret_cast<void**>(pointer);
+
+			deallocateLocal(slab, pointer);
+			++numReclaimed;
+
+			pointer = nextPointer;
+		}
+
+		slab = next;
+	}
+
+	return numReclaimed;
+}
+
+template <typename T, typename... Args>
+T* SlabAllocator::create(Args&&... args) {
+	assert(sizeof(T) <= mObjectSize);
+	return new (allocate()) T(std::forward<Args>(args)...);
+}
+
+template <typename T>
+T* SlabAllocator::createNoConstruct() {
+	assert(sizeof(T) <= mObjectSize);
+	return reinterpret_cast<T*>(allocate());
+}
+
+template <typename T>
+void SlabAllocator::remove(T* object) {
+	assert(object);
+	object->~T();
+	deallocate(object);
+}
+
+template <typename T>
+void SlabAllocator::removeNoDestruct(T* object) {
+	assert(object);
+	deallocate(object);
+}
+
+inline size_t SlabAllocator::trim() {
+	size_t releasedSize = 0;
+
+	for (Slab* slab = mPartial; slab;) {
+		Slab* next = slab->mNext;
+
+		if (slab->mNumFree == mNumObjectsPerSlab) {
+			unlink(slab);
+			unmapSlab(slab);
+			releasedSize += SlabSize;
+		}
+
+		slab = next;
+	}
+
+	return releasedSize;
+}
+
+inline void SlabAllocator::deallocateLocal(Slab* slab, void* pointer) {
+	if (slab->mNumFree++ == 0) {
+		if (slab->mPrevious) {
+			slab->mPrevious->mNext = slab->mNext;
+		} else {
+			mFull = slab->mNext;
+		}
+
+		if (slab->mNext) { slab->mNext->mPrevious = slab->mPrevious; }
+
+		link(slab);
+	}
+
+	*reinterpret_cast<void**>(pointer) = slab->mFreeList;
+	slab->mFreeList = pointer;
+
+	--mNumAllocations;
+}
+
+inline void SlabAllocator::deallocateRemote(Slab* slab, void* pointer) {
+	void* head = slab->mRemoteFree.load(std::memory_order_relaxed);
+
+	do {
+		*reinterpret_cast<void**>(pointer) = head;
+	} while (!slab->mRemoteFree.compare_exchange_weak(head, pointer, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+	if (head) { return; }
+
+	// First remote free since the owner last looked: announce the slab.
+	Slab* slabs = mRemoteSlabs.load(std::memory_order_relaxed);
+
+	do {
+		slab->mNextRemote.store(slabs, std::memory_order_relaxed);
+	} while (!mRemoteSlabs.compare_exchange_weak(slabs, slab, std::memory_order_release, std::memory_order_relaxed));
+}
+
+inline SlabAllocator::Slab* SlabAllocator::getSlab(const void* pointer) {
+	return reinterpret_cast<Slab*>(reinterpret_cast<uintptr_t>(pointer) & ~uintptr_t(SlabSize - 1));
+}
+
+inline SlabAllocator::Slab* SlabAllocator::mapSlab() {
+	// Map twice the size and cut off both ends to get a slab aligned to its size.
+	void* mapping = mmap(nullptr, 2 * SlabSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (mapping == MAP_FAILED) { return nullptr; }
+
+	auto begin   = reinterpret_cast<uintptr_t>(mapping);
+	auto aligned = (begin + SlabSize - 1) & ~uintptr_t(SlabSize - 1);
+
+	if (aligned > begin) { munmap(mapping, aligned - begin); }
+	munmap(reinterpret_cast<void*>(aligned + SlabSize), begin + SlabSize - aligned);
+
+	auto* slab = reinterpret_cast<Slab*>(aligned);
+
+	slab->mOwner     = this;
+	slab->mFreeList  = nullptr;
+	slab->mNumFree   = mNumObjectsPerSlab;
+	slab->mNumCarved = 0;
+
+	new (&slab->mRemoteFree) std::atomic<void*>(nullptr);
+	new (&slab->mNextRemote) std::atomic<Slab*>(nullptr);
+
+	link(slab);
+
+	if (mPageMap) { mPageMap->insert(slab, SlabSize, &mPageOwner); }
+
+	++mNumSlabs;
+
+	return slab;
+}
+
+inline void SlabAllocator::unmapSlab(Slab* slab) {
+	if (mPageMap) { mPageMap->erase(slab, SlabSize); }
+
+	munmap(slab, SlabSize);
+	--mNumSlabs;
+}
+
+inline void SlabAllocator::link(Slab* slab) {
+	slab->mPrevious = nullptr;
+	slab->mNext     = mPartial;
+
+	if (mPartial) { mPartial->mPrevious = slab; }
+
+	mPartial = slab;
+}
+
+inline void SlabAllocator::unlink(Slab* slab) {
+	if (slab->mPrevious) {
+		slab->mPrevious->mNext = slab->mNext;
+	} else {
+		mPartial = slab->mNext;
+	}
+
+	if (slab->mNext) { slab->mNext->mPrevious = slab->mPrevious; }
+}
+
+} // namespace simple
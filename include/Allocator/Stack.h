@@ -3,6 +3,7 @@
 #pragma once
 
 #include "Allocator.h"
+#include "Allocator/LargeObject.h"
 
 #include <cassert>
 #include <cstdint>
@@ -25,6 +26,11 @@ public:
 	uint32_t getUsedMemory() const;
 	uint32_t getNumAllocations() const;
 
+	// Requests of at least threshold bytes, and any request that no longer fits, are mapped by
+	// overflow instead. clean() releases them together with the arena, other users of overflow keep
+	// their blocks.
+	void setOverflow(LargeObjectAllocator* overflow, uint32_t threshold);
+
 	template <typename T, typename... Args>
 	T* create(Args&&... args);
 
@@ -63,6 +69,10 @@ private:
 	uintptr_t mCurrentPosition;
 	uintptr_t mPreviousPosition;
 
+	LargeObjectAllocator* mOverflow;
+	LargeObjectAllocator::Owner mOverflowBlocks;
+	uint32_t mOverflowThreshold;
+
 	uint32_t mSize;
 	uint32_t mUsedMemory;
 	uint32_t mNumAllocations;
@@ -73,6 +83,8 @@ inline StackAllocator::StackAllocator(void* start, uint32_t size)
 		: mStart(reinterpret_cast<uintptr_t>(start))
 		, mCurrentPosition(reinterpret_cast<uintptr_t>(start))
 		, mPreviousPosition(0)
+		, mOverflow(nullptr)
+		, mOverflowThreshold(0)
 		, mSize(size)
 		, mUsedMemory(0)
 		, mNumAllocations(0) {
@@ -81,9 +93,14 @@ inline StackAllocator::StackAllocator(void* start, uint32_t size)
 
 inline StackAllocator::~StackAllocator() {
 	assert(mNumAllocations == 0 && mUsedMemory == 0);
+
+	// Overflow blocks are not counted above, they must not outlive the list that tracks them.
+	if (mOverflow) { mOverflow->clean(mOverflowBlocks); }
 }
 
 inline void StackAllocator::clean() {
+	if (mOverflow) { mOverflow->clean(mOverflowBlocks); }
+
 	mCurrentPosition  = mStart;
 	mNumAllocations   = 0;
 	mUsedMemory       = 0;
@@ -102,6 +119,11 @@ inline uint32_t StackAllocator::getNumAllocations() const {
 	return mNumAllocations;
 }
 
+inline void StackAllocator::setOverflow(LargeObjectAllocator* overflow, uint32_t threshold) {
+	mOverflow          = overflow;
+	mOverflowThreshold = threshold;
+}
+
 template <typename T, typename... Args>
 T* StackAllocator::create(Args&&... args) {
 	return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
@@ -192,6 +214,10 @@ inline void* StackAllocator::allocate(uint32_t size, uint8_t alignment) {
 
 	uint8_t adjustment = allocator::alignForwardAdjustmentWithHeader(mCurrentPosition, alignment, sizeof(Header));
 
+	if (mOverflow && (size >= mOverflowThreshold || mUsedMemory + adjustment + size > mSize)) {
+		return mOverflow->allocate(size, mOverflowBlocks);
+	}
+
 	assert(mUsedMemory + adjustment + size <= mSize);
 
 	auto alignedAddress = mCurrentPosition + adjustment;
@@ -214,6 +240,12 @@ inline void* StackAllocator::allocate(uint32_t size, uint8_t alignment) {
 inline void StackAllocator::free(void* pointer) {
 	auto position = reinterpret_cast<uintptr_t>(pointer);
 
+	// Overflow blocks live outside the stack and may be freed in any order.
+	if (mOverflow && (position < mStart || position >= mStart + mSize)) {
+		mOverflow->deallocate(pointer);
+		return;
+	}
+
 	assert(position == mPreviousPosition);
 
 	auto* header = reinterpret_cast<Header*>(position - sizeof(Header));
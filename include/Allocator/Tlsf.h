@@ -0,0 +1,460 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#pragma once
+
+#include "Allocator.h"
+
+#include <cassert>
+#include <cstdint>
+#include <utility>
+
+namespace simple {
+
+// Two-Level Segregated Fit allocator over a caller-provided buffer. Free blocks are kept in
+// segregated lists indexed by a first level (power of two) and a second level (SLCount linear
+// steps inside it). Two bitmaps tell which lists are non-empty, so allocate and deallocate are
+// O(1): a couple of count-zeros instructions, no list walks. Freed blocks merge with both
+// neighbours at once, using the same block header as FreeListAllocator.
+class TlsfAllocator {
+	struct Block {
+		uint32_t mSize;         // Whole block including the header, AllocatedBit set while in use.
+		uint32_t mPreviousSize; // 0 for the first block.
+	};
+
+	struct FreeBlock : Block {
+		FreeBlock* mNext;
+		FreeBlock* mPrevious;
+	};
+public:
+	static constexpr uint32_t SLShift = 5;
+	static constexpr uint32_t SLCount = 1u << SLShift;
+	static constexpr uint32_t FLShift = SLShift + 3;
+	static constexpr uint32_t FLCount = 32 - FLShift + 1;
+
+	TlsfAllocator(void* start, uint32_t size);
+	~TlsfAllocator();
+
+	void clean();
+
+	uint32_t getSize() const;
+	uint32_t getUsedMemory() const;
+	uint32_t getNumAllocations() const;
+
+	void* allocate(uint32_t size, uint8_t alignment);
+	void deallocate(void* pointer);
+
+	template <typename T, typename... Args>
+	T* create(Args&&... args);
+
+	template <typename T>
+	T* createNoConstruct();
+
+	template <typename T, typename... Args>
+	T* createArray(uint32_t length, Args&&... args);
+
+	template <typename T>
+	T* createArrayNoConstruct(uint32_t length);
+
+	template <typename T>
+	void remove(T* object);
+
+	template <typename T>
+	void removeNoDestruct(T* object);
+
+	template <typename T>
+	void removeArray(T* object);
+
+	template <typename T>
+	void removeArrayNoDestruct(T* object);
+private:
+	TlsfAllocator(TlsfAllocator&) = delete;
+	TlsfAllocator(const TlsfAllocator&) = delete;
+
+	TlsfAllocator& operator=(TlsfAllocator&) = delete;
+	TlsfAllocator& operator=(const TlsfAllocator&) = delete;
+
+	static constexpr uint32_t Granularity  = 8;
+	static constexpr uint32_t AllocatedBit = 1;
+	static constexpr uint32_t SmallSize    = 1u << FLShift;
+	static constexpr uint32_t MinBlockSize = (sizeof(FreeBlock) + Granularity - 1) & ~(Granularity - 1);
+
+	static uint32_t getBlockSize(const Block* block);
+	static bool isAllocated(const Block* block);
+	static Block* getNextBlock(Block* block);
+
+	static void mapping(uint32_t size, uint32_t& fl, uint32_t& sl);
+	static void mappingSearch(uint32_t size, uint32_t& fl, uint32_t& sl);
+
+	FreeBlock* findSuitable(uint32_t& fl, uint32_t& sl) const;
+
+	void insert(FreeBlock* block);
+	void erase(FreeBlock* block);
+	void erase(FreeBlock* block, uint32_t fl, uint32_t sl);
+
+	uintptr_t mStart;
+	uintptr_t mEnd;
+
+	uint32_t   mFLBitmap;
+	uint32_t   mSLBitmaps[FLCount];
+	FreeBlock* mBlocks[FLCount][SLCount];
+
+	uint32_t mSize;
+	uint32_t mUsedMemory;
+	uint32_t mNumAllocations;
+};
+
+
+inline TlsfAllocator::TlsfAllocator(void* start, uint32_t size)
+		: mStart(0)
+		, mEnd(0)
+		, mFLBitmap(0)
+		, mSLBitmaps()
+		, mBlocks()
+		, mSize(size)
+		, mUsedMemory(0)
+		, mNumAllocations(0) {
+	uint8_t adjustment = allocator::alignForwardAdjustment(start, Granularity);
+
+	assert(size >= adjustment + MinBlockSize + sizeof(Block));
+
+	mStart = reinterpret_cast<uintptr_t>(start) + adjustment;
+	mEnd   = mStart + ((size - adjustment - sizeof(Block)) & ~(Granularity - 1));
+
+	clean();
+}
+
+inline TlsfAllocator::~TlsfAllocator() {
+	assert(mNumAllocations == 0 && mUsedMemory == 0);
+}
+
+inline void TlsfAllocator::clean() {
+	mFLBitmap = 0;
+
+	for (uint32_t fl = 0; fl < FLCount; ++fl) {
+		mSLBitmaps[fl] = 0;
+
+		for (uint32_t sl = 0; sl < SLCount; ++sl) {
+			mBlocks[fl][sl] = nullptr;
+		}
+	}
+
+	auto* block = reinterpret_cast<FreeBlock*>(mStart);
+
+	block->mSize         = static_cast<uint32_t>(mEnd - mStart);
+	block->mPreviousSize = 0;
+
+	// The sentinel at the end is a zero-sized allocated block, so merging never runs past it.
+	auto* sentinel = reinterpret_cast<Block*>(mEnd);
+
+	sentinel->mSize         = AllocatedBit;
+	sentinel->mPreviousSize = block->mSize;
+
+	insert(block);
+
+	mUsedMemory     = 0;
+	mNumAllocations = 0;
+}
+
+inline uint32_t TlsfAllocator::getSize() const {
+	return mSize;
+}
+
+inline uint32_t TlsfAllocator::getUsedMemory() const {
+	return mUsedMemory;
+}
+
+inline uint32_t TlsfAllocator::getNumAllocations() const {
+	return mNumAllocations;
+}
+
+inline void* TlsfAllocator::allocate(uint32_t size, uint8_t alignment) {
+	assert(size != 0);
+	assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+
+	uint32_t needed = ((size + Granularity - 1) & ~(Granularity - 1)) + sizeof(Block);
+
+	if (needed < MinBlockSize) { needed = MinBlockSize; }
+
+	// Any block this big can hold an aligned block behind a gap that stands as a free block itself.
+	uint32_t search = needed;
+
+	if (alignment > Granularity) { search += alignment + MinBlockSize; }
+
+	uint32_t fl;
+	uint32_t sl;
+
+	mappingSearch(search, fl, sl);
+
+	FreeBlock* block = findSuitable(fl, sl);
+
+	if (!block) {
+		// Rounding up skips the list the size falls into, its first block may still be big enough.
+		mapping(search, fl, sl);
+		block = mBlocks[fl][sl];
+
+		if (block && block->mSize < search) { block = nullptr; }
+	}
+
+	assert(block && "TlsfAllocator is out of memory");
+
+	erase(block, fl, sl);
+
+	Block* allocated = block;
+
+	if (alignment > Granularity) {
+		auto data = reinterpret_cast<uintptr_t>(static_cast<Block*>(block) + 1);
+		auto padding = static_cast<uint32_t>(((data + alignment - 1) & ~uintptr_t(alignment - 1)) - data);
+
+		while (padding != 0 && padding < MinBlockSize) { padding += alignment; }
+
+		if (padding > 0) {
+			allocated = reinterpret_cast<Block*>(reinterpret_cast<uintptr_t>(block) + padding);
+
+			allocated->mSize         = block->mSize - padding;
+			allocated->mPreviousSize = padding;
+
+			block->mSize = padding;
+			insert(block);
+
+			getNextBlock(allocated)->mPreviousSize = allocated->mSize;
+		}
+	}
+
+	uint32_t remainder = allocated->mSize - needed;
+
+	if (remainder >= MinBlockSize) {
+		auto* tail = reinterpret_cast<FreeBlock*>(reinterpret_cast<uintptr_t>(allocated) + needed);
+
+		tail->mSize         = remainder;
+		tail->mPreviousSize = needed;
+
+		getNextBlock(tail)->mPreviousSize = remainder;
+
+		allocated->mSize = needed;
+		insert(tail);
+	}
+
+	mUsedMemory += allocated->mSize;
+	++mNumAllocations;
+
+	allocated->mSize |= AllocatedBit;
+
+	return allocated + 1;
+}
+
+inline void TlsfAllocator::deallocate(void* pointer) {
+	assert(pointer);
+
+	Block* block = reinterpret_cast<Block*>(pointer) - 1;
+
+	assert(reinterpret_cast<uintptr_t>(block) >= mStart && reinterpret_cast<uintptr_t>(block) < mEnd);
+	assert(isAllocated(block));
+
+	block->mSize &= ~AllocatedBit;
+
+	mUsedMemory -= block->mSize;
+	--mNumAllocations;
+
+	Block* next = getNextBlock(block);
+
+	if (!isAllocated(next)) {
+		erase(static_cast<FreeBlock*>(next));
+		block->mSize += next->mSize;
+	}
+
+	if (block->mPreviousSize != 0) {
+		Block* previous = reinterpret_cast<Block*>(reinterpret_cast<uintptr_t>(block) - block->mPreviousSize);
+
+		if (!isAllocated(previous)) {
+			erase(static_cast<FreeBlock*>(previous));
+			previous->mSize += block->mSize;
+			block = previous;
+		}
+	}
+
+	getNextBlock(block)->mPreviousSize = block->mSize;
+
+	insert(static_cast<FreeBlock*>(block));
+}
+
+template <typename T, typename... Args>
+T* TlsfAllocator::create(Args&&... args) {
+	return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+}
+
+template <typename T>
+T* TlsfAllocator::createNoConstruct() {
+	return reinterpret_cast<T*>(allocate(sizeof(T), alignof(T)));
+}
+
+template <typename T, typename... Args>
+T* TlsfAllocator::createArray(uint32_t length, Args&&... args) {
+	assert(length != 0);
+
+	uint8_t headerSize = sizeof(uint32_t) / sizeof(T);
+
+	if (sizeof(uint32_t) % sizeof(T) > 0) { headerSize += 1; }
+
+	T* pointer = reinterpret_cast<T*>(allocate(sizeof(T) * (length + headerSize), alignof(T))) + headerSize;
+
+	*(reinterpret_cast<uint32_t*>(pointer) - 1) = length;
+
+	for (uint32_t i = 0; i < length; ++i) {
+		new (&pointer[i]) T(std::forward<Args>(args)...);
+	}
+
+	return pointer;
+}
+
+template <typename T>
+T* TlsfAllocator::createArrayNoConstruct(uint32_t length) {
+	assert(length != 0);
+
+	uint8_t headerSize = sizeof(uint32_t) / sizeof(T);
+
+	if (sizeof(uint32_t) % sizeof(T) > 0) { headerSize += 1; }
+
+	T* pointer = reinterpret_cast<T*>(allocate(sizeof(T) * (length + headerSize), alignof(T))) + headerSize;
+
+	*(reinterpret_cast<uint32_t*>(pointer) - 1) = length;
+
+	return pointer;
+}
+
+template <typename T>
+void TlsfAllocator::remove(T* object) {
+	assert(object);
+	object->~T();
+	deallocate(object);
+}
+
+template <typename T>
+void TlsfAllocator::removeNoDestruct(T* object) {
+	assert(object);
+	deallocate(object);
+}
+
+template <typename T>
+void TlsfAllocator::removeArray(T* object) {
+	assert(object);
+
+	uint32_t length = *(reinterpret_cast<uint32_t*>(object) - 1);
+
+	for (uint32_t i = 0; i < length; ++i) {
+		object[i].~T();
+	}
+
+	uint8_t headerSize = sizeof(uint32_t) / sizeof(T);
+
+	if (sizeof(uint32_t) % sizeof(T) > 0) { headerSize += 1; }
+
+	deallocate(object - headerSize);
+}
+
+template <typename T>
+void TlsfAllocator::removeArrayNoDestruct(T* object) {
+	assert(object);
+
+	uint8_t headerSize = sizeof(uint32_t) / sizeof(T);
+
+	if (sizeof(uint32_t) % sizeof(T) > 0) { headerSize += 1; }
+
+	deallocate(object - headerSize);
+}
+
+inline uint32_t TlsfAllocator::getBlockSize(const Block* block) {
+	return block->mSize & ~AllocatedBit;
+}
+
+inline bool TlsfAllocator::isAllocated(const Block* block) {
+	return (block->mSize & AllocatedBit) != 0;
+}
+
+inline TlsfAllocator::Block* TlsfAllocator::getNextBlock(Block* block) {
+	return reinterpret_cast<Block*>(reinterpret_cast<uintptr_t>(block) + getBlockSize(block));
+}
+
+inline void TlsfAllocator::mapping(uint32_t size, uint32_t& fl, uint32_t& sl) {
+	if (size < SmallSize) {
+		fl = 0;
+		sl = size / (SmallSize / SLCount);
+	} else {
+		uint32_t bit = 63 - allocator::countLeadingZeros(size);
+
+		fl = bit - FLShift + 1;
+		sl = (size >> (bit - SLShift)) ^ SLCount;
+	}
+}
+
+inline void TlsfAllocator::mappingSearch(uint32_t size, uint32_t& fl, uint32_t& sl) {
+	// Round up to the next list boundary, so every block in the list found is big enough.
+	if (size >= SmallSize) {
+		uint32_t bit = 63 - allocator::countLeadingZeros(size);
+		uint64_t rounded = uint64_t(size) + (uint64_t(1) << (bit - SLShift)) - 1;
+
+		size = rounded > 0xFFFFFFFFu ? 0xFFFFFFFFu : static_cast<uint32_t>(rounded);
+	}
+
+	mapping(size, fl, sl);
+}
+
+inline TlsfAllocator::FreeBlock* TlsfAllocator::findSuitable(uint32_t& fl, uint32_t& sl) const {
+	uint32_t slBitmap = sl < SLCount ? mSLBitmaps[fl] & (~0u << sl) : 0;
+
+	if (!slBitmap) {
+		uint32_t flBitmap = fl + 1 < 32 ? mFLBitmap & (~0u << (fl + 1)) : 0;
+
+		if (!flBitmap) { return nullptr; }
+
+		fl = allocator::countTrailingZeros(flBitmap);
+		slBitmap = mSLBitmaps[fl];
+	}
+
+	sl = allocator::countTrailingZeros(slBitmap);
+
+	return mBlocks[fl][sl];
+}
+
+inline void TlsfAllocator::insert(FreeBlock* block) {
+	uint32_t fl;
+	uint32_t sl;
+
+	mapping(block->mSize, fl, sl);
+
+	FreeBlock* head = mBlocks[fl][sl];
+
+	block->mPrevious = nullptr;
+	block->mNext     = head;
+
+	if (head) { head->mPrevious = block; }
+
+	mBlocks[fl][sl] = block;
+
+	mFLBitmap      |= 1u << fl;
+	mSLBitmaps[fl] |= 1u << sl;
+}
+
+inline void TlsfAllocator::erase(FreeBlock* block) {
+	uint32_t fl;
+	uint32_t sl;
+
+	mapping(block->mSize, fl, sl);
+	erase(block, fl, sl);
+}
+
+inline void TlsfAllocator::erase(FreeBlock* block, uint32_t fl, uint32_t sl) {
+	if (block->mPrevious) {
+		block->mPrevious->mNext = block->mNext;
+	} else {
+		mBlocks[fl][sl] = block->mNext;
+
+		if (!block->mNext) {
+			mSLBitmaps[fl] &= ~(1u << sl);
+			if (!mSLBitmaps[fl]) { mFLBitmap &= ~(1u << fl); }
+		}
+	}
+
+	if (block->mNext) { block->mNext->mPrevious = block->mPrevious; }
+}
+
+} // namespace simple
@@ -0,0 +1,88 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace simple {
+
+// Calls a trim function, for example PoolAllocator::trim, every period on a thread of its own and
+// sums up the bytes it reports. Allocators are not thread-safe: the function has to take whatever
+// lock guards the allocator it trims.
+class BackgroundTrimmer {
+public:
+	BackgroundTrimmer(std::chrono::milliseconds period, std::function<size_t()> trim);
+	~BackgroundTrimmer();
+
+	size_t getReleasedSize() const;
+	uint32_t getNumRuns() const;
+private:
+	BackgroundTrimmer(BackgroundTrimmer&) = delete;
+	BackgroundTrimmer(const BackgroundTrimmer&) = delete;
+
+	BackgroundTrimmer& operator=(BackgroundTrimmer&) = delete;
+	BackgroundTrimmer& operator=(const BackgroundTrimmer&) = delete;
+
+	void run();
+
+	std::function<size_t()>   mTrim;
+	std::chrono::milliseconds mPeriod;
+
+	std::mutex              mMutex;
+	std::condition_variable mCondition;
+	bool                    mStop;
+
+	std::atomic<size_t>   mReleasedSize;
+	std::atomic<uint32_t> mNumRuns;
+
+	std::thread mThread;
+};
+
+
+inline BackgroundTrimmer::BackgroundTrimmer(std::chrono::milliseconds period, std::function<size_t()> trim)
+		: mTrim(std::move(trim))
+		, mPeriod(period)
+		, mStop(false)
+		, mReleasedSize(0)
+		, mNumRuns(0)
+		, mThread(&BackgroundTrimmer::run, this) {}
+
+inline BackgroundTrimmer::~BackgroundTrimmer() {
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStop = true;
+	}
+
+	mCondition.notify_one();
+	mThread.join();
+}
+
+inline size_t BackgroundTrimmer::getReleasedSize() const {
+	return mReleasedSize.load(std::memory_order_relaxed);
+}
+
+inline uint32_t BackgroundTrimmer::getNumRuns() const {
+	return mNumRuns.load(std::memory_order_relaxed);
+}
+
+inline void BackgroundTrimmer::run() {
+	std::unique_lock<std::mutex> lock(mMutex);
+
+	while (!mCondition.wait_for(lock, mPeriod, [this]() { return mStop; })) {
+		lock.unlock();
+
+		mReleasedSize.fetch_add(mTrim(), std::memory_order_relaxed);
+		mNumRuns.fetch_add(1, std::memory_order_relaxed);
+
+		lock.lock();
+	}
+}
+
+} // namespace simple
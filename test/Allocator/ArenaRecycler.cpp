@@ -0,0 +1,147 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#include "Allocator/ArenaRecycler.h"
+
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace simple {
+
+namespace {
+
+bool isResident(void* begin, size_t size) {
+	auto pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	auto address  = reinterpret_cast<uintptr_t>(begin) & ~(pageSize - 1);
+
+	std::vector<unsigned char> pages((reinterpret_cast<uintptr_t>(begin) + size - address + pageSize - 1) / pageSize);
+	mincore(reinterpret_cast<void*>(address), pages.size() * pageSize, pages.data());
+
+	for (unsigned char page : pages) {
+		if (!(page & 1)) { return false; }
+	}
+
+	return true;
+}
+
+} // namespace
+
+TEST_CASE("ArenaRecycler", "[ArenaRecycler]") {
+	const uint32_t arenaSize = 256 * 1024;
+
+	SECTION("recycle") {
+		ArenaRecycler recycler(arenaSize, 4, 2);
+
+		REQUIRE(recycler.getArenaSize() >= arenaSize);
+
+		LinearAllocator* arena = recycler.acquire();
+
+		REQUIRE(recycler.getNumLive() == 1);
+		REQUIRE(recycler.getNumCreated() == 1);
+
+		// Faulted in before the request touches it.
+		uint8_t* data = arena->createArrayNoConstruct<uint8_t>(arenaSize - 8);
+		REQUIRE(isResident(data, arenaSize - 8));
+
+		std::memset(data, 1, arenaSize - 8);
+
+		recycler.release(arena);
+
+		REQUIRE(recycler.getNumLive() == 0);
+		REQUIRE(recycler.getNumIdle() == 1);
+
+		LinearAllocator* again = recycler.acquire();
+
+		REQUIRE(again == arena);
+		REQUIRE(again->getUsedMemory() == 0);
+		REQUIRE(again->getNumAllocations() == 0);
+		REQUIRE(recycler.getNumCreated() == 1);
+
+		recycler.release(again);
+	}
+
+	SECTION("bounded") {
+		ArenaRecycler recycler(arenaSize, 4, 2);
+
+		recycler.prewarm(3);
+
+		REQUIRE(recycler.getNumIdle() == 3);
+		REQUIRE(recycler.getNumCreated() == 3);
+
+		// Already warm, nothing to map.
+		recycler.prewarm(2);
+
+		REQUIRE(recycler.getNumCreated() == 3);
+
+		LinearAllocator* arenas[6];
+
+		for (auto& arena : arenas) { arena = recycler.acquire(); }
+
+		// The three prewarmed arenas were taken first.
+		REQUIRE(recycler.getNumIdle() == 0);
+		REQUIRE(recycler.getNumCreated() == 6);
+
+		for (auto* arena : arenas) { recycler.release(arena); }
+
+		// Two were unmapped right away.
+		REQUIRE(recycler.getNumIdle() == 4);
+
+		size_t released = recycler.trim();
+
+		REQUIRE(recycler.getNumIdle() == 2);
+		REQUIRE(released >= 2 * size_t(arenaSize));
+		REQUIRE(recycler.trim() == 0);
+
+		// The warmest arenas stay.
+		REQUIRE(recycler.acquire() == arenas[3]);
+		REQUIRE(recycler.acquire() == arenas[2]);
+
+		recycler.release(arenas[2]);
+		recycler.release(arenas[3]);
+	}
+
+	SECTION("threads") {
+		ArenaRecycler recycler(arenaSize, 8, 4);
+
+		const uint32_t numThreads  = 4;
+		const uint32_t numRequests = 2000;
+
+		std::atomic<uint32_t> numErrors(0);
+		std::vector<std::thread> threads;
+
+		for (uint32_t t = 0; t < numThreads; ++t) {
+			threads.emplace_back([&, t] {
+				for (uint32_t i = 0; i < numRequests; ++i) {
+					LinearAllocator* arena = recycler.acquire();
+
+					if (arena->getUsedMemory() != 0) { numErrors.fetch_add(1); }
+
+					uint32_t* values = arena->createArray<uint32_t>(64, t);
+
+					for (uint32_t j = 0; j < 64; ++j) {
+						if (values[j] != t) { numErrors.fetch_add(1); }
+					}
+
+					recycler.release(arena);
+
+					if (i % 100 == 0) { recycler.trim(); }
+				}
+			});
+		}
+
+		for (auto& thread : threads) { thread.join(); }
+
+		REQUIRE(numErrors.load() == 0);
+		REQUIRE(recycler.getNumLive() == 0);
+		REQUIRE(recycler.getNumCreated() <= numThreads * (numRequests / 100 + 1));
+	}
+}
+
+} // namespace simple
@@ -0,0 +1,133 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#include "Allocator/Bitmap.h"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <sys/mman.h>
+
+namespace simple {
+
+TEST_CASE("BitmapAllocator", "[BitmapAllocator]") {
+	const uint32_t blockSize = 4096;
+	const uint32_t numBlocks = 1000;
+
+	// Reserved only: the allocator must never fault any of it in.
+	void* memory = mmap(nullptr, size_t(numBlocks) * blockSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	REQUIRE(memory != MAP_FAILED);
+
+	SECTION("allocate") {
+		BitmapAllocator ba(memory, numBlocks, blockSize);
+		REQUIRE(ba.getNumBlocks() == numBlocks);
+		REQUIRE(ba.getNumFreeBlocks() == numBlocks);
+
+		void* b0 = ba.allocate();
+		void* b1 = ba.allocate(3);
+		void* b2 = ba.allocate();
+
+		REQUIRE(ba.getIndex(b0) == 0);
+		REQUIRE(ba.getIndex(b1) == 1);
+		REQUIRE(ba.getIndex(b2) == 4);
+		REQUIRE(ba.getNumFreeBlocks() == numBlocks - 5);
+
+		// The hole of three blocks takes a run of two, but not one of four.
+		ba.deallocate(b1, 3);
+
+		REQUIRE(ba.getIndex(ba.allocate(4)) == 5);
+		REQUIRE(ba.getIndex(ba.allocate(2)) == 1);
+		REQUIRE(ba.getIndex(ba.allocate()) == 3);
+
+		ba.clean();
+		REQUIRE(ba.getNumFreeBlocks() == numBlocks);
+	}
+
+	SECTION("long runs") {
+		BitmapAllocator ba(memory, numBlocks, blockSize);
+
+		void* head = ba.allocate(10);
+		void* big  = ba.allocate(900);
+
+		REQUIRE(ba.getIndex(big) == 10);
+		REQUIRE(ba.allocate(91) == nullptr);
+
+		void* tail = ba.allocate(90);
+		REQUIRE(ba.getIndex(tail) == 910);
+		REQUIRE(ba.getNumFreeBlocks() == 0);
+		REQUIRE(ba.allocate() == nullptr);
+
+		ba.deallocate(big, 900);
+
+		// Spans many whole bitmap words.
+		REQUIRE(ba.allocate(900) == big);
+
+		ba.deallocate(head, 10);
+		ba.deallocate(big, 900);
+		ba.deallocate(tail, 90);
+
+		REQUIRE(ba.getNumFreeBlocks() == numBlocks);
+		REQUIRE(ba.allocate(numBlocks) == memory);
+
+		ba.deallocate(memory, numBlocks);
+	}
+
+	SECTION("random") {
+		BitmapAllocator ba(memory, numBlocks, blockSize);
+
+		std::mt19937 random(11);
+		std::vector<std::pair<uint32_t, uint32_t>> live;
+		std::vector<bool> used(numBlocks, false);
+
+		for (uint32_t i = 0; i < 20000; ++i) {
+			if (live.empty() || random() % 2 == 0) {
+				uint32_t count = 1 + random() % (random() % 8 == 0 ? 200 : 8);
+				void* block = ba.allocate(count);
+
+				// The allocator must fail only when no run of that size exists.
+				uint32_t expected = numBlocks;
+
+				for (uint32_t begin = 0, length = 0; begin < numBlocks; ++begin) {
+					length = used[begin] ? 0 : length + 1;
+					if (length == count) { expected = begin + 1 - count; break; }
+				}
+
+				if (expected == numBlocks) {
+					REQUIRE(block == nullptr);
+					continue;
+				}
+
+				REQUIRE(block != nullptr);
+				REQUIRE(ba.getIndex(block) == expected);
+
+				for (uint32_t j = 0; j < count; ++j) { used[expected + j] = true; }
+
+				live.emplace_back(expected, count);
+			} else {
+				size_t index = random() % live.size();
+				auto [begin, count] = live[index];
+
+				ba.deallocate(ba.getBlock(begin), count);
+
+				for (uint32_t j = 0; j < count; ++j) { used[begin + j] = false; }
+
+				live[index] = live.back();
+				live.pop_back();
+			}
+		}
+
+		for (auto [begin, count] : live) {
+			ba.deallocate(ba.getBlock(begin), count);
+		}
+
+		REQUIRE(ba.getNumFreeBlocks() == numBlocks);
+	}
+
+	munmap(memory, size_t(numBlocks) * blockSize);
+}
+
+} // namespace simple
@@ -0,0 +1,175 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#include "Allocator/Buddy.h"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace simple {
+
+TEST_CASE("BuddyAllocator", "[BuddyAllocator]") {
+	struct A {
+		A() = default;
+		A(float x, float y, float z, float w) : array { x, y, z, w } {}
+
+		float array[4];
+	};
+
+	struct B {
+		B() = default;
+		B(uint64_t x, uint64_t y, uint64_t z) : array { x, y, z } {}
+
+		uint64_t array[3];
+	};
+
+	const size_t size = 64 * 1024;
+	void* memory = std::aligned_alloc(size, size);
+
+	SECTION("create") {
+		BuddyAllocator ba(memory, size, 16);
+		REQUIRE(ba.getSize() == size);
+		REQUIRE(ba.getMaxOrder() == 12);
+		REQUIRE(ba.getNumFreeBlocks(12) == 1);
+
+		auto* a0 = ba.create<A>(1.1f, 1.2f, 1.3f, 1.4f);
+		auto* b0 = ba.create<B>(10, 20, 30);
+		auto* a1 = ba.create<A>(2.1f, 2.2f, 2.3f, 2.4f);
+
+		// A takes a block of order 0 (16), B one of order 1 (32).
+		REQUIRE(ba.getUsedMemory() == 64);
+		REQUIRE(ba.getNumAllocations() == 3);
+
+		REQUIRE(reinterpret_cast<uint8_t*>(a1) == reinterpret_cast<uint8_t*>(a0) + 16);
+		REQUIRE(reinterpret_cast<uint8_t*>(b0) == reinterpret_cast<uint8_t*>(a0) + 32);
+
+		REQUIRE(a0->array[0] == 1.1f);
+		REQUIRE(b0->array[2] == 30);
+		REQUIRE(a1->array[3] == 2.4f);
+
+		ba.remove(a0);
+		REQUIRE(ba.getNumFreeBlocks(0) == 1);
+
+		ba.remove(a1);
+		REQUIRE(ba.getNumFreeBlocks(0) == 0);
+		REQUIRE(ba.getNumFreeBlocks(1) == 1);
+
+		ba.remove(b0);
+		REQUIRE(ba.getNumFreeBlocks(12) == 1);
+
+		REQUIRE(ba.getUsedMemory() == 0);
+		REQUIRE(ba.getNumAllocations() == 0);
+	}
+
+	SECTION("createArray") {
+		BuddyAllocator ba(memory, size, 16);
+
+		auto* a = ba.createArray<A>(10, 1.0f, 2.0f, 3.0f, 4.0f);
+		auto* c = ba.createArrayNoConstruct<uint8_t>(33);
+
+		for (uint32_t i = 0; i < 10; ++i) {
+			REQUIRE(a[i].array[0] == 1.0f);
+			REQUIRE(a[i].array[3] == 4.0f);
+		}
+
+		std::memset(c, 0xFF, 33);
+
+		// 176 bytes round up to 256, 37 to 64.
+		REQUIRE(ba.getUsedMemory() == 320);
+
+		ba.removeArray(a);
+		ba.removeArrayNoDestruct(c);
+
+		REQUIRE(ba.getNumAllocations() == 0);
+		REQUIRE(ba.getNumFreeBlocks(12) == 1);
+	}
+
+	SECTION("order") {
+		BuddyAllocator ba(memory, size, 64, true);
+
+		REQUIRE(ba.getOrder(1) == 0);
+		REQUIRE(ba.getOrder(64) == 0);
+		REQUIRE(ba.getOrder(65) == 1);
+		REQUIRE(ba.getOrder(4096) == 6);
+
+		void* pointers[4];
+
+		for (uint32_t i = 0; i < 4; ++i) {
+			pointers[i] = ba.allocate(i);
+			REQUIRE(reinterpret_cast<uintptr_t>(pointers[i]) % (64u << i) == 0);
+		}
+
+		for (uint32_t i = 0; i < 4; ++i) {
+			ba.free(pointers[i]);
+		}
+
+		REQUIRE(ba.getNumAllocations() == 0);
+		REQUIRE(ba.getNumFreeBlocks(ba.getMaxOrder()) == 1);
+	}
+
+	SECTION("uneven") {
+		// 48 KiB is one block of 32 KiB followed by one of 16 KiB, which never merge.
+		BuddyAllocator ba(memory, 48 * 1024, 1024);
+
+		REQUIRE(ba.getMaxOrder() == 5);
+		REQUIRE(ba.getNumFreeBlocks(5) == 1);
+		REQUIRE(ba.getNumFreeBlocks(4) == 1);
+
+		void* big   = ba.allocate(5);
+		void* small = ba.allocate(4);
+
+		REQUIRE(reinterpret_cast<uint8_t*>(small) == reinterpret_cast<uint8_t*>(big) + 32 * 1024);
+
+		ba.free(small, 4);
+		ba.free(big, 5);
+
+		REQUIRE(ba.getNumFreeBlocks(5) == 1);
+		REQUIRE(ba.getNumFreeBlocks(4) == 1);
+	}
+
+	SECTION("random") {
+		BuddyAllocator ba(memory, size, 16);
+
+		std::mt19937 random(5);
+		std::vector<std::pair<uint8_t*, uint32_t>> live;
+
+		for (uint32_t i = 0; i < 5000; ++i) {
+			if (live.size() < 100 && (live.empty() || random() % 3 != 0)) {
+				uint32_t order = random() % 6;
+				uint32_t length = 16u << order;
+				auto* pointer = reinterpret_cast<uint8_t*>(ba.allocate(order));
+				std::memset(pointer, static_cast<int>(order + 1), length);
+				live.emplace_back(pointer, order);
+			} else {
+				size_t index = random() % live.size();
+				auto [pointer, order] = live[index];
+
+				for (uint32_t j = 0; j < (16u << order); ++j) {
+					REQUIRE(pointer[j] == order + 1);
+				}
+
+				ba.free(pointer, order);
+				live[index] = live.back();
+				live.pop_back();
+			}
+		}
+
+		std::shuffle(live.begin(), live.end(), random);
+
+		for (auto& allocation : live) {
+			ba.free(allocation.first, allocation.second);
+		}
+
+		REQUIRE(ba.getUsedMemory() == 0);
+		REQUIRE(ba.getNumFreeBlocks(12) == 1);
+	}
+
+	std::free(memory);
+}
+
+} // namespace simple
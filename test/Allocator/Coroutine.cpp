@@ -0,0 +1,124 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#include "Allocator/Coroutine.h"
+
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+
+namespace simple {
+
+namespace {
+
+using Task = ArenaTask<uint64_t>;
+
+Task leaf(uint64_t value) {
+	co_return value * 2;
+}
+
+// Each level awaits the next one, so frames nest like a call stack.
+Task nested(uint32_t depth) {
+	if (depth == 0) { co_return co_await leaf(1); }
+
+	uint64_t inner = co_await nested(depth - 1);
+
+	co_return inner + co_await leaf(depth);
+}
+
+Task explicitArena(std::allocator_arg_t, CoroutineArena&, uint64_t value) {
+	co_return value + 1;
+}
+
+struct Handler {
+	Task handle(std::allocator_arg_t, CoroutineArena&, uint64_t value) {
+		co_return value + mOffset;
+	}
+
+	uint64_t mOffset = 10;
+};
+
+} // namespace
+
+TEST_CASE("CoroutineArena", "[CoroutineArena]") {
+	const uint32_t size = 64 * 1024;
+	void* memory = std::malloc(size);
+
+	SECTION("stack") {
+		StackAllocator stack(memory, size);
+		CoroutineArena arena(stack);
+
+		{
+			CoroutineArenaScope scope(arena);
+
+			Task task = nested(16);
+
+			REQUIRE(stack.getNumAllocations() == 1);
+			REQUIRE(task.get() == 2 + 2 * (16 * 17 / 2));
+
+			// Inner frames were freed in reverse order as they finished.
+			REQUIRE(stack.getNumAllocations() == 1);
+		}
+
+		REQUIRE(stack.getNumAllocations() == 0);
+		REQUIRE(stack.getUsedMemory() == 0);
+		REQUIRE(arena.getNumFallbacks() == 0);
+	}
+
+	SECTION("linear") {
+		LinearAllocator linear(memory, size);
+		CoroutineArena arena(linear);
+
+		{
+			CoroutineArenaScope scope(arena);
+
+			REQUIRE(CoroutineArena::getCurrent() == &arena);
+
+			for (uint32_t i = 0; i < 10; ++i) { REQUIRE(nested(4).get() == 2 + 2 * 10); }
+		}
+
+		REQUIRE(CoroutineArena::getCurrent() == nullptr);
+
+		// Every frame stays in the arena until the request is over.
+		REQUIRE(linear.getNumAllocations() == 10 * 10);
+
+		linear.clean();
+	}
+
+	SECTION("allocator arg") {
+		LinearAllocator linear(memory, size);
+		CoroutineArena arena(linear);
+
+		REQUIRE(explicitArena(std::allocator_arg, arena, 41).get() == 42);
+		REQUIRE(linear.getNumAllocations() == 1);
+
+		Handler handler;
+
+		REQUIRE(handler.handle(std::allocator_arg, arena, 5).get() == 15);
+		REQUIRE(linear.getNumAllocations() == 2);
+
+		linear.clean();
+	}
+
+	SECTION("fallback") {
+		StackAllocator stack(memory, 256);
+		CoroutineArena arena(stack);
+
+		{
+			CoroutineArenaScope scope(arena);
+
+			REQUIRE(nested(8).get() == 2 + 2 * (8 * 9 / 2));
+		}
+
+		REQUIRE(arena.getNumFallbacks() > 0);
+		REQUIRE(stack.getNumAllocations() == 0);
+
+		// No arena, no scope: plain heap frames.
+		REQUIRE(leaf(4).get() == 8);
+	}
+
+	std::free(memory);
+}
+
+} // namespace simple
@@ -0,0 +1,105 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#include "Allocator/Deferred.h"
+#include "Allocator/Pool.h"
+#include "Allocator/Stack.h"
+
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace simple {
+
+TEST_CASE("DeferredFreeQueue", "[DeferredFreeQueue]") {
+	struct Counted {
+		Counted(uint32_t& numDestroyed) : mNumDestroyed(numDestroyed) {}
+		~Counted() { ++mNumDestroyed; }
+
+		uint32_t& mNumDestroyed;
+	};
+
+	SECTION("drain") {
+		PoolAllocator<Counted> pool(16);
+		DeferredFreeQueue queue(4);
+
+		uint32_t numDestroyed = 0;
+
+		Counted* objects[5];
+
+		for (auto& object : objects) { object = pool.create(numDestroyed); }
+
+		for (uint32_t i = 0; i < 4; ++i) { REQUIRE(queue.pushRemove(pool, objects[i])); }
+
+		// Full: the realtime side keeps the object instead of waiting.
+		REQUIRE(!queue.pushRemove(pool, objects[4]));
+		REQUIRE(queue.getNumPending() == 4);
+		REQUIRE(numDestroyed == 0);
+
+		REQUIRE(queue.drain() == 4);
+		REQUIRE(numDestroyed == 4);
+		REQUIRE(pool.getNumFreeObjects() == 15);
+
+		REQUIRE(queue.pushRemove(pool, objects[4]));
+	}
+
+	SECTION("mixed allocators") {
+		const size_t size = 1024;
+		void* memory = std::malloc(size);
+
+		PoolAllocator<uint64_t> pool(16);
+		StackAllocator stack(memory, size);
+		DeferredFreeQueue queue(8);
+
+		uint32_t numRaw = 0;
+
+		REQUIRE(queue.pushRemove(pool, pool.create(1)));
+		REQUIRE(queue.pushRemove(stack, stack.create<uint64_t>(2)));
+		REQUIRE(queue.push(&numRaw, &numRaw, [](void* counter, void*) { ++*reinterpret_cast<uint32_t*>(counter); }));
+
+		REQUIRE(queue.drain() == 3);
+		REQUIRE(pool.getNumFreeObjects() == 16);
+		REQUIRE(stack.getNumAllocations() == 0);
+		REQUIRE(numRaw == 1);
+
+		std::free(memory);
+	}
+
+	SECTION("threads") {
+		const uint32_t numObjects = 100000;
+
+		PoolAllocator<uint64_t> pool(numObjects);
+		DeferredFreeQueue queue(256);
+
+		std::vector<uint64_t*> objects;
+
+		for (uint32_t i = 0; i < numObjects; ++i) { objects.push_back(pool.create(i)); }
+
+		std::atomic<bool> done(false);
+		uint32_t numFreed = 0;
+
+		std::thread housekeeping([&] {
+			while (!done.load()) {
+				numFreed += queue.drain();
+				std::this_thread::yield();
+			}
+
+			numFreed += queue.drain();
+		});
+
+		for (uint64_t* object : objects) {
+			while (!queue.pushRemove(pool, object)) { std::this_thread::yield(); }
+		}
+
+		done.store(true);
+		housekeeping.join();
+
+		REQUIRE(numFreed == numObjects);
+		REQUIRE(pool.getNumFreeObjects() == numObjects);
+	}
+}
+
+} // namespace simple
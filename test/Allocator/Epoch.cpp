@@ -0,0 +1,216 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#include "Allocator/Epoch.h"
+#include "Allocator/Linear.h"
+#include "Allocator/Pool.h"
+
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace simple {
+
+TEST_CASE("EpochReclaimer", "[EpochReclaimer]") {
+	struct Node {
+		Node(uint64_t value) : mValue(value) {}
+		~Node() { mValue = 0xDEAD; }
+
+		// The pool links a freed node through its first word, which keeps the poison in mValue.
+		uint64_t mLink = 0;
+		uint64_t mValue;
+	};
+
+	SECTION("retire") {
+		PoolAllocator<Node> pool(100);
+		EpochReclaimer reclaimer(4);
+
+		EpochReclaimer::Sink sink = EpochReclaimer::makeSink(pool);
+
+		uint32_t writer = reclaimer.registerThread();
+		uint32_t reader = reclaimer.registerThread();
+
+		REQUIRE(writer != reader);
+
+		// The reader entered before the nodes were retired and may still see them.
+		reclaimer.enter(reader);
+		reclaimer.enter(writer);
+
+		for (uint64_t i = 0; i < 10; ++i) { reclaimer.retire(writer, pool.create(i), &sink); }
+
+		reclaimer.exit(writer);
+
+		REQUIRE(reclaimer.getNumRetired(writer) == 10);
+		REQUIRE(reclaimer.collect(writer) == 0);
+		REQUIRE(reclaimer.collect(writer) == 0);
+		REQUIRE(pool.getNumFreeObjects() == 90);
+
+		// The epoch moved on once, but the reader still sits in the old one. As soon as it leaves
+		// the second advance happens and the whole bag goes back in one call.
+		REQUIRE(reclaimer.getEpoch() == 2);
+
+		reclaimer.exit(reader);
+
+		REQUIRE(reclaimer.collect(writer) == 10);
+		REQUIRE(pool.getNumFreeObjects() == 100);
+		REQUIRE(reclaimer.getNumRetired(writer) == 0);
+
+		reclaimer.unregisterThread(reader);
+		reclaimer.unregisterThread(writer);
+	}
+
+	SECTION("late reader") {
+		PoolAllocator<Node> pool(10);
+		EpochReclaimer reclaimer(4);
+
+		EpochReclaimer::Sink sink = EpochReclaimer::makeSink(pool);
+
+		uint32_t writer    = reclaimer.registerThread();
+		uint32_t collector = reclaimer.registerThread();
+		uint32_t reader    = reclaimer.registerThread();
+
+		Node* node = pool.create(1);
+
+		// The writer pins the epoch, then another thread moves the global epoch on.
+		reclaimer.enter(writer);
+		reclaimer.collect(collector);
+
+		REQUIRE(reclaimer.getEpoch() == 2);
+
+		// The reader pins the newer epoch and still sees the node when the writer retires it.
+		reclaimer.enter(reader);
+		reclaimer.retire(writer, node, &sink);
+		reclaimer.quiescent(writer);
+
+		REQUIRE(reclaimer.collect(writer) == 0);
+		REQUIRE(reclaimer.getEpoch() == 3);
+		REQUIRE(node->mValue == 1);
+		REQUIRE(pool.getNumFreeObjects() == 9);
+
+		reclaimer.exit(reader);
+		reclaimer.exit(writer);
+
+		while (reclaimer.getNumRetired(writer)) { reclaimer.collect(writer); }
+
+		REQUIRE(pool.getNumFreeObjects() == 10);
+
+		reclaimer.unregisterThread(reader);
+		reclaimer.unregisterThread(collector);
+		reclaimer.unregisterThread(writer);
+	}
+
+	SECTION("linear") {
+		struct Counted {
+			Counted(uint32_t* numDestroyed) : mNumDestroyed(numDestroyed) {}
+			~Counted() { ++*mNumDestroyed; }
+
+			uint32_t* mNumDestroyed;
+		};
+
+		const uint32_t size = 4096;
+		void* memory = std::malloc(size);
+
+		LinearAllocator linear(memory, size);
+		EpochReclaimer reclaimer(2);
+
+		EpochReclaimer::Sink sink = EpochReclaimer::makeSink<Counted>(linear);
+
+		uint32_t thread = reclaimer.registerThread();
+		uint32_t numDestroyed = 0;
+
+		reclaimer.enter(thread);
+
+		for (uint32_t i = 0; i < 10; ++i) { reclaimer.retire(thread, linear.create<Counted>(&numDestroyed), &sink); }
+
+		reclaimer.exit(thread);
+
+		// Two advances later the objects are destroyed, the arena memory waits for clean.
+		while (reclaimer.getNumRetired(thread)) { reclaimer.collect(thread); }
+
+		REQUIRE(numDestroyed == 10);
+		REQUIRE(linear.getNumAllocations() == 10);
+
+		linear.clean();
+		reclaimer.unregisterThread(thread);
+
+		std::free(memory);
+	}
+
+	SECTION("threads") {
+		// Enough nodes that a reader preempted inside its critical section cannot starve the writer.
+		const uint32_t numNodes = 1 << 17;
+
+		PoolAllocator<Node> pool(numNodes);
+		std::mutex poolMutex;
+
+		EpochReclaimer::Sink sink = EpochReclaimer::makeSink(pool);
+
+		EpochReclaimer reclaimer(8);
+
+		std::atomic<Node*> shared(pool.create(0));
+		std::atomic<bool> done(false);
+		std::atomic<uint32_t> numBadReads(0);
+
+		std::vector<std::thread> readers;
+
+		for (uint32_t t = 0; t < 3; ++t) {
+			readers.emplace_back([&] {
+				uint32_t thread = reclaimer.registerThread();
+
+				while (!done.load()) {
+					reclaimer.enter(thread);
+
+					Node* node = shared.load(std::memory_order_acquire);
+					if (node->mValue == 0xDEAD) { ++numBadReads; }
+
+					reclaimer.exit(thread);
+				}
+
+				reclaimer.unregisterThread(thread);
+			});
+		}
+
+		uint32_t writer = reclaimer.registerThread();
+
+		for (uint64_t i = 1; i < numNodes; ++i) {
+			Node* node;
+
+			{
+				std::lock_guard<std::mutex> lock(poolMutex);
+				node = pool.create(i);
+			}
+
+			reclaimer.enter(writer);
+
+			Node* old = shared.exchange(node, std::memory_order_acq_rel);
+
+			{
+				// Retire may collect, and collecting frees into the pool.
+				std::lock_guard<std::mutex> lock(poolMutex);
+				reclaimer.retire(writer, old, &sink);
+			}
+
+			reclaimer.exit(writer);
+		}
+
+		done.store(true);
+
+		for (auto& reader : readers) { reader.join(); }
+
+		REQUIRE(numBadReads == 0);
+
+		// Nothing is left in flight: every bag drains once the epoch moves on.
+		while (reclaimer.getNumRetired(writer)) { reclaimer.collect(writer); }
+
+		REQUIRE(pool.getNumFreeObjects() == numNodes - 1);
+
+		pool.remove(shared.load());
+		reclaimer.unregisterThread(writer);
+	}
+}
+
+} // namespace simple
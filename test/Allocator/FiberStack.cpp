@@ -0,0 +1,175 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#include "Allocator/FiberStack.h"
+
+#include <catch2/catch.hpp>
+
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+namespace simple {
+
+namespace {
+
+uint32_t getNumResidentPages(void* begin, size_t size) {
+	size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+	std::vector<unsigned char> pages(size / pageSize);
+	mincore(begin, size, pages.data());
+
+	uint32_t numResident = 0;
+
+	for (unsigned char page : pages) { numResident += page & 1; }
+
+	return numResident;
+}
+
+ucontext_t gMainContext;
+ucontext_t gFiberContext;
+
+uint64_t gFiberResult = 0;
+
+uint64_t recurse(uint32_t depth) {
+	volatile uint8_t frame[512];
+
+	frame[0] = static_cast<uint8_t>(depth);
+
+	return depth == 0 ? frame[0] : frame[0] + recurse(depth - 1);
+}
+
+void fiberMain() {
+	gFiberResult = recurse(64);
+	swapcontext(&gFiberContext, &gMainContext);
+}
+
+void runFiber(void* stack, size_t size) {
+	getcontext(&gFiberContext);
+
+	gFiberContext.uc_stack.ss_sp   = stack;
+	gFiberContext.uc_stack.ss_size = size;
+	gFiberContext.uc_link          = &gMainContext;
+
+	makecontext(&gFiberContext, fiberMain, 0);
+
+	swapcontext(&gMainContext, &gFiberContext);
+}
+
+} // namespace
+
+TEST_CASE("FiberStackAllocator", "[FiberStackAllocator]") {
+	const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+	SECTION("allocate") {
+		FiberStackAllocator stacks(4, 64 * 1024);
+
+		REQUIRE(stacks.getNumTotalStacks() == 4);
+		REQUIRE(stacks.getNumFreeStacks() == 4);
+		REQUIRE(stacks.getStackSize() == 64 * 1024);
+
+		void* s0 = stacks.allocate();
+		void* s1 = stacks.allocate();
+		void* s2 = stacks.allocate();
+		void* s3 = stacks.allocate();
+
+		REQUIRE(stacks.allocate() == nullptr);
+		REQUIRE(stacks.getNumFreeStacks() == 0);
+
+		REQUIRE(stacks.getIndex(s0) == 0);
+		REQUIRE(stacks.getIndex(s3) == 3);
+
+		// Stacks are separated by one guard page.
+		REQUIRE(reinterpret_cast<uintptr_t>(s1) - reinterpret_cast<uintptr_t>(s0) == 64 * 1024 + pageSize);
+		REQUIRE(stacks.getTop(s0) == reinterpret_cast<uint8_t*>(s0) + 64 * 1024);
+
+		std::memset(s2, 0xab, stacks.getStackSize());
+
+		stacks.deallocate(s2);
+		stacks.deallocate(s1);
+
+		// Most recently returned first.
+		REQUIRE(stacks.allocate() == s1);
+		REQUIRE(stacks.allocate() == s2);
+
+		for (void* stack : { s0, s1, s2, s3 }) { stacks.deallocate(stack); }
+
+		REQUIRE(stacks.getNumFreeStacks() == 4);
+		REQUIRE_FALSE(stacks.owns(&pageSize));
+	}
+
+	SECTION("out of address space") {
+		// More than a 47-bit address space can hold.
+		FiberStackAllocator stacks(1024, size_t(1) << 40);
+
+		REQUIRE(stacks.getNumTotalStacks() == 0);
+		REQUIRE(stacks.getNumFreeStacks() == 0);
+		REQUIRE(stacks.allocate() == nullptr);
+		REQUIRE_FALSE(stacks.owns(&pageSize));
+	}
+
+	SECTION("decommit") {
+		const size_t stackSize    = 256 * 1024;
+		const size_t retainedSize = 16 * 1024;
+
+		FiberStackAllocator stacks(2, stackSize, retainedSize);
+
+		void* stack = stacks.allocate();
+
+		std::memset(stack, 1, stackSize);
+		REQUIRE(getNumResidentPages(stack, stackSize) == stackSize / pageSize);
+
+		stacks.deallocate(stack);
+		REQUIRE(getNumResidentPages(stack, stackSize) == retainedSize / pageSize);
+
+		// The retained top keeps its contents, the rest comes back zeroed.
+		REQUIRE(reinterpret_cast<uint8_t*>(stacks.getTop(stack))[-1] == 1);
+		REQUIRE(reinterpret_cast<uint8_t*>(stack)[0] == 0);
+	}
+
+	SECTION("guard page") {
+		FiberStackAllocator stacks(2, 64 * 1024);
+
+		void* stack = stacks.allocate();
+
+		pid_t child = fork();
+
+		if (child == 0) {
+			// Runs off the bottom of the stack.
+			reinterpret_cast<volatile uint8_t*>(stack)[-1] = 1;
+			_exit(0);
+		}
+
+		int status = 0;
+		waitpid(child, &status, 0);
+
+		REQUIRE(WIFSIGNALED(status));
+		REQUIRE(WTERMSIG(status) == SIGSEGV);
+
+		stacks.deallocate(stack);
+	}
+
+	SECTION("fiber") {
+		FiberStackAllocator stacks(8, 64 * 1024);
+
+		for (uint32_t i = 0; i < 100; ++i) {
+			void* stack = stacks.allocate();
+
+			gFiberResult = 0;
+			runFiber(stack, stacks.getStackSize());
+
+			REQUIRE(gFiberResult == 64 * 65 / 2);
+
+			stacks.deallocate(stack);
+		}
+
+		REQUIRE(stacks.getNumFreeStacks() == 8);
+	}
+}
+
+} // namespace simple
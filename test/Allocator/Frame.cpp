@@ -0,0 +1,129 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#include "Allocator/Frame.h"
+
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <thread>
+
+namespace simple {
+
+TEST_CASE("Allocator Frame", "[FrameAllocator]") {
+	struct A {
+		A() = default;
+		A(float x, float y, float z, float w) : array { x, y, z, w } {}
+
+		float array[4];
+	};
+
+	const uint32_t frameSize = 1024;
+	const uint32_t numFrames = 3;
+
+	void* memory = std::malloc(frameSize * numFrames);
+
+	SECTION("rotate") {
+		FrameAllocator fa(memory, frameSize, numFrames);
+
+		REQUIRE(fa.getFrame() == 0);
+		REQUIRE(fa.getNumFramesInFlight() == 1);
+
+		A* a0 = fa.create<A>(1.0f, 2.0f, 3.0f, 4.0f);
+		REQUIRE(fa.getArena().getUsedMemory() == 16);
+
+		REQUIRE(fa.beginFrame());
+		uint32_t* a1 = fa.createArray<uint32_t>(8, 7u);
+		REQUIRE(fa.getArena().getUsedMemory() == 36);
+
+		REQUIRE(fa.beginFrame());
+		REQUIRE(fa.getFrame() == 2);
+		REQUIRE(fa.getNumFramesInFlight() == 3);
+
+		// Frame 3 reuses the arena of frame 0, which is still in flight.
+		REQUIRE_FALSE(fa.beginFrame());
+		REQUIRE(fa.getFrame() == 2);
+
+		// Data of frames in flight stays untouched.
+		REQUIRE(a0->array[3] == 4.0f);
+		REQUIRE(a1[7] == 7);
+
+		fa.retire(0);
+		REQUIRE(fa.isRetired(0));
+		REQUIRE_FALSE(fa.isRetired(1));
+
+		REQUIRE(fa.beginFrame());
+		REQUIRE(fa.getFrame() == 3);
+		REQUIRE(fa.getArena().getUsedMemory() == 0);
+		REQUIRE(fa.create<A>(5.0f, 6.0f, 7.0f, 8.0f) == a0);
+
+		REQUIRE(a1[7] == 7);
+
+		// Retiring a frame retires every frame before it too.
+		fa.retire(2);
+		REQUIRE(fa.isRetired(1));
+		REQUIRE(fa.isRetired(2));
+		REQUIRE(fa.getNumFramesInFlight() == 1);
+
+		// A late retire of an older frame changes nothing.
+		fa.retire(1);
+		REQUIRE(fa.isRetired(2));
+		REQUIRE_FALSE(fa.isRetired(3));
+		REQUIRE(fa.getNumFramesInFlight() == 1);
+	}
+
+	SECTION("single") {
+		FrameAllocator fa(memory, frameSize, 1);
+
+		fa.create<A>();
+
+		REQUIRE_FALSE(fa.beginFrame());
+
+		fa.retire(0);
+
+		REQUIRE(fa.beginFrame());
+		REQUIRE(fa.getArena().getNumAllocations() == 0);
+	}
+
+	SECTION("fence thread") {
+		FrameAllocator fa(memory, frameSize, numFrames);
+
+		const uint32_t numFramesTotal = 10000;
+
+		std::atomic<uint64_t> submitted(0);
+		uint32_t numErrors = 0;
+
+		// Plays the GPU: finishes frames in order some time after they were submitted.
+		std::thread fence([&] {
+			for (uint64_t frame = 0; frame < numFramesTotal; ++frame) {
+				while (submitted.load(std::memory_order_acquire) <= frame) { std::this_thread::yield(); }
+				fa.retire(frame);
+			}
+		});
+
+		for (uint32_t i = 0; i < numFramesTotal; ++i) {
+			auto* values = fa.createArray<uint64_t>(16, fa.getFrame());
+
+			for (uint32_t j = 0; j < 16; ++j) {
+				if (values[j] != fa.getFrame()) { ++numErrors; }
+			}
+
+			submitted.store(fa.getFrame() + 1, std::memory_order_release);
+
+			if (i + 1 == numFramesTotal) { break; }
+
+			while (!fa.beginFrame()) { std::this_thread::yield(); }
+		}
+
+		fence.join();
+
+		REQUIRE(numErrors == 0);
+		REQUIRE(fa.getFrame() == numFramesTotal - 1);
+		REQUIRE(fa.getNumFramesInFlight() == 0);
+	}
+
+	std::free(memory);
+}
+
+} // namespace simple
@@ -0,0 +1,180 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#include "Allocator/FreeList.h"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace simple {
+
+TEST_CASE("FreeListAllocator", "[FreeListAllocator]") {
+	struct A {
+		A() = default;
+		A(float x, float y, float z, float w) : array { x, y, z, w } {}
+
+		float array[4];
+	};
+
+	struct B {
+		B() = default;
+		B(uint64_t x, uint64_t y, uint64_t z) : array { x, y, z } {}
+
+		uint64_t array[3];
+	};
+
+	const size_t size = 64 * 1024;
+	void* memory = std::malloc(size);
+
+	SECTION("create") {
+		FreeListAllocator fa(memory, size);
+		REQUIRE(fa.getSize() == size);
+		REQUIRE(fa.getNumFreeBlocks() == 1);
+
+		auto* a0 = fa.create<A>(1.1f, 1.2f, 1.3f, 1.4f);
+		auto* b0 = fa.create<B>(10, 20, 30);
+		auto* a1 = fa.create<A>(2.1f, 2.2f, 2.3f, 2.4f);
+
+		// header = 8
+		// data   = 16 [4 * sizeof(float)], 24 [3 * sizeof(uint64_t)]
+		// sum    = 80 [8 + 16 + 8 + 24 + 8 + 16]
+		REQUIRE(fa.getUsedMemory() == 80);
+		REQUIRE(fa.getNumAllocations() == 3);
+
+		REQUIRE(a0->array[0] == 1.1f);
+		REQUIRE(b0->array[2] == 30);
+		REQUIRE(a1->array[3] == 2.4f);
+
+		// Freed out of order, the middle block merges with both neighbours.
+		fa.remove(a0);
+		REQUIRE(fa.getNumFreeBlocks() == 2);
+
+		fa.remove(a1);
+		REQUIRE(fa.getNumFreeBlocks() == 2);
+
+		fa.remove(b0);
+		REQUIRE(fa.getNumFreeBlocks() == 1);
+
+		REQUIRE(fa.getUsedMemory() == 0);
+		REQUIRE(fa.getNumAllocations() == 0);
+	}
+
+	SECTION("createArray") {
+		FreeListAllocator fa(memory, size);
+
+		auto* a = fa.createArray<A>(10, 1.0f, 2.0f, 3.0f, 4.0f);
+		auto* c = fa.createArrayNoConstruct<uint8_t>(33);
+
+		for (uint32_t i = 0; i < 10; ++i) {
+			REQUIRE(a[i].array[0] == 1.0f);
+			REQUIRE(a[i].array[3] == 4.0f);
+		}
+
+		std::memset(c, 0xFF, 33);
+
+		fa.removeArray(a);
+		fa.removeArrayNoDestruct(c);
+
+		REQUIRE(fa.getNumAllocations() == 0);
+		REQUIRE(fa.getNumFreeBlocks() == 1);
+	}
+
+	SECTION("alignment") {
+		FreeListAllocator fa(memory, size);
+
+		std::vector<void*> pointers;
+
+		for (uint32_t alignment = 1; alignment <= 128; alignment *= 2) {
+			void* pointer = fa.allocate(24, alignment);
+			REQUIRE(reinterpret_cast<uintptr_t>(pointer) % alignment == 0);
+			pointers.push_back(pointer);
+		}
+
+		for (void* pointer : pointers) {
+			fa.deallocate(pointer);
+		}
+
+		REQUIRE(fa.getNumAllocations() == 0);
+		REQUIRE(fa.getNumFreeBlocks() == 1);
+	}
+
+	SECTION("policy") {
+		FreeListAllocator first(memory, size, FreeListAllocator::Policy::FirstFit);
+
+		void* big0  = first.allocate(256, 8);
+		void* gap0  = first.allocate(8, 8);
+		void* small = first.allocate(64, 8);
+		void* gap1  = first.allocate(8, 8);
+
+		first.deallocate(big0);
+		first.deallocate(small);
+
+		// The small hole was freed last and sits at the front of the list.
+		REQUIRE(first.allocate(64, 8) == small);
+		REQUIRE(first.allocate(200, 8) == big0);
+
+		first.clean();
+
+		FreeListAllocator best(memory, size, FreeListAllocator::Policy::BestFit);
+
+		big0  = best.allocate(256, 8);
+		gap0  = best.allocate(8, 8);
+		small = best.allocate(64, 8);
+		gap1  = best.allocate(8, 8);
+
+		best.deallocate(small);
+		best.deallocate(big0);
+
+		REQUIRE(best.allocate(64, 8) == small);
+
+		best.clean();
+
+		(void)gap0;
+		(void)gap1;
+	}
+
+	SECTION("random") {
+		FreeListAllocator fa(memory, size, FreeListAllocator::Policy::BestFit);
+
+		std::mt19937 random(3);
+		std::vector<std::pair<uint8_t*, uint32_t>> live;
+
+		for (uint32_t i = 0; i < 5000; ++i) {
+			if (live.size() < 100 && (live.empty() || random() % 3 != 0)) {
+				uint32_t length = 1 + random() % 300;
+				auto* pointer = reinterpret_cast<uint8_t*>(fa.allocate(length, 1u << (random() % 5)));
+				std::memset(pointer, static_cast<int>(length & 0xFF), length);
+				live.emplace_back(pointer, length);
+			} else {
+				size_t index = random() % live.size();
+				auto [pointer, length] = live[index];
+
+				for (uint32_t j = 0; j < length; ++j) {
+					REQUIRE(pointer[j] == (length & 0xFF));
+				}
+
+				fa.deallocate(pointer);
+				live[index] = live.back();
+				live.pop_back();
+			}
+		}
+
+		std::shuffle(live.begin(), live.end(), random);
+
+		for (auto& allocation : live) {
+			fa.deallocate(allocation.first);
+		}
+
+		REQUIRE(fa.getUsedMemory() == 0);
+		REQUIRE(fa.getNumFreeBlocks() == 1);
+	}
+
+	std::free(memory);
+}
+
+} // namespace simple
@@ -0,0 +1,174 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#include "Allocator/HandlePool.h"
+
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace simple {
+
+TEST_CASE("HandlePoolAllocator", "[HandlePoolAllocator]") {
+	struct A {
+		A() = default;
+		A(float x, float y, float z, float w) : array { x, y, z, w } {}
+
+		float array[4];
+	};
+
+	const size_t numObjects = 2;
+
+	HandlePoolAllocator<A> pa(numObjects);
+
+	using Handle = HandlePoolAllocator<A>::Handle;
+
+	REQUIRE(sizeof(Handle) == sizeof(uint32_t));
+
+	SECTION("create") {
+		REQUIRE(pa.getNumTotalObjects() == 2);
+		REQUIRE(pa.getNumFreeObjects() == 2);
+
+		Handle h0 = pa.create(0.1f, 0.2f, 0.3f, 0.4f);
+		REQUIRE(!h0.isNull());
+		REQUIRE(pa.isValid(h0));
+
+		REQUIRE(pa.getNumFreeObjects() == 1);
+
+		A* a0 = pa.get(h0);
+		REQUIRE(a0 != nullptr);
+		REQUIRE(a0->array[0] == 0.1f);
+		REQUIRE(a0->array[3] == 0.4f);
+
+		Handle h1 = pa.create(1.1f, 1.2f, 1.3f, 1.4f);
+		REQUIRE(h1 != h0);
+		REQUIRE(pa.getNumFreeObjects() == 0);
+
+		A* a1 = pa.get(h1);
+		REQUIRE(a1 != nullptr);
+		REQUIRE(a1->array[0] == 1.1f);
+		REQUIRE(a1->array[3] == 1.4f);
+
+		pa.remove(h0);
+
+		REQUIRE(pa.getNumFreeObjects() == 1);
+		REQUIRE(!pa.isValid(h0));
+		REQUIRE(pa.get(h0) == nullptr);
+		REQUIRE(pa.isValid(h1));
+
+		Handle h2 = pa.create(2.1f, 2.2f, 2.3f, 2.4f);
+
+		// The slot is reused, the generation is not.
+		REQUIRE(h2.getIndex() == h0.getIndex());
+		REQUIRE(h2.getGeneration() == h0.getGeneration() + 1);
+		REQUIRE(pa.get(h0) == nullptr);
+		REQUIRE(pa.get(h2)->array[0] == 2.1f);
+
+		pa.remove(h1);
+		pa.remove(h2);
+
+		REQUIRE(pa.getNumFreeObjects() == 2);
+		REQUIRE(!pa.isValid(h1));
+		REQUIRE(!pa.isValid(h2));
+	}
+
+	SECTION("createNoConstruct") {
+		Handle h0 = pa.createNoConstruct();
+		A* a0 = pa.get(h0);
+		REQUIRE(a0 != nullptr);
+
+		a0->array[0] = 5.0f;
+		REQUIRE(pa.get(h0)->array[0] == 5.0f);
+
+		pa.removeNoDestruct(h0);
+
+		REQUIRE(pa.getNumFreeObjects() == 2);
+		REQUIRE(pa.get(h0) == nullptr);
+	}
+
+	SECTION("null") {
+		Handle h;
+		REQUIRE(h.isNull());
+		REQUIRE(!pa.isValid(h));
+		REQUIRE(pa.get(h) == nullptr);
+	}
+
+	SECTION("clean") {
+		Handle h0 = pa.create(0.1f, 0.2f, 0.3f, 0.4f);
+		Handle h1 = pa.create(1.1f, 1.2f, 1.3f, 1.4f);
+
+		pa.clean();
+
+		REQUIRE(pa.getNumFreeObjects() == 2);
+		REQUIRE(!pa.isValid(h0));
+		REQUIRE(!pa.isValid(h1));
+
+		Handle h2 = pa.create(2.1f, 2.2f, 2.3f, 2.4f);
+		REQUIRE(pa.isValid(h2));
+		REQUIRE(!pa.isValid(h0));
+		REQUIRE(!pa.isValid(h1));
+
+		pa.remove(h2);
+	}
+
+	SECTION("generation wraps") {
+		HandlePoolAllocator<A, 30> small(1);
+
+		auto first = small.create();
+		small.remove(first);
+
+		for (uint32_t i = 0; i < HandlePoolAllocator<A, 30>::GenerationMask; ++i) {
+			small.remove(small.create());
+		}
+
+		auto wrapped = small.create();
+		REQUIRE(wrapped.getGeneration() == 0);
+		REQUIRE(small.isValid(wrapped));
+
+		small.remove(wrapped);
+	}
+}
+
+TEST_CASE("HandlePoolAllocator compact", "[HandlePoolAllocator]") {
+	struct A {
+		A() = default;
+		A(uint64_t x) : value(x) {}
+
+		uint64_t value;
+	};
+
+	const size_t numObjects = 100;
+
+	HandlePoolAllocator<A> pa(numObjects);
+
+	using Handle = HandlePoolAllocator<A>::Handle;
+
+	std::vector<Handle> handles;
+
+	for (uint64_t i = 0; i < numObjects; ++i) {
+		handles.push_back(pa.create(i));
+	}
+
+	A* last = pa.get(handles.back());
+
+	for (uint64_t i = 0; i < numObjects; i += 2) {
+		pa.remove(handles[i]);
+	}
+
+	REQUIRE(pa.compact());
+
+	REQUIRE(pa.get(handles.back()) != last);
+
+	for (uint64_t i = 0; i < numObjects; ++i) {
+		if (i % 2 == 0) {
+			REQUIRE(pa.get(handles[i]) == nullptr);
+		} else {
+			REQUIRE(pa.get(handles[i])->value == i);
+		}
+	}
+
+	Handle h = pa.create(1000);
+	REQUIRE(pa.get(h)->value == 1000);
+}
+
+} // namespace simple
@@ -0,0 +1,142 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#include "Allocator/JobSystem.h"
+
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <cstdint>
+
+namespace simple {
+
+namespace {
+
+uint64_t sum(JobSystem& system, uint32_t begin, uint32_t end, std::atomic<uint32_t>& numErrors) {
+	if (end - begin <= 64) {
+		// Scratch of the worker this runs on, released once the job returns.
+		uint32_t* values = system.getScratch().createArrayNoConstruct<uint32_t>(end - begin);
+
+		for (uint32_t i = begin; i < end; ++i) { values[i - begin] = i; }
+
+		uint64_t result = 0;
+
+		for (uint32_t i = begin; i < end; ++i) {
+			if (values[i - begin] != i) { numErrors.fetch_add(1); }
+			result += values[i - begin];
+		}
+
+		return result;
+	}
+
+	uint32_t middle = begin + (end - begin) / 2;
+
+	uint64_t left  = 0;
+	uint64_t right = 0;
+
+	JobCounter counter(0);
+
+	system.spawn(counter, [&, begin, middle](JobContext& context) {
+		left = sum(context.getSystem(), begin, middle, numErrors);
+	});
+
+	system.spawn(counter, [&, middle, end](JobContext& context) {
+		right = sum(context.getSystem(), middle, end, numErrors);
+	});
+
+	system.wait(counter);
+
+	return left + right;
+}
+
+} // namespace
+
+TEST_CASE("JobSystem", "[JobSystem]") {
+	SECTION("scratch scope") {
+		const uint32_t size = 1024;
+		void* memory = std::malloc(size);
+
+		LinearAllocator la(memory, size);
+
+		{
+			ScratchScope outer(la);
+
+			la.create<uint64_t>(1);
+			uintptr_t position = la.getCurrentPosition();
+
+			{
+				ScratchScope inner(la);
+
+				la.createArray<uint64_t>(8, 2);
+				REQUIRE(la.getCurrentPosition() > position);
+			}
+
+			REQUIRE(la.getCurrentPosition() == position);
+			REQUIRE(la.getUsedMemory() == 8);
+		}
+
+		REQUIRE(la.getUsedMemory() == 0);
+		REQUIRE(la.getNumAllocations() == 0);
+
+		std::free(memory);
+	}
+
+	SECTION("spawn") {
+		JobSystem system(4, 1 << 20);
+
+		REQUIRE(system.getNumWorkers() == 4);
+		REQUIRE(system.getWorker() == 0);
+
+		const uint32_t numJobs = 10000;
+
+		std::atomic<uint32_t> numRun(0);
+		std::atomic<uint32_t> numErrors(0);
+
+		JobCounter counter(0);
+
+		{
+			ScratchScope scope(system.getScratch());
+
+			for (uint32_t i = 0; i < numJobs; ++i) {
+				system.spawn(counter, [&](JobContext& context) {
+					if (context.getWorker() != context.getSystem().getWorker()) { numErrors.fetch_add(1); }
+
+					// Every job starts on a clean arena above whatever its worker was doing.
+					auto* value = context.getScratch().create<uint64_t>(uint64_t(numRun.fetch_add(1)));
+					if (!value) { numErrors.fetch_add(1); }
+				});
+			}
+
+			system.wait(counter);
+		}
+
+		REQUIRE(counter.load() == 0);
+		REQUIRE(numRun.load() == numJobs);
+		REQUIRE(numErrors.load() == 0);
+		REQUIRE(system.getScratch().getUsedMemory() == 0);
+	}
+
+	SECTION("nested") {
+		JobSystem system(3, 1 << 16);
+
+		const uint32_t numValues = 1 << 16;
+
+		std::atomic<uint32_t> numErrors(0);
+		uint64_t result = 0;
+
+		JobCounter counter(0);
+
+		system.spawn(counter, [&](JobContext& context) {
+			result = sum(context.getSystem(), 0, numValues, numErrors);
+		});
+
+		system.wait(counter);
+
+		REQUIRE(numErrors.load() == 0);
+		REQUIRE(result == uint64_t(numValues) * (numValues - 1) / 2);
+
+		// The root closure is the only thing left in the arena of worker 0.
+		system.getScratch().clean();
+	}
+}
+
+} // namespace simple
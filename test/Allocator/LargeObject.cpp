@@ -0,0 +1,223 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#include "Allocator/LargeObject.h"
+#include "Allocator/Linear.h"
+#include "Allocator/Stack.h"
+
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+namespace simple {
+
+TEST_CASE("LargeObjectAllocator", "[LargeObjectAllocator]") {
+	struct A {
+		A() = default;
+		A(float x, float y, float z, float w) : array { x, y, z, w } {}
+
+		float array[4];
+	};
+
+	const size_t pageSize = LargeObjectAllocator::getPageSize();
+
+	SECTION("allocate") {
+		LargeObjectAllocator la;
+
+		auto* p = reinterpret_cast<uint8_t*>(la.allocate(3 << 20));
+
+		REQUIRE(reinterpret_cast<uintptr_t>(p) % pageSize == 0);
+		REQUIRE(la.getSize(p) == (3 << 20));
+		REQUIRE(la.getUsedMemory() == (3 << 20) + pageSize);
+		REQUIRE(la.getNumAllocations() == 1);
+
+		for (size_t i = 0; i < (3 << 20); i += pageSize) { p[i] = static_cast<uint8_t>(i / pageSize); }
+
+		// Growth remaps the pages, the contents come along.
+		p = reinterpret_cast<uint8_t*>(la.reallocate(p, 64 << 20));
+
+		REQUIRE(la.getSize(p) == (64 << 20));
+
+		for (size_t i = 0; i < (3 << 20); i += pageSize) { REQUIRE(p[i] == static_cast<uint8_t>(i / pageSize)); }
+
+		p[(64 << 20) - 1] = 1;
+
+		p = reinterpret_cast<uint8_t*>(la.reallocate(p, 1));
+
+		REQUIRE(la.getSize(p) == pageSize);
+		REQUIRE(p[0] == 0);
+
+		la.deallocate(p);
+
+		REQUIRE(la.getUsedMemory() == 0);
+		REQUIRE(la.getNumAllocations() == 0);
+	}
+
+	SECTION("createArray") {
+		LargeObjectAllocator la;
+
+		auto* a = la.createArray<A>(100000, 1.0f, 2.0f, 3.0f, 4.0f);
+		auto* b = la.createArrayNoConstruct<uint64_t>(1000);
+		auto* c = la.create<A>(5.0f, 6.0f, 7.0f, 8.0f);
+
+		REQUIRE(reinterpret_cast<uintptr_t>(a) % pageSize == 0);
+		REQUIRE(a[99999].array[3] == 4.0f);
+		REQUIRE(c->array[0] == 5.0f);
+
+		for (uint32_t i = 0; i < 1000; ++i) { b[i] = i; }
+
+		b = la.resizeArrayNoConstruct(b, 1000000);
+
+		for (uint32_t i = 0; i < 1000; ++i) { REQUIRE(b[i] == i); }
+
+		b[999999] = 1;
+
+		la.removeArray(a);
+		la.removeArrayNoDestruct(b);
+		la.remove(c);
+
+		REQUIRE(la.getNumAllocations() == 0);
+	}
+
+	SECTION("clean") {
+		LargeObjectAllocator la;
+
+		for (uint32_t i = 0; i < 10; ++i) { la.allocate(1 << 20); }
+
+		REQUIRE(la.getNumAllocations() == 10);
+
+		la.clean();
+
+		REQUIRE(la.getNumAllocations() == 0);
+		REQUIRE(la.getUsedMemory() == 0);
+	}
+
+	SECTION("overflow") {
+		const size_t size = 4096;
+		void* memory = std::malloc(size);
+
+		LargeObjectAllocator la;
+
+		LinearAllocator linear(memory, size);
+		linear.setOverflow(&la, 1024);
+
+		auto* small = linear.createArray<uint8_t>(100);
+		auto* big   = linear.createArray<uint8_t>(1 << 20);
+
+		REQUIRE(linear.getUsedMemory() < 200);
+		REQUIRE(la.getNumAllocations() == 1);
+
+		std::memset(small, 1, 100);
+		std::memset(big, 2, 1 << 20);
+
+		// A request that no longer fits overflows too.
+		for (uint32_t i = 0; i < 10; ++i) { linear.createArrayNoConstruct<uint8_t>(900); }
+
+		REQUIRE(la.getNumAllocations() == 7);
+
+		linear.clean();
+
+		REQUIRE(la.getNumAllocations() == 0);
+
+		StackAllocator stack(memory, size);
+		stack.setOverflow(&la, 1024);
+
+		auto* s0 = stack.createArray<uint8_t>(100);
+		auto* s1 = stack.createArray<uint8_t>(1 << 20);
+		auto* s2 = stack.createArray<uint8_t>(100);
+
+		REQUIRE(la.getNumAllocations() == 1);
+
+		// The overflow block may go first, the stack order holds for the rest.
+		stack.removeArray(s1);
+		stack.removeArray(s2);
+		stack.removeArray(s0);
+
+		REQUIRE(la.getNumAllocations() == 0);
+		REQUIRE(stack.getUsedMemory() == 0);
+
+		std::free(memory);
+	}
+
+	SECTION("shared overflow") {
+		const size_t size = 4096;
+		void* memory = std::malloc(2 * size);
+
+		LargeObjectAllocator la;
+
+		LinearAllocator linear(memory, size);
+		linear.setOverflow(&la, 1024);
+
+		StackAllocator stack(reinterpret_cast<uint8_t*>(memory) + size, size);
+		stack.setOverflow(&la, 1024);
+
+		auto* a0 = linear.createArray<uint8_t>(1 << 20);
+		auto* s0 = stack.createArray<uint8_t>(1 << 20, 3);
+		auto* a1 = linear.createArray<uint8_t>(1 << 20);
+		auto* s1 = stack.createArray<uint8_t>(1 << 20, 4);
+
+		REQUIRE(la.getNumAllocations() == 4);
+
+		std::memset(a0, 1, 1 << 20);
+		std::memset(a1, 2, 1 << 20);
+
+		// Only the blocks of the linear arena go, the stack keeps using its own.
+		linear.clean();
+
+		REQUIRE(la.getNumAllocations() == 2);
+		REQUIRE(s0[0] == 3);
+		REQUIRE(s0[(1 << 20) - 1] == 3);
+		REQUIRE(s1[(1 << 20) - 1] == 4);
+
+		auto* a2 = linear.createArray<uint8_t>(1 << 20, 5);
+
+		REQUIRE(la.getNumAllocations() == 3);
+
+		stack.removeArray(s1);
+		stack.clean();
+
+		REQUIRE(la.getNumAllocations() == 1);
+		REQUIRE(a2[(1 << 20) - 1] == 5);
+
+		linear.clean();
+
+		REQUIRE(la.getNumAllocations() == 0);
+		REQUIRE(la.getUsedMemory() == 0);
+
+		std::free(memory);
+	}
+
+	SECTION("destroy with overflow") {
+		const size_t size = 4096;
+		void* memory = std::malloc(size);
+
+		LargeObjectAllocator la;
+
+		void* own = la.allocate(1 << 20);
+
+		{
+			LinearAllocator linear(memory, size);
+			linear.setOverflow(&la, 1024);
+			linear.createArrayNoConstruct<uint8_t>(1 << 20);
+
+			StackAllocator stack(memory, size);
+			stack.setOverflow(&la, 1024);
+			stack.createArrayNoConstruct<uint8_t>(1 << 20);
+
+			REQUIRE(la.getNumAllocations() == 3);
+		}
+
+		// Both arenas took their blocks along, the one allocated directly is left.
+		REQUIRE(la.getNumAllocations() == 1);
+		REQUIRE(la.getSize(own) == 1 << 20);
+
+		la.clean();
+
+		REQUIRE(la.getNumAllocations() == 0);
+
+		std::free(memory);
+	}
+}
+
+} // namespace simple
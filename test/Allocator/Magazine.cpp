@@ -0,0 +1,93 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#include "Allocator/Magazine.h"
+#include "Allocator/Pool.h"
+#include "Allocator/Trimmer.h"
+
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+namespace simple {
+
+TEST_CASE("PoolMagazine", "[PoolMagazine]") {
+	struct A {
+		A() = default;
+		A(float x, float y, float z, float w) : array { x, y, z, w } {}
+
+		float array[4];
+	};
+
+	SECTION("create") {
+		PoolAllocator<A> pool(100);
+		PoolMagazine<A> magazine(pool, 8);
+
+		REQUIRE(magazine.getNumAvailable() == 8);
+		REQUIRE(pool.getNumFreeObjects() == 92);
+
+		A* objects[9];
+
+		for (uint32_t i = 0; i < 8; ++i) {
+			objects[i] = magazine.create(1.0f, 2.0f, 3.0f, float(i));
+			REQUIRE(objects[i]->array[3] == float(i));
+		}
+
+		// Dry until the housekeeping side refills.
+		REQUIRE(magazine.create() == nullptr);
+
+		for (uint32_t i = 0; i < 8; ++i) { REQUIRE(magazine.remove(objects[i])); }
+
+		REQUIRE(pool.getNumFreeObjects() == 92);
+		REQUIRE(magazine.service() == 16);
+		REQUIRE(pool.getNumFreeObjects() == 92);
+		REQUIRE(magazine.getNumAvailable() == 8);
+	}
+
+	SECTION("exhausted pool") {
+		PoolAllocator<A> pool(4);
+		PoolMagazine<A> magazine(pool, 8);
+
+		REQUIRE(magazine.getNumAvailable() == 4);
+		REQUIRE(pool.getNumFreeObjects() == 0);
+	}
+
+	SECTION("threads") {
+		PoolAllocator<A> pool(1024);
+
+		const uint32_t numRounds = 100000;
+
+		{
+			PoolMagazine<A> magazine(pool, 64);
+
+			BackgroundTrimmer housekeeping(std::chrono::milliseconds(1), [&] {
+				magazine.service();
+				return size_t(0);
+			});
+
+			// The realtime loop never blocks: it skips a round when the magazine is dry.
+			uint32_t numCreated = 0;
+
+			while (numCreated < numRounds) {
+				A* object = magazine.create(1.0f, 2.0f, 3.0f, 4.0f);
+
+				if (!object) {
+					std::this_thread::yield();
+					continue;
+				}
+
+				while (!magazine.remove(object)) { std::this_thread::yield(); }
+
+				++numCreated;
+			}
+
+			REQUIRE(numCreated == numRounds);
+		}
+
+		REQUIRE(pool.getNumFreeObjects() == 1024);
+	}
+}
+
+} // namespace simple
@@ -0,0 +1,98 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#include "Allocator/ObjectCache.h"
+
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace simple {
+
+TEST_CASE("ObjectCache", "[ObjectCache]") {
+	struct Counters {
+		uint32_t mNumConstructed = 0;
+		uint32_t mNumDestroyed   = 0;
+		uint32_t mNumReset       = 0;
+	};
+
+	struct Parser {
+		Parser(Counters& counters) : mCounters(counters), mBuffer(256, 0) { ++mCounters.mNumConstructed; }
+		~Parser() { ++mCounters.mNumDestroyed; }
+
+		Counters& mCounters;
+		std::vector<uint8_t> mBuffer;
+		uint32_t mPosition = 0;
+	};
+
+	struct ResetParser {
+		void operator()(Parser& parser) const {
+			parser.mPosition = 0;
+			++parser.mCounters.mNumReset;
+		}
+	};
+
+	Counters counters;
+
+	SECTION("reuse") {
+		ObjectCache<Parser, ResetParser> cache(4);
+		REQUIRE(cache.getNumTotalObjects() == 4);
+
+		auto* p0 = cache.create(counters);
+		auto* p1 = cache.create(counters);
+
+		p0->mPosition = 10;
+
+		REQUIRE(counters.mNumConstructed == 2);
+		REQUIRE(cache.getNumFreeObjects() == 2);
+
+		cache.remove(p0);
+
+		REQUIRE(counters.mNumReset == 1);
+		REQUIRE(counters.mNumDestroyed == 0);
+		REQUIRE(cache.getNumCachedObjects() == 1);
+		REQUIRE(cache.getNumFreeObjects() == 3);
+
+		// Comes back constructed and reset, the buffer is still there.
+		auto* p2 = cache.create(counters);
+
+		REQUIRE(p2 == p0);
+		REQUIRE(p2->mPosition == 0);
+		REQUIRE(p2->mBuffer.size() == 256);
+		REQUIRE(counters.mNumConstructed == 2);
+
+		cache.remove(p1);
+		cache.remove(p2);
+
+		REQUIRE(cache.trim(1) == 1);
+		REQUIRE(counters.mNumDestroyed == 1);
+		REQUIRE(cache.getNumCachedObjects() == 1);
+	}
+
+	// The destructor trims whatever is left in the cache.
+	REQUIRE(counters.mNumConstructed == counters.mNumDestroyed);
+
+	SECTION("exhaust") {
+		ObjectCache<Parser> cache(3);
+
+		Parser* parsers[3];
+
+		for (auto& parser : parsers) { parser = cache.create(counters); }
+
+		REQUIRE(cache.getNumFreeObjects() == 0);
+
+		for (auto& parser : parsers) { cache.remove(parser); }
+
+		for (auto& parser : parsers) { parser = cache.create(counters); }
+
+		REQUIRE(counters.mNumConstructed == 3);
+		REQUIRE(cache.getNumCachedObjects() == 0);
+
+		for (auto& parser : parsers) { cache.remove(parser); }
+
+		REQUIRE(cache.trim() == 3);
+		REQUIRE(counters.mNumDestroyed == 3);
+	}
+}
+
+} // namespace simple
@@ -0,0 +1,149 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#include "Allocator/FreeList.h"
+#include "Allocator/PageMap.h"
+#include "Allocator/Pool.h"
+#include "Allocator/Slab.h"
+#include "Allocator/Tlsf.h"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace simple {
+
+TEST_CASE("PageMap", "[PageMap]") {
+	const size_t size = 256 * 1024;
+
+	void* memory0 = std::aligned_alloc(4096, size);
+	void* memory1 = std::aligned_alloc(4096, size);
+
+	SECTION("owns") {
+		PageMap map;
+
+		PageMap::Owner owner { nullptr, nullptr };
+
+		REQUIRE(!map.owns(memory0));
+
+		map.insert(memory0, size, &owner);
+
+		REQUIRE(map.owns(memory0));
+		REQUIRE(map.owns(reinterpret_cast<uint8_t*>(memory0) + size - 1));
+		REQUIRE(map.lookup(reinterpret_cast<uint8_t*>(memory0) + size / 2) == &owner);
+		REQUIRE(!map.owns(memory1));
+		REQUIRE(!map.owns(reinterpret_cast<void*>(uintptr_t(1) << 50)));
+
+		map.erase(memory0, size);
+
+		REQUIRE(!map.owns(memory0));
+		REQUIRE(!map.owns(reinterpret_cast<uint8_t*>(memory0) + size - 1));
+	}
+
+	SECTION("free") {
+		FreeListAllocator freeList(memory0, size);
+		TlsfAllocator tlsf(memory1, size);
+
+		PageMap::Owner freeListOwner { &freeList, [](void* allocator, void* pointer) {
+			reinterpret_cast<FreeListAllocator*>(allocator)->deallocate(pointer);
+		} };
+
+		PageMap::Owner tlsfOwner { &tlsf, [](void* allocator, void* pointer) {
+			reinterpret_cast<TlsfAllocator*>(allocator)->deallocate(pointer);
+		} };
+
+		PageMap& map = getPageMap();
+
+		map.insert(memory0, size, &freeListOwner);
+		map.insert(memory1, size, &tlsfOwner);
+
+		std::mt19937 random(17);
+		std::vector<void*> pointers;
+
+		for (uint32_t i = 0; i < 1000; ++i) {
+			uint32_t length = 8 + random() % 100;
+			pointers.push_back(random() % 2 ? freeList.allocate(length, 8) : tlsf.allocate(length, 8));
+		}
+
+		std::shuffle(pointers.begin(), pointers.end(), random);
+
+		// Lookups from other threads need no lock.
+		uint32_t numMissing = 0;
+
+		std::thread reader([&] {
+			for (void* pointer : pointers) {
+				if (!map.owns(pointer)) { ++numMissing; }
+			}
+		});
+
+		reader.join();
+
+		REQUIRE(numMissing == 0);
+
+		for (void* pointer : pointers) { map.free(pointer); }
+
+		REQUIRE(freeList.getNumAllocations() == 0);
+		REQUIRE(tlsf.getNumAllocations() == 0);
+
+		map.erase(memory0, size);
+		map.erase(memory1, size);
+	}
+
+	SECTION("registered") {
+		struct A {
+			uint64_t array[4];
+		};
+
+		PageMap map;
+
+		std::vector<void*> pointers;
+
+		{
+			PoolAllocator<A> pool(2000, &map);
+			SlabAllocator slab(sizeof(A), alignof(A), &map);
+
+			std::mt19937 random(23);
+
+			for (uint32_t i = 0; i < 5000; ++i) {
+				pointers.push_back(random() % 4 ? slab.allocate() : pool.createNoConstruct());
+			}
+
+			REQUIRE(slab.getNumSlabs() > 1);
+			REQUIRE(pool.getNumFreeObjects() < 2000);
+
+			uint32_t numMissing = 0;
+
+			for (void* pointer : pointers) {
+				if (!map.owns(pointer)) { ++numMissing; }
+			}
+
+			REQUIRE(numMissing == 0);
+			REQUIRE(!map.owns(memory0));
+
+			std::shuffle(pointers.begin(), pointers.end(), random);
+
+			for (void* pointer : pointers) { map.free(pointer); }
+
+			REQUIRE(pool.getNumFreeObjects() == 2000);
+			REQUIRE(slab.getNumAllocations() == 0);
+		}
+
+		// Both took their pages out of the map again.
+		uint32_t numStale = 0;
+
+		for (void* pointer : pointers) {
+			if (map.owns(pointer)) { ++numStale; }
+		}
+
+		REQUIRE(numStale == 0);
+	}
+
+	std::free(memory1);
+	std::free(memory0);
+}
+
+} // namespace simple
@@ -0,0 +1,122 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#include "Allocator/PerCpu.h"
+
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace simple {
+
+TEST_CASE("PerCpuPoolAllocator", "[PerCpuPoolAllocator]") {
+	struct B {
+		B() = default;
+		B(uint64_t x, uint64_t y, uint64_t z) : array { x, y, z } {}
+
+		uint64_t array[3];
+	};
+
+	using Allocator = PerCpuPoolAllocator<B>;
+
+	auto mode = GENERATE(Allocator::CacheMode::PerCpu, Allocator::CacheMode::ThreadLocal);
+
+	SECTION("create") {
+		Allocator pa(1000, mode);
+		REQUIRE(pa.getNumTotalObjects() == 1000);
+
+		if (mode == Allocator::CacheMode::ThreadLocal || !allocator::isRseqAvailable()) {
+			REQUIRE(pa.getCacheMode() == Allocator::CacheMode::ThreadLocal);
+		} else {
+			REQUIRE(pa.getCacheMode() == Allocator::CacheMode::PerCpu);
+		}
+
+		auto* b0 = pa.create(10, 20, 30);
+		auto* b1 = pa.create(40, 50, 60);
+
+		// The first miss takes a whole batch from the pool.
+		REQUIRE(pa.getNumFreeObjects() == 1000 - Allocator::BatchSize);
+
+		REQUIRE(b0->array[2] == 30);
+		REQUIRE(b1->array[0] == 40);
+
+		pa.remove(b0);
+		pa.remove(b1);
+
+		// Freed slots stay cached and come back first.
+		REQUIRE(pa.create(1, 2, 3) == b1);
+
+		pa.flush();
+		REQUIRE(pa.getNumFreeObjects() == 999);
+
+		pa.remove(b1);
+		pa.flush();
+
+		REQUIRE(pa.getNumFreeObjects() == 1000);
+	}
+
+	SECTION("overflow") {
+		Allocator pa(1000, mode);
+
+		std::vector<B*> objects;
+
+		for (uint32_t i = 0; i < 1000; ++i) { objects.push_back(pa.create(i, i, i)); }
+
+		REQUIRE(pa.getNumFreeObjects() == 0);
+
+		// Full caches spill back to the pool in batches.
+		for (B* object : objects) { pa.remove(object); }
+
+		REQUIRE(pa.getNumFreeObjects() >= 1000 - allocator::CpuCacheCapacity);
+
+		pa.flush();
+
+		REQUIRE(pa.getNumFreeObjects() == 1000);
+	}
+
+	SECTION("threads") {
+		Allocator pa(64 * 1024, mode);
+
+		const uint32_t numThreads = 8;
+
+		std::atomic<uint32_t> numMismatches(0);
+		std::vector<std::thread> threads;
+
+		for (uint32_t t = 0; t < numThreads; ++t) {
+			threads.emplace_back([&, t] {
+				std::mt19937 random(t);
+				std::vector<B*> live;
+
+				for (uint32_t i = 0; i < 50000; ++i) {
+					if (live.size() < 1000 && (live.empty() || random() % 2 == 0)) {
+						live.push_back(pa.create(t, i, t));
+					} else {
+						size_t index = random() % live.size();
+						B* object = live[index];
+
+						if (object->array[0] != t || object->array[2] != t) { ++numMismatches; }
+
+						pa.remove(object);
+						live[index] = live.back();
+						live.pop_back();
+					}
+				}
+
+				for (B* object : live) { pa.remove(object); }
+			});
+		}
+
+		for (auto& thread : threads) { thread.join(); }
+
+		REQUIRE(numMismatches == 0);
+
+		pa.flush();
+
+		REQUIRE(pa.getNumFreeObjects() == 64 * 1024);
+	}
+}
+
+} // namespace simple
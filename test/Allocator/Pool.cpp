@@ -4,7 +4,15 @@
 
 #include <catch2/catch.hpp>
 
+#include <algorithm>
+#include <chrono>
 #include <cstdint>
+#include <map>
+#include <random>
+#include <vector>
+
+#include <sys/mman.h>
+#include <unistd.h>
 
 namespace simple {
 
@@ -295,4 +303,519 @@ TEST_CASE("PoolAllocator", "[PoolAllocator]") {
 	}
 }
 
+TEST_CASE("PoolAllocator forEachLive", "[PoolAllocator]") {
+	struct A {
+		A() = default;
+		A(uint64_t x) : value(x) {}
+
+		uint64_t value;
+	};
+
+	const size_t numObjects = 200;
+
+	PoolAllocator<A, PoolFlagOccupancy> pa(numObjects);
+
+	std::vector<A*> objects;
+
+	for (uint64_t i = 0; i < numObjects; ++i) {
+		objects.push_back(pa.create(i));
+	}
+
+	SECTION("all") {
+		uint64_t count = 0;
+		pa.forEachLive([&](A& a) { REQUIRE(a.value == count++); });
+		REQUIRE(count == numObjects);
+	}
+
+	SECTION("sparse") {
+		for (uint64_t i = 0; i < numObjects; ++i) {
+			if (i % 7 != 0) { pa.remove(objects[i]); }
+		}
+
+		REQUIRE(pa.getNumFreeObjects() == numObjects - 29);
+
+		std::vector<uint64_t> visited;
+		A* previous = nullptr;
+
+		pa.forEachLive([&](A& a) {
+			REQUIRE(previous < &a);
+			previous = &a;
+			visited.push_back(a.value);
+		});
+
+		REQUIRE(visited.size() == 29);
+
+		for (size_t i = 0; i < visited.size(); ++i) {
+			REQUIRE(visited[i] == i * 7);
+		}
+
+		A* reused = pa.create(1000);
+
+		uint32_t count = 0;
+		bool found = false;
+		pa.forEachLive([&](A& a) { ++count; found |= &a == reused; });
+
+		REQUIRE(count == 30);
+		REQUIRE(found);
+	}
+
+	SECTION("empty") {
+		pa.clean();
+
+		uint32_t count = 0;
+		pa.forEachLive([&](A&) { ++count; });
+		REQUIRE(count == 0);
+	}
+}
+
+TEST_CASE("PoolAllocator compact", "[PoolAllocator]") {
+	struct A {
+		A() = default;
+		A(uint64_t x) : value(x) {}
+
+		uint64_t value;
+	};
+
+	const size_t numObjects = 300;
+
+	PoolAllocator<A, PoolFlagOccupancy> pa(numObjects);
+
+	std::vector<A*> objects;
+
+	for (uint64_t i = 0; i < numObjects; ++i) {
+		objects.push_back(pa.create(i));
+	}
+
+	for (uint64_t i = 0; i < numObjects; ++i) {
+		if (i % 3 != 0) { pa.remove(objects[i]); }
+	}
+
+	const uint32_t numLive = numObjects / 3;
+
+	SECTION("compact") {
+		std::map<A*, A*> forwarding;
+
+		REQUIRE(pa.compact([&](A* from, A* to) { forwarding[from] = to; }));
+
+		for (uint64_t i = 0; i < numObjects; i += 3) {
+			auto it = forwarding.find(objects[i]);
+			A* object = it == forwarding.end() ? objects[i] : it->second;
+
+			REQUIRE(object->value == i);
+			REQUIRE(pa.getIndex(object) < numLive);
+		}
+
+		uint32_t count = 0;
+		pa.forEachLive([&](A& a) { REQUIRE(pa.getIndex(&a) == count++); });
+		REQUIRE(count == numLive);
+
+		REQUIRE(pa.compact([&](A*, A*) { FAIL("nothing to move"); }));
+
+		// The free list is usable and hands out the slots right after the live range.
+		REQUIRE(pa.getNumFreeObjects() == numObjects - numLive);
+
+		A* next = pa.create(1000);
+		REQUIRE(pa.getIndex(next) == numLive);
+	}
+
+	SECTION("compactRelocate") {
+		uint32_t numMoves = 0;
+
+		REQUIRE(pa.compactRelocate([&](A* from, A* to) {
+			to->value = from->value;
+			++numMoves;
+		}));
+
+		REQUIRE(numMoves > 0);
+
+		uint64_t sum = 0;
+		pa.forEachLive([&](A& a) { sum += a.value; });
+		REQUIRE(sum == 3 * (numLive - 1) * numLive / 2);
+	}
+
+	SECTION("budget") {
+		uint32_t numCalls = 0;
+
+		while (!pa.compact([](A*, A*) {}, std::chrono::nanoseconds(0))) {
+			++numCalls;
+		}
+
+		REQUIRE(numCalls > 0);
+
+		uint32_t count = 0;
+		pa.forEachLive([&](A& a) { REQUIRE(pa.getIndex(&a) == count++); });
+		REQUIRE(count == numLive);
+	}
+}
+
+TEST_CASE("PoolAllocator batch", "[PoolAllocator]") {
+	struct A {
+		A() = default;
+		A(uint64_t x) : value(x) {}
+
+		uint64_t value;
+	};
+
+	const size_t numObjects = 64;
+
+	PoolAllocator<A, PoolFlagOccupancy> pa(numObjects);
+
+	A* objects[numObjects];
+
+	SECTION("createBatch") {
+		pa.createBatch(16, objects, 7);
+
+		REQUIRE(pa.getNumFreeObjects() == numObjects - 16);
+
+		// A fresh pool serves batches from the contiguous tail.
+		for (uint32_t i = 0; i < 16; ++i) {
+			REQUIRE(objects[i]->value == 7);
+			REQUIRE(pa.getIndex(objects[i]) == i);
+		}
+
+		pa.removeBatch(objects + 4, 8);
+
+		REQUIRE(pa.getNumFreeObjects() == numObjects - 8);
+
+		uint32_t count = 0;
+		pa.forEachLive([&](A&) { ++count; });
+		REQUIRE(count == 8);
+
+		// Eight slots come back from the free list, the rest from the tail.
+		A* more[12];
+		pa.createBatch(12, more, 9);
+
+		REQUIRE(pa.getNumFreeObjects() == numObjects - 20);
+
+		for (uint32_t i = 0; i < 8; ++i) {
+			REQUIRE(pa.getIndex(more[i]) >= 4);
+			REQUIRE(pa.getIndex(more[i]) < 12);
+		}
+
+		for (uint32_t i = 8; i < 12; ++i) {
+			REQUIRE(pa.getIndex(more[i]) == 16 + i - 8);
+		}
+
+		pa.removeBatch(more, 12);
+		pa.removeBatch(objects, 4);
+		pa.removeBatch(objects + 12, 4);
+
+		REQUIRE(pa.getNumFreeObjects() == numObjects);
+	}
+
+	SECTION("mixed") {
+		pa.createBatchNoConstruct(numObjects, objects);
+		REQUIRE(pa.getNumFreeObjects() == 0);
+
+		for (uint32_t i = 0; i < numObjects; i += 2) {
+			pa.removeNoDestruct(objects[i]);
+		}
+
+		A* more[numObjects / 2];
+		pa.createBatchNoConstruct(numObjects / 2, more);
+		REQUIRE(pa.getNumFreeObjects() == 0);
+
+		pa.removeBatchNoDestruct(more, numObjects / 2);
+
+		for (uint32_t i = 1; i < numObjects; i += 2) {
+			pa.remove(objects[i]);
+		}
+
+		REQUIRE(pa.getNumFreeObjects() == numObjects);
+	}
+}
+
+TEST_CASE("PoolAllocator trim", "[PoolAllocator]") {
+	struct A {
+		A() = default;
+		A(uint64_t x) : value(x) {}
+
+		uint64_t value;
+		uint64_t padding[7];
+	};
+
+	const size_t pageSize   = sysconf(_SC_PAGESIZE);
+	const size_t numObjects = 64 * pageSize / sizeof(A);
+
+	PoolAllocator<A, PoolFlagOccupancy> pa(numObjects);
+
+	std::vector<A*> objects;
+
+	for (uint64_t i = 0; i < numObjects; ++i) {
+		objects.push_back(pa.create(i));
+	}
+
+	auto isResident = [&](const void* pointer) {
+		auto address = reinterpret_cast<uintptr_t>(pointer) & ~(pageSize - 1);
+		unsigned char vector = 0;
+		mincore(reinterpret_cast<void*>(address), pageSize, &vector);
+		return (vector & 1) != 0;
+	};
+
+	SECTION("nothing free") {
+		REQUIRE(pa.trim() == 0);
+	}
+
+	SECTION("trim") {
+		// Keep one object in every eighth page.
+		const size_t perPage = pageSize / sizeof(A);
+
+		for (uint64_t i = 0; i < numObjects; ++i) {
+			if (i % (8 * perPage) != 0) { pa.remove(objects[i]); }
+		}
+
+		uint32_t numLive = numObjects - pa.getNumFreeObjects();
+
+		size_t released = pa.trim();
+		REQUIRE(released >= 48 * pageSize);
+		REQUIRE(pa.trim() == 0);
+
+		REQUIRE(!isResident(objects[4 * perPage]));
+
+		pa.sortFreeList();
+		REQUIRE(!isResident(objects[4 * perPage]));
+
+		for (uint64_t i = 0; i < numObjects; i += 8 * perPage) {
+			REQUIRE(objects[i]->value == i);
+		}
+
+		// Released slots are reused once the free list runs dry.
+		std::vector<A*> more;
+		while (pa.getNumFreeObjects() > 0) {
+			more.push_back(pa.create(1000 + more.size()));
+		}
+
+		REQUIRE(more.size() == numObjects - numLive);
+
+		for (size_t i = 0; i < more.size(); ++i) {
+			REQUIRE(more[i]->value == 1000 + i);
+		}
+
+		uint32_t count = 0;
+		pa.forEachLive([&](A&) { ++count; });
+		REQUIRE(count == numObjects);
+
+		for (auto* object : more) {
+			pa.remove(object);
+		}
+
+		REQUIRE(pa.trim(true) > 0);
+	}
+
+	SECTION("trim, free, sortFreeList") {
+		const size_t middle = numObjects / 2;
+
+		for (uint64_t i = 1; i < numObjects - 1; ++i) {
+			if (i != middle) { pa.remove(objects[i]); }
+		}
+
+		REQUIRE(pa.trim() > 0);
+
+		// Freed after trim, above what will be the last live slot and between the released runs.
+		pa.remove(objects[middle]);
+		pa.remove(objects[numObjects - 1]);
+
+		pa.sortFreeList();
+
+		REQUIRE(pa.getNumFreeObjects() == numObjects - 1);
+
+		std::vector<A*> more;
+		while (pa.getNumFreeObjects() > 0) {
+			more.push_back(pa.create(0));
+		}
+
+		uint32_t count = 0;
+		pa.forEachLive([&](A&) { ++count; });
+		REQUIRE(count == numObjects);
+	}
+
+	SECTION("trim, refill, sortFreeList") {
+		const size_t perPage = pageSize / sizeof(A);
+
+		for (uint64_t i = 1; i < numObjects - 1; ++i) {
+			pa.remove(objects[i]);
+		}
+
+		REQUIRE(pa.trim() > 0);
+
+		// The free list is empty, the released run becomes the carve range.
+		A* first = pa.create(0);
+		REQUIRE(first == objects[1]);
+
+		pa.sortFreeList();
+
+		// The rest of the run was not linked, so its pages stay released.
+		REQUIRE(!isResident(objects[numObjects / 2]));
+		REQUIRE(!isResident(objects[numObjects - 2 * perPage]));
+
+		std::vector<A*> more;
+		while (pa.getNumFreeObjects() > 0) {
+			more.push_back(pa.create(0));
+		}
+
+		REQUIRE(more.size() == numObjects - 3);
+
+		uint32_t count = 0;
+		pa.forEachLive([&](A&) { ++count; });
+		REQUIRE(count == numObjects);
+	}
+
+	SECTION("PoolFlagAddressOrdered") {
+		PoolAllocator<A, PoolFlagOccupancy | PoolFlagAddressOrdered> ordered(numObjects);
+
+		std::vector<A*> all;
+		while (ordered.getNumFreeObjects() > 0) {
+			all.push_back(ordered.create(0));
+		}
+
+		for (uint64_t i = 1; i < numObjects; ++i) {
+			ordered.remove(all[i]);
+		}
+
+		size_t released = ordered.trim();
+		REQUIRE(released >= (numObjects - 1) * sizeof(A) - 2 * pageSize);
+
+		// Refilling faults the pages back in, so the next trim releases them again.
+		for (uint64_t i = 1; i < numObjects; ++i) {
+			REQUIRE(ordered.create(i) == all[i]);
+		}
+
+		for (uint64_t i = 1; i < numObjects; ++i) {
+			ordered.remove(all[i]);
+		}
+
+		REQUIRE(ordered.trim() == released);
+
+		ordered.remove(all[0]);
+	}
+
+	SECTION("compact then trim") {
+		for (uint64_t i = 0; i < numObjects; i += 2) {
+			pa.remove(objects[i]);
+		}
+
+		REQUIRE(pa.compact([](A*, A*) {}));
+		REQUIRE(pa.trim() >= (numObjects / 2) * sizeof(A) - pageSize);
+
+		uint32_t count = 0;
+		pa.forEachLive([&](A& a) { REQUIRE(a.value % 2 == 1); ++count; });
+		REQUIRE(count == numObjects / 2);
+	}
+
+	SECTION("trim then compact") {
+		// Only the top two pages stay live.
+		const size_t perPage = pageSize / sizeof(A);
+		const size_t numLive = 2 * perPage;
+
+		for (uint64_t i = 0; i < numObjects - numLive; ++i) {
+			pa.remove(objects[i]);
+		}
+
+		REQUIRE(pa.trim() >= (numObjects - numLive) * sizeof(A) - pageSize);
+
+		uint32_t numCalls = 0;
+
+		while (!pa.compact([](A*, A*) {}, std::chrono::nanoseconds(0))) {
+			++numCalls;
+		}
+
+		REQUIRE(numCalls > 0);
+
+		uint64_t sum = 0;
+		pa.forEachLive([&](A& a) { REQUIRE(pa.getIndex(&a) < numLive); sum += a.value; });
+		REQUIRE(sum == numLive * (2 * numObjects - numLive - 1) / 2);
+
+		// Only the pages the moves went to were faulted back in.
+		REQUIRE(isResident(objects[0]));
+		REQUIRE(!isResident(objects[numObjects / 2]));
+
+		std::vector<A*> more;
+		while (pa.getNumFreeObjects() > 0) {
+			more.push_back(pa.create(0));
+		}
+
+		REQUIRE(more.size() == numObjects - numLive);
+
+		uint32_t count = 0;
+		pa.forEachLive([&](A&) { ++count; });
+		REQUIRE(count == numObjects);
+	}
+}
+
+TEST_CASE("PoolAllocator address order", "[PoolAllocator]") {
+	struct A {
+		A() = default;
+		A(uint64_t x) : value(x) {}
+
+		uint64_t value;
+	};
+
+	const size_t numObjects = 500;
+
+	SECTION("sortFreeList") {
+		PoolAllocator<A, PoolFlagOccupancy> pa(numObjects);
+
+		std::vector<A*> objects;
+
+		for (uint64_t i = 0; i < numObjects; ++i) {
+			objects.push_back(pa.create(i));
+		}
+
+		std::shuffle(objects.begin(), objects.end(), std::mt19937(7));
+
+		for (size_t i = 0; i < objects.size(); ++i) {
+			if (objects[i]->value % 5 != 0) { pa.remove(objects[i]); }
+		}
+
+		pa.sortFreeList();
+
+		A* previous = nullptr;
+
+		for (uint32_t i = 0; i < numObjects - numObjects / 5; ++i) {
+			A* object = pa.create(i);
+			REQUIRE(previous < object);
+			REQUIRE(object->value == i);
+			previous = object;
+		}
+
+		REQUIRE(pa.getNumFreeObjects() == 0);
+
+		uint64_t count = 0;
+		pa.forEachLive([&](A&) { ++count; });
+		REQUIRE(count == numObjects);
+	}
+
+	SECTION("PoolFlagAddressOrdered") {
+		PoolAllocator<A, PoolFlagOccupancy | PoolFlagAddressOrdered> pa(numObjects);
+
+		std::vector<A*> objects;
+
+		for (uint64_t i = 0; i < numObjects; ++i) {
+			objects.push_back(pa.create(i));
+			REQUIRE(pa.getIndex(objects.back()) == i);
+		}
+
+		for (uint64_t i = numObjects; i-- > 0;) {
+			if (i % 3 != 0) { pa.remove(objects[i]); }
+		}
+
+		for (uint64_t i = 1; i < numObjects; ++i) {
+			if (i % 3 == 0) { continue; }
+
+			A* object = pa.create(i);
+			REQUIRE(object == objects[i]);
+		}
+
+		REQUIRE(pa.getNumFreeObjects() == 0);
+
+		A* batch[16];
+		pa.removeBatch(objects.data() + 100, 16);
+		pa.createBatch(16, batch, 0);
+
+		for (uint32_t i = 0; i < 16; ++i) {
+			REQUIRE(batch[i] == objects[100 + i]);
+		}
+	}
+}
+
 } // namespace simple
@@ -0,0 +1,209 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#include "Allocator/Ring.h"
+
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace simple {
+
+TEST_CASE("RingAllocator", "[RingAllocator]") {
+	struct A {
+		A() = default;
+		A(float x, float y, float z, float w) : array { x, y, z, w } {}
+
+		float array[4];
+	};
+
+	struct B {
+		B() = default;
+		B(uint64_t x, uint64_t y, uint64_t z) : array { x, y, z } {}
+
+		uint64_t array[3];
+	};
+
+	const size_t size = 1024;
+	void* memory = std::aligned_alloc(64, size);
+
+	SECTION("create") {
+		RingAllocator<> ra(memory, size);
+		REQUIRE(ra.getSize() == size);
+
+		auto* a0 = ra.create<A>(1.1f, 1.2f, 1.3f, 1.4f);
+		auto* b0 = ra.create<B>(10, 20, 30);
+		auto* a1 = ra.create<A>(2.1f, 2.2f, 2.3f, 2.4f);
+
+		// record = 8, data = 16, 24
+		// sum    = 80 [8 + 16 + 8 + 24 + 8 + 16]
+		REQUIRE(ra.getUsedMemory() == 80);
+		REQUIRE(ra.getNumAllocations() == 3);
+
+		REQUIRE(a0->array[0] == 1.1f);
+		REQUIRE(b0->array[2] == 30);
+		REQUIRE(a1->array[3] == 2.4f);
+
+		ra.remove(a0);
+		ra.remove(b0);
+		ra.remove(a1);
+
+		REQUIRE(ra.getUsedMemory() == 0);
+		REQUIRE(ra.getNumAllocations() == 0);
+	}
+
+	SECTION("createArray") {
+		RingAllocator<> ra(memory, size);
+
+		auto* a = ra.createArray<A>(10, 1.0f, 2.0f, 3.0f, 4.0f);
+		auto* c = ra.createArrayNoConstruct<uint8_t>(33);
+
+		for (uint32_t i = 0; i < 10; ++i) {
+			REQUIRE(a[i].array[0] == 1.0f);
+			REQUIRE(a[i].array[3] == 4.0f);
+		}
+
+		std::memset(c, 0xFF, 33);
+
+		ra.removeArray(a);
+		ra.removeArrayNoDestruct(c);
+
+		REQUIRE(ra.getNumAllocations() == 0);
+		REQUIRE(ra.getUsedMemory() == 0);
+	}
+
+	SECTION("wrap") {
+		RingAllocator<> ra(memory, size);
+
+		auto* start = reinterpret_cast<uint8_t*>(memory);
+
+		void* p0 = ra.allocate(400, 8);
+		void* p1 = ra.allocate(400, 8);
+
+		REQUIRE(p0 == start + 8);
+		REQUIRE(p1 == start + 416);
+
+		// 208 bytes are left before the end, not enough for the record.
+		REQUIRE(ra.allocate(300, 8) == nullptr);
+
+		ra.free(p0);
+
+		void* p2 = ra.allocate(300, 8);
+		REQUIRE(p2 == start + 8);
+
+		// The skipped tail counts as used until the consumer passes it.
+		REQUIRE(ra.getUsedMemory() == 408 + 208 + 312);
+
+		ra.free(p1);
+		ra.free(p2);
+
+		REQUIRE(ra.getUsedMemory() == 0);
+	}
+
+	SECTION("alignment") {
+		RingAllocator<> ra(memory, size);
+
+		for (uint32_t i = 0; i < 100; ++i) {
+			uint8_t alignment = static_cast<uint8_t>(1u << (i % 7));
+			void* pointer = ra.allocate(1 + i % 50, alignment);
+			REQUIRE(reinterpret_cast<uintptr_t>(pointer) % alignment == 0);
+			ra.free(pointer);
+		}
+
+		REQUIRE(ra.getNumAllocations() == 0);
+	}
+
+	SECTION("random") {
+		RingAllocator<> ra(memory, size);
+
+		std::mt19937 random(7);
+		std::deque<std::pair<uint8_t*, uint32_t>> live;
+
+		for (uint32_t i = 0; i < 20000; ++i) {
+			uint32_t length = 1 + random() % 200;
+
+			auto* pointer = random() % 2 ? reinterpret_cast<uint8_t*>(ra.allocate(length, 8)) : nullptr;
+
+			if (pointer) {
+				std::memset(pointer, static_cast<int>(length & 0xFF), length);
+				live.emplace_back(pointer, length);
+			} else if (!live.empty()) {
+				auto [oldest, oldestLength] = live.front();
+
+				for (uint32_t j = 0; j < oldestLength; ++j) {
+					REQUIRE(oldest[j] == (oldestLength & 0xFF));
+				}
+
+				ra.free(oldest);
+				live.pop_front();
+			}
+		}
+
+		while (!live.empty()) {
+			ra.free(live.front().first);
+			live.pop_front();
+		}
+
+		REQUIRE(ra.getUsedMemory() == 0);
+	}
+
+	SECTION("spsc") {
+		RingAllocator<RingFlagSpsc> ra(memory, size);
+
+		const uint32_t numRecords = 100000;
+
+		std::vector<std::atomic<uint32_t*>> records(numRecords);
+
+		for (auto& record : records) { record.store(nullptr); }
+
+		// Catch assertions are not thread safe, the consumer only counts mismatches.
+		uint32_t numMismatches = 0;
+
+		std::thread consumer([&] {
+			for (uint32_t i = 0; i < numRecords; ++i) {
+				uint32_t* record;
+
+				while (!(record = records[i].load(std::memory_order_acquire))) {
+					std::this_thread::yield();
+				}
+
+				uint32_t length = 1 + i % 32;
+
+				for (uint32_t j = 0; j < length; ++j) {
+					if (record[j] != i) { ++numMismatches; }
+				}
+
+				ra.free(record);
+			}
+		});
+
+		for (uint32_t i = 0; i < numRecords; ++i) {
+			uint32_t length = 1 + i % 32;
+			uint32_t* record;
+
+			while (!(record = reinterpret_cast<uint32_t*>(ra.allocate(length * sizeof(uint32_t), 4)))) {
+				std::this_thread::yield();
+			}
+
+			for (uint32_t j = 0; j < length; ++j) { record[j] = i; }
+
+			records[i].store(record, std::memory_order_release);
+		}
+
+		consumer.join();
+
+		REQUIRE(numMismatches == 0);
+		REQUIRE(ra.getNumAllocations() == 0);
+		REQUIRE(ra.getUsedMemory() == 0);
+	}
+
+	std::free(memory);
+}
+
+} // namespace simple
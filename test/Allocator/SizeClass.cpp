@@ -0,0 +1,135 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#include "Allocator/SizeClass.h"
+
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace simple {
+
+TEST_CASE("SizeClassAllocator", "[SizeClassAllocator]") {
+	struct A {
+		A() = default;
+		A(float x, float y, float z, float w) : array { x, y, z, w } {}
+
+		float array[4];
+	};
+
+	struct B {
+		B() = default;
+		B(uint64_t x, uint64_t y, uint64_t z) : array { x, y, z } {}
+
+		uint64_t array[3];
+	};
+
+	const size_t size = 64 * SizeClassAllocator::PageSize;
+	void* memory = std::malloc(size);
+
+	SizeClassAllocator sa(memory, size);
+	REQUIRE(sa.getSize() == size);
+
+	SECTION("classes") {
+		REQUIRE(SizeClassAllocator::getClassSize(SizeClassAllocator::getClassIndex(1, 1)) == 8);
+		REQUIRE(SizeClassAllocator::getClassSize(SizeClassAllocator::getClassIndex(8, 8)) == 8);
+		REQUIRE(SizeClassAllocator::getClassSize(SizeClassAllocator::getClassIndex(9, 1)) == 16);
+		REQUIRE(SizeClassAllocator::getClassSize(SizeClassAllocator::getClassIndex(33, 8)) == 48);
+		REQUIRE(SizeClassAllocator::getClassSize(SizeClassAllocator::getClassIndex(33, 32)) == 64);
+		REQUIRE(SizeClassAllocator::getClassSize(SizeClassAllocator::getClassIndex(8, 16)) == 16);
+		REQUIRE(SizeClassAllocator::getClassSize(SizeClassAllocator::getClassIndex(1000, 8)) == 1024);
+		REQUIRE(SizeClassAllocator::getClassSize(SizeClassAllocator::getClassIndex(1024, 8)) == 1024);
+	}
+
+	SECTION("create") {
+		auto* a0 = sa.create<A>(1.1f, 1.2f, 1.3f, 1.4f);
+		auto* b0 = sa.create<B>(10, 20, 30);
+
+		REQUIRE(sa.getNumAllocations() == 2);
+		REQUIRE(sa.getUsedMemory() == 16 + 32);
+
+		REQUIRE(a0->array[0] == 1.1f);
+		REQUIRE(a0->array[3] == 1.4f);
+		REQUIRE(b0->array[0] == 10);
+		REQUIRE(b0->array[2] == 30);
+
+		sa.remove(a0);
+		sa.remove(b0);
+
+		REQUIRE(sa.getNumAllocations() == 0);
+		REQUIRE(sa.getUsedMemory() == 0);
+
+		// Freed slots are reused first.
+		auto* a1 = sa.create<A>(2.1f, 2.2f, 2.3f, 2.4f);
+		REQUIRE(a1 == a0);
+
+		sa.remove(a1);
+	}
+
+	SECTION("allocate") {
+		std::vector<void*> pointers;
+
+		for (uint32_t size = 1; size <= SizeClassAllocator::MaxSize; size += 37) {
+			void* pointer = sa.allocate(size, 8);
+			REQUIRE(sa.owns(pointer));
+			REQUIRE(reinterpret_cast<uintptr_t>(pointer) % 8 == 0);
+
+			std::memset(pointer, 0xAB, size);
+			pointers.push_back(pointer);
+		}
+
+		void* aligned = sa.allocate(40, 64);
+		REQUIRE(reinterpret_cast<uintptr_t>(aligned) % 64 == 0);
+		sa.deallocate(aligned, 40, 64);
+
+		uint32_t size = 1;
+		for (void* pointer : pointers) {
+			if (size % 2) {
+				sa.deallocate(pointer, size, 8);
+			} else {
+				sa.deallocate(pointer);
+			}
+			size += 37;
+		}
+
+		REQUIRE(sa.getNumAllocations() == 0);
+		REQUIRE(sa.getUsedMemory() == 0);
+	}
+
+	SECTION("pages") {
+		std::vector<void*> pointers;
+
+		// Fill more than one page of a single class.
+		for (uint32_t i = 0; i < 2 * SizeClassAllocator::PageSize / 64; ++i) {
+			pointers.push_back(sa.allocate(64, 8));
+		}
+
+		for (size_t i = 1; i < pointers.size(); ++i) {
+			REQUIRE(pointers[i] != pointers[i - 1]);
+		}
+
+		for (void* pointer : pointers) {
+			sa.deallocate(pointer);
+		}
+
+		REQUIRE(sa.getNumAllocations() == 0);
+	}
+
+	SECTION("clean") {
+		sa.allocate(100, 8);
+		sa.allocate(200, 8);
+
+		sa.clean();
+
+		REQUIRE(sa.getNumAllocations() == 0);
+		REQUIRE(sa.getUsedMemory() == 0);
+	}
+
+	REQUIRE(!sa.owns(&sa));
+
+	std::free(memory);
+}
+
+} // namespace simple
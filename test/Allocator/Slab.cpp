@@ -0,0 +1,179 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#include "Allocator/Slab.h"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace simple {
+
+TEST_CASE("SlabAllocator", "[SlabAllocator]") {
+	struct A {
+		A() = default;
+		A(float x, float y, float z, float w) : array { x, y, z, w } {}
+
+		float array[4];
+	};
+
+	struct B {
+		B() = default;
+		B(uint64_t x, uint64_t y, uint64_t z) : array { x, y, z } {}
+
+		uint64_t array[3];
+	};
+
+	SECTION("create") {
+		SlabAllocator sa(sizeof(A), alignof(A));
+		REQUIRE(sa.getObjectSize() == 16);
+		REQUIRE(sa.getNumSlabs() == 0);
+
+		auto* a0 = sa.create<A>(1.1f, 1.2f, 1.3f, 1.4f);
+		auto* a1 = sa.create<A>(2.1f, 2.2f, 2.3f, 2.4f);
+
+		REQUIRE(sa.getNumSlabs() == 1);
+		REQUIRE(sa.getNumAllocations() == 2);
+		REQUIRE(SlabAllocator::owner(a0) == &sa);
+		REQUIRE(SlabAllocator::owner(&a1->array[3]) == &sa);
+
+		REQUIRE(a0->array[0] == 1.1f);
+		REQUIRE(a1->array[3] == 2.4f);
+
+		sa.remove(a0);
+		sa.remove(a1);
+
+		REQUIRE(sa.getNumAllocations() == 0);
+		REQUIRE(sa.trim() == SlabAllocator::SlabSize);
+		REQUIRE(sa.getNumSlabs() == 0);
+	}
+
+	SECTION("route") {
+		// One allocator per size class, frees find their way back without the size.
+		SlabAllocator small(sizeof(A), alignof(A));
+		SlabAllocator large(sizeof(B), alignof(B));
+
+		std::mt19937 random(13);
+		std::vector<std::pair<void*, SlabAllocator*>> live;
+
+		for (uint32_t i = 0; i < 20000; ++i) {
+			SlabAllocator* allocator = random() % 2 ? &small : &large;
+			void* pointer = allocator->allocate();
+
+			REQUIRE(reinterpret_cast<uintptr_t>(pointer) % 8 == 0);
+			std::memset(pointer, 0xAB, allocator->getObjectSize());
+
+			live.emplace_back(pointer, allocator);
+		}
+
+		REQUIRE(small.getNumSlabs() > 1);
+		REQUIRE(large.getNumSlabs() > 1);
+
+		std::shuffle(live.begin(), live.end(), random);
+
+		for (auto [pointer, allocator] : live) {
+			REQUIRE(SlabAllocator::owner(pointer) == allocator);
+			SlabAllocator::deallocateAny(pointer);
+		}
+
+		REQUIRE(small.getNumAllocations() == 0);
+		REQUIRE(large.getNumAllocations() == 0);
+	}
+
+	SECTION("reuse") {
+		SlabAllocator sa(64, 64);
+
+		uint32_t numObjects = sa.getNumObjectsPerSlab();
+		std::vector<void*> pointers;
+
+		for (uint32_t i = 0; i < numObjects; ++i) {
+			pointers.push_back(sa.allocate());
+			REQUIRE(reinterpret_cast<uintptr_t>(pointers.back()) % 64 == 0);
+		}
+
+		REQUIRE(sa.getNumSlabs() == 1);
+
+		// The slab is full, the next object comes from a new one.
+		void* extra = sa.allocate();
+		REQUIRE(sa.getNumSlabs() == 2);
+
+		sa.deallocate(pointers[5]);
+		REQUIRE(sa.allocate() == pointers[5]);
+
+		for (void* pointer : pointers) { sa.deallocate(pointer); }
+
+		sa.deallocate(extra);
+
+		REQUIRE(sa.trim() == 2 * SlabAllocator::SlabSize);
+	}
+
+	SECTION("remote") {
+		SlabAllocator sa(sizeof(B), alignof(B));
+
+		const uint32_t numRounds  = 100;
+		const uint32_t numObjects = 1000;
+
+		// The owner produces, another thread frees; the owner takes the objects back on a miss.
+		std::vector<void*> batches[numRounds];
+
+		for (uint32_t round = 0; round < numRounds; ++round) {
+			for (uint32_t i = 0; i < numObjects; ++i) { batches[round].push_back(sa.allocate()); }
+		}
+
+		uint32_t numSlabs = sa.getNumSlabs();
+
+		std::thread consumer([&] {
+			for (auto& batch : batches) {
+				for (void* pointer : batch) { SlabAllocator::deallocateAny(pointer); }
+			}
+		});
+
+		consumer.join();
+
+		REQUIRE(sa.getNumAllocations() == numRounds * numObjects);
+
+		// Uses up the carved tail of the last slab, then reclaims instead of mapping new slabs.
+		std::vector<void*> pointers;
+
+		for (uint32_t i = 0; i < numRounds * numObjects; ++i) { pointers.push_back(sa.allocate()); }
+
+		REQUIRE(sa.getNumSlabs() == numSlabs);
+
+		for (void* pointer : pointers) { sa.deallocate(pointer); }
+
+		REQUIRE(sa.getNumAllocations() == 0);
+	}
+
+	SECTION("remote concurrent") {
+		SlabAllocator sa(sizeof(A), alignof(A));
+
+		const uint32_t numObjects = 200000;
+
+		std::vector<std::atomic<void*>> handoff(numObjects);
+
+		for (auto& slot : handoff) { slot.store(nullptr); }
+
+		std::thread consumer([&] {
+			for (auto& slot : handoff) {
+				void* pointer;
+				while (!(pointer = slot.load(std::memory_order_acquire))) { std::this_thread::yield(); }
+				sa.deallocate(pointer);
+			}
+		});
+
+		for (auto& slot : handoff) { slot.store(sa.allocate(), std::memory_order_release); }
+
+		consumer.join();
+
+		sa.reclaimRemote();
+
+		REQUIRE(sa.getNumAllocations() == 0);
+	}
+}
+
+} // namespace simple
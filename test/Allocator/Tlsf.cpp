@@ -0,0 +1,187 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#include "Allocator/Tlsf.h"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace simple {
+
+TEST_CASE("TlsfAllocator", "[TlsfAllocator]") {
+	struct A {
+		A() = default;
+		A(float x, float y, float z, float w) : array { x, y, z, w } {}
+
+		float array[4];
+	};
+
+	struct B {
+		B() = default;
+		B(uint64_t x, uint64_t y, uint64_t z) : array { x, y, z } {}
+
+		uint64_t array[3];
+	};
+
+	const size_t size = 64 * 1024;
+	void* memory = std::malloc(size);
+
+	SECTION("create") {
+		TlsfAllocator ta(memory, size);
+		REQUIRE(ta.getSize() == size);
+
+		auto* a0 = ta.create<A>(1.1f, 1.2f, 1.3f, 1.4f);
+		auto* b0 = ta.create<B>(10, 20, 30);
+		auto* a1 = ta.create<A>(2.1f, 2.2f, 2.3f, 2.4f);
+
+		// header = 8
+		// data   = 16 [4 * sizeof(float)], 24 [3 * sizeof(uint64_t)]
+		// sum    = 80 [8 + 16 + 8 + 24 + 8 + 16]
+		REQUIRE(ta.getUsedMemory() == 80);
+		REQUIRE(ta.getNumAllocations() == 3);
+
+		REQUIRE(a0->array[0] == 1.1f);
+		REQUIRE(b0->array[2] == 30);
+		REQUIRE(a1->array[3] == 2.4f);
+
+		// Freed out of order, the middle block merges with both neighbours.
+		ta.remove(a0);
+
+		ta.remove(a1);
+
+		ta.remove(b0);
+
+		REQUIRE(ta.getUsedMemory() == 0);
+		REQUIRE(ta.getNumAllocations() == 0);
+	}
+
+	SECTION("createArray") {
+		TlsfAllocator ta(memory, size);
+
+		auto* a = ta.createArray<A>(10, 1.0f, 2.0f, 3.0f, 4.0f);
+		auto* c = ta.createArrayNoConstruct<uint8_t>(33);
+
+		for (uint32_t i = 0; i < 10; ++i) {
+			REQUIRE(a[i].array[0] == 1.0f);
+			REQUIRE(a[i].array[3] == 4.0f);
+		}
+
+		std::memset(c, 0xFF, 33);
+
+		ta.removeArray(a);
+		ta.removeArrayNoDestruct(c);
+
+		REQUIRE(ta.getNumAllocations() == 0);
+	}
+
+	SECTION("alignment") {
+		TlsfAllocator ta(memory, size);
+
+		std::vector<void*> pointers;
+
+		for (uint32_t alignment = 1; alignment <= 128; alignment *= 2) {
+			void* pointer = ta.allocate(24, alignment);
+			REQUIRE(reinterpret_cast<uintptr_t>(pointer) % alignment == 0);
+			pointers.push_back(pointer);
+		}
+
+		for (void* pointer : pointers) {
+			ta.deallocate(pointer);
+		}
+
+		REQUIRE(ta.getNumAllocations() == 0);
+	}
+
+	SECTION("segregation") {
+		TlsfAllocator ta(memory, size);
+
+		void* big   = ta.allocate(1000, 8);
+		void* gap0  = ta.allocate(8, 8);
+		void* small = ta.allocate(40, 8);
+		void* gap1  = ta.allocate(8, 8);
+
+		ta.deallocate(small);
+		ta.deallocate(big);
+
+		// Small requests come from the small list even though the bigger block was freed last.
+		REQUIRE(ta.allocate(40, 8) == small);
+		REQUIRE(ta.allocate(900, 8) == big);
+
+		ta.clean();
+
+		(void)gap0;
+		(void)gap1;
+	}
+
+	SECTION("exhaustion") {
+		TlsfAllocator ta(memory, size);
+
+		std::vector<void*> pointers;
+
+		for (uint32_t i = 0; i < size / 128 - 1; ++i) {
+			pointers.push_back(ta.allocate(120, 8));
+		}
+
+		for (size_t i = 0; i < pointers.size(); i += 2) {
+			ta.deallocate(pointers[i]);
+		}
+
+		for (size_t i = 0; i < pointers.size(); i += 2) {
+			pointers[i] = ta.allocate(100, 8);
+		}
+
+		for (void* pointer : pointers) {
+			ta.deallocate(pointer);
+		}
+
+		REQUIRE(ta.getNumAllocations() == 0);
+
+		// Everything merged back, so one allocation can take almost the whole buffer.
+		void* all = ta.allocate(size - 1024, 8);
+		ta.deallocate(all);
+	}
+
+	SECTION("random") {
+		TlsfAllocator ta(memory, size);
+
+		std::mt19937 random(3);
+		std::vector<std::pair<uint8_t*, uint32_t>> live;
+
+		for (uint32_t i = 0; i < 5000; ++i) {
+			if (live.size() < 100 && (live.empty() || random() % 3 != 0)) {
+				uint32_t length = 1 + random() % 300;
+				auto* pointer = reinterpret_cast<uint8_t*>(ta.allocate(length, 1u << (random() % 5)));
+				std::memset(pointer, static_cast<int>(length & 0xFF), length);
+				live.emplace_back(pointer, length);
+			} else {
+				size_t index = random() % live.size();
+				auto [pointer, length] = live[index];
+
+				for (uint32_t j = 0; j < length; ++j) {
+					REQUIRE(pointer[j] == (length & 0xFF));
+				}
+
+				ta.deallocate(pointer);
+				live[index] = live.back();
+				live.pop_back();
+			}
+		}
+
+		std::shuffle(live.begin(), live.end(), random);
+
+		for (auto& allocation : live) {
+			ta.deallocate(allocation.first);
+		}
+
+		REQUIRE(ta.getUsedMemory() == 0);
+	}
+
+	std::free(memory);
+}
+
+} // namespace simple
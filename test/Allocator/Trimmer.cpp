@@ -0,0 +1,35 @@
+// Copyright (C) 2020 Maxim, 2dev2fun@gmail.com. All rights reserved.
+
+#include "Allocator/Trimmer.h"
+
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+namespace simple {
+
+TEST_CASE("BackgroundTrimmer", "[BackgroundTrimmer]") {
+	std::atomic<uint32_t> numCalls(0);
+
+	{
+		BackgroundTrimmer trimmer(std::chrono::milliseconds(1), [&]() {
+			numCalls.fetch_add(1);
+			return size_t(4096);
+		});
+
+		while (trimmer.getNumRuns() < 3) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		REQUIRE(trimmer.getReleasedSize() >= 3 * 4096);
+	}
+
+	uint32_t numCallsAfterStop = numCalls.load();
+	std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+	REQUIRE(numCalls.load() == numCallsAfterStop);
+}
+
+} // namespace simple